@@ -45,7 +45,19 @@
  *
  * You can also #define KVF_ENABLE_VALIDATION_LAYERS to enable validation layers.
  *
+ * Host allocation callbacks given to kvfSetDefaultAllocationCallbacks are used for the instance,
+ * the surfaces and the devices, and are inherited by the objects of every device created afterwards
+ * (kvfSetAllocationCallbacks overrides them per device). Set them before creating any object.
+ * kvfEnableHostMemoryTracking installs a tracking allocator on top of them that accounts live bytes,
+ * allocations count and peak usage per VkSystemAllocationScope and per VkObjectType. It must also be
+ * enabled before creating any object and is not thread safe.
+ *
  * Use #define KVF_NO_KHR to remove all functions that use KHR calls.
+ *
+ * Short-lived internal allocations (queue families, extensions lists, attachment references...)
+ * are served by a per-thread scratch arena backed by KVF_MALLOC. You can #define KVF_SCRATCH_BLOCK_SIZE
+ * to change the size of its blocks (16KB by default) and call kvfReleaseThreadScratchMemory before
+ * a thread that used kvf exits to give the blocks back.
  */
 
 #ifndef KBZ_8_VULKAN_FRAMEWORK_H
@@ -122,6 +134,13 @@ typedef enum
 	KVF_IMAGE_OTHER = 4,
 } KvfImageType;
 
+typedef enum
+{
+	KVF_BINDLESS_SAMPLED_IMAGE = 0,
+	KVF_BINDLESS_STORAGE_BUFFER = 1,
+	KVF_BINDLESS_SAMPLER = 2
+} KvfBindlessResourceType; // Also the binding of the resource type's array in bindless tables
+
 #ifndef KVF_NO_KHR
 	typedef enum
 	{
@@ -136,12 +155,84 @@ typedef enum
 
 typedef void (*KvfErrorCallback)(const char* message);
 
+typedef struct
+{
+	uint32_t block_size; // Bytes per texel block, 0 for unknown formats and combined depth stencil formats, that are copied one aspect at a time
+	uint32_t block_width; // Texels, 1 for uncompressed formats
+	uint32_t block_height;
+	uint32_t depth_size; // Bytes per texel of a tightly packed copy of the depth aspect, 0 without depth
+	uint32_t stencil_size; // Same for the stencil aspect
+	VkImageAspectFlags aspect;
+	bool compressed;
+	bool depth;
+	bool stencil;
+	bool srgb;
+} KvfFormatInfo;
+
+typedef struct
+{
+	size_t emitted_barriers; // Requirements that recorded a vkCmdPipelineBarrier
+	size_t skipped_barriers; // Requirements already satisfied by the tracked state
+} KvfImageStateStats; // Both count kvfRequireImageState and kvfRequireImageSubresourceState calls
+
+typedef struct
+{
+	VkFilter mag_filter;
+	VkFilter min_filter;
+	VkSamplerMipmapMode mipmap_mode;
+	VkSamplerAddressMode address_mode_u;
+	VkSamplerAddressMode address_mode_v;
+	VkSamplerAddressMode address_mode_w;
+	float mip_lod_bias;
+	float max_anisotropy; // 1 or less disables anisotropic filtering, higher values are clamped to the device limit
+	VkBool32 compare_enable;
+	VkCompareOp compare_op;
+	float min_lod;
+	float max_lod;
+	VkBorderColor border_color;
+	VkBool32 unnormalized_coordinates;
+} KvfSamplerDescription;
+
+typedef struct
+{
+	VkDescriptorType type;
+	float ratio; // Descriptors of this type per set
+} KvfDescriptorPoolRatio;
+
+typedef struct
+{
+	size_t pools_count;
+	size_t sets_allocated;
+	size_t sets_capacity;
+	size_t descriptors_allocated; // Only counts sets allocated with layouts created by kvfCreateDescriptorSetLayout
+	size_t descriptors_capacity;
+	size_t failed_allocations; // Allocations retried in another pool after VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL
+} KvfDescriptorPoolStats;
+
+typedef struct
+{
+	size_t live_bytes;
+	size_t peak_bytes;
+	size_t live_allocations;
+	size_t total_allocations;
+} KvfHostMemoryStats;
+
 #ifdef KVF_IMPL_VK_NO_PROTOTYPES
 	typedef struct KvfGlobalVulkanFunctions KvfGlobalVulkanFunctions;
 	typedef struct KvfDeviceVulkanFunctions KvfDeviceVulkanFunctions;
 	typedef struct KvfInstanceVulkanFunctions KvfInstanceVulkanFunctions;
 #endif
 typedef struct KvfGraphicsPipelineBuilder KvfGraphicsPipelineBuilder;
+typedef struct KvfAliasingAllocator KvfAliasingAllocator;
+typedef struct KvfBarrierBatch KvfBarrierBatch;
+typedef struct KvfTextureUploader KvfTextureUploader;
+typedef struct KvfReadbackQueue KvfReadbackQueue;
+typedef struct KvfOffscreenTarget KvfOffscreenTarget;
+typedef struct KvfDescriptorFrameRing KvfDescriptorFrameRing;
+typedef struct KvfDescriptorWriteBatch KvfDescriptorWriteBatch;
+typedef struct KvfBindlessTable KvfBindlessTable;
+typedef struct KvfDescriptorBuffer KvfDescriptorBuffer;
+typedef uint64_t KvfReadback; // 0 is never a valid readback
 
 void kvfSetErrorCallback(KvfErrorCallback callback);
 void kvfSetWarningCallback(KvfErrorCallback callback);
@@ -155,14 +246,24 @@ void kvfSetValidationWarningCallback(KvfErrorCallback callback);
 
 void kvfAddLayer(const char* layer);
 
+void kvfSetDefaultAllocationCallbacks(const VkAllocationCallbacks* callbacks); // NULL restores driver allocations
+void kvfEnableHostMemoryTracking(); // Cannot be disabled once enabled
+KvfHostMemoryStats kvfGetHostMemoryStatsByScope(VkSystemAllocationScope scope);
+KvfHostMemoryStats kvfGetHostMemoryStatsByObjectType(VkObjectType type); // Extension object types other than surfaces, swapchains, debug messengers and update templates share one bucket
+KvfHostMemoryStats kvfGetHostMemoryTotalStats();
+
+void kvfReleaseThreadScratchMemory(); // Frees the calling thread's scratch arena blocks
+
 VkInstance kvfCreateInstance(const char** extensions_enabled, uint32_t extensions_count);
 VkInstance kvfCreateInstanceNext(const char** extensions_enabled, uint32_t extensions_count, void* p_next);
+void kvfSetInstanceAPIVersion(uint32_t api_version); // Applies to instances created afterwards, 0 (the default) requests Vulkan 1.0
 void kvfDestroyInstance(VkInstance instance);
 
 // If surfaces given to theses functions are VK_NULL_HANDLE no present queues will be searched and thus kvfQueuePresentKHR will not work
 VkPhysicalDevice kvfPickFirstPhysicalDevice(VkInstance instance, VkSurfaceKHR surface);
 VkPhysicalDevice kvfPickGoodDefaultPhysicalDevice(VkInstance instance, VkSurfaceKHR surface);
 VkPhysicalDevice kvfPickGoodPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, const char** device_extensions, uint32_t device_extensions_count);
+VkPhysicalDevice kvfPickGoodHeadlessPhysicalDevice(VkInstance instance); // Only requires a graphics queue, no surface nor swapchain support
 
 VkQueue kvfGetDeviceQueue(VkDevice device, KvfQueueType queue);
 uint32_t kvfGetDeviceQueueFamily(VkDevice device, KvfQueueType queue);
@@ -177,13 +278,16 @@ int32_t kvfFindDeviceQueueFamily(VkPhysicalDevice physical, KvfQueueType type);
 #endif
 
 VkDevice kvfCreateDefaultDevice(VkPhysicalDevice physical);
+VkDevice kvfCreateHeadlessDevice(VkPhysicalDevice physical); // Same as kvfCreateDefaultDevice without VK_KHR_swapchain
 VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features);
+VkDevice kvfCreateDeviceNext(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, void* p_next); // p_next is chained to VkDeviceCreateInfo, e.g. feature structures
 VkDevice kvfCreateDefaultDevicePhysicalDeviceAndCustomQueues(VkPhysicalDevice physical, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue);
 VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue);
+VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueuesNext(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue, void* p_next);
 #ifdef KVF_IMPL_VK_NO_PROTOTYPES
 	void kvfPassDeviceVulkanFunctionPointers(VkPhysicalDevice physical, VkDevice device, const KvfDeviceVulkanFunctions* fns);
 #endif
-void kvfSetAllocationCallbacks(VkDevice device, const VkAllocationCallbacks* callbacks);
+void kvfSetAllocationCallbacks(VkDevice device, const VkAllocationCallbacks* callbacks); // Must be called before creating objects from the device, NULL restores the default callbacks
 void kvfDestroyDevice(VkDevice device);
 
 VkFence kvfCreateFence(VkDevice device);
@@ -227,24 +331,158 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore);
 	 *  - window_handle   -> ANativeWindow
 	 */
 	VkSurfaceKHR kvfCreateSurfaceKHR(VkInstance instance, KvfSurfaceType type, void* instance_handle, void* window_handle);
+	void kvfDestroySurfaceKHR(VkInstance instance, VkSurfaceKHR surface);
 #endif
 
 VkImage kvfCreateImage(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, KvfImageType type);
+VkImage kvfCreateImageExtended(VkDevice device, VkImageType image_type, VkExtent3D extent, uint32_t mip_levels, uint32_t array_layers, VkSampleCountFlagBits samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags);
+uint32_t kvfGetMipLevelsCount(VkExtent3D extent); // Full mip chain length down to 1x1x1
+VkExtent3D kvfGetMipLevelExtent(VkExtent3D extent, uint32_t mip_level);
+VkImageSubresourceRange kvfBuildImageSubresourceRange(VkFormat format, uint32_t base_mip_level, uint32_t mip_levels, uint32_t base_array_layer, uint32_t array_layers); // Aspect deduced from the format
+VkImageSubresourceLayers kvfBuildImageSubresourceLayers(VkFormat format, uint32_t mip_level, uint32_t base_array_layer, uint32_t array_layers); // Same, copies take a single aspect so combined depth stencil formats are rejected
+/**
+ * Records the generation of the whole mip chain from level 0 using blits.
+ * All levels must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and are left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+ * Uses linear filtering when the format supports it, nearest otherwise.
+ * Returns false without recording anything if the format does not support blits, mips must then be generated another way.
+ */
+bool kvfGenerateMipmaps(VkDevice device, VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent3D extent, uint32_t levels, uint32_t layers);
 void kvfCopyImageToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkImage src, size_t buffer_offset, VkImageAspectFlagBits aspect, VkExtent3D extent);
+void kvfCopyImageSubresourceToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkImage src, size_t buffer_offset, VkImageSubresourceLayers subresource, VkOffset3D offset, VkExtent3D extent); // src must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
 void kvfCopyImageToImage(VkCommandBuffer cmd, VkImage src, VkImageLayout src_layout, VkImage dst, VkImageLayout dst_layout, uint32_t count, const VkImageCopy* regions);
 
 void kvfDestroyImage(VkDevice device, VkImage image);
+
+/**
+ * Transient attachments get VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and are backed by lazily allocated
+ * memory when the device exposes it (tiled GPUs may then never allocate it), device local memory otherwise.
+ * Usage must only contain attachment bits.
+ */
+VkImage kvfCreateTransientAttachment(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples, VkDeviceMemory* memory);
+void kvfDestroyTransientAttachment(VkDevice device, VkImage image, VkDeviceMemory memory);
+
+/**
+ * The aliasing allocator packs images whose lifetimes do not overlap into shared memory.
+ * Lifetimes are inclusive [first_use, last_use] ranges expressed in any unit the caller likes (usually pass indices).
+ * Images sharing memory have undefined content at their first use, transition them from VK_IMAGE_LAYOUT_UNDEFINED.
+ * Images must not be bound to memory before being added and are not destroyed by the allocator.
+ */
+KvfAliasingAllocator* kvfCreateAliasingAllocator(VkDevice device);
+void kvfAliasingAllocatorAddImage(KvfAliasingAllocator* allocator, VkImage image, uint32_t first_use, uint32_t last_use);
+void kvfAliasingAllocatorBake(KvfAliasingAllocator* allocator, VkMemoryPropertyFlags properties); // Allocates memory and binds all images, can only be called once
+VkDeviceSize kvfAliasingAllocatorGetMemorySize(KvfAliasingAllocator* allocator); // Size actually allocated
+VkDeviceSize kvfAliasingAllocatorGetUnaliasedSize(KvfAliasingAllocator* allocator); // Size that would have been needed without aliasing
+void kvfDestroyAliasingAllocator(KvfAliasingAllocator* allocator); // Frees memory, destroy the images before
 VkImageView kvfCreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageAspectFlags aspect, int layer_count);
+VkImageView kvfCreateImageViewRange(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageSubresourceRange range);
 void kvfDestroyImageView(VkDevice device, VkImageView image_view);
-void kvfTransitionImageLayout(VkDevice device, VkImage image, KvfImageType type, VkCommandBuffer cmd, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, bool is_single_time_cmd_buffer);
+VkImageView kvfGetCachedImageView(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageSubresourceRange range); // Owned by the cache, an aspect mask of 0 is deduced from the format
+void kvfInvalidateCachedImageViews(VkDevice device, VkImage image); // Done by kvfDestroyImage, only needed for images destroyed by other means
+void kvfTransitionImageLayout(VkDevice device, VkImage image, KvfImageType type, VkCommandBuffer cmd, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, bool is_single_time_cmd_buffer); // Transitions the first mip level, and the six faces of cubes, use kvfTransitionImageLayoutRange for whole images
+void kvfTransitionImageLayoutRange(VkDevice device, VkImage image, VkCommandBuffer cmd, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, VkImageSubresourceRange range, bool is_single_time_cmd_buffer); // An aspect mask of 0 is deduced from the format
+
+/**
+ * Barrier batches collect image and buffer barriers and issue them in a single vkCmdPipelineBarrier
+ * with the union of their stage masks on flush. Flushing an empty batch records nothing.
+ */
+KvfBarrierBatch* kvfCreateBarrierBatch();
+void kvfDestroyBarrierBatch(KvfBarrierBatch* batch);
+void kvfBarrierBatchAddImageTransition(KvfBarrierBatch* batch, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, VkImageSubresourceRange range); // Same access masks and stages as kvfTransitionImageLayoutRange, same layout transitions are kept as memory dependencies
+void kvfBarrierBatchAddImageBarrier(KvfBarrierBatch* batch, const VkImageMemoryBarrier* barrier, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage);
+void kvfBarrierBatchAddBufferBarrier(KvfBarrierBatch* batch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage);
+size_t kvfBarrierBatchGetSize(KvfBarrierBatch* batch);
+void kvfBarrierBatchFlush(VkCommandBuffer cmd, KvfBarrierBatch* batch); // Records the barriers and resets the batch
+void kvfBarrierBatchReset(KvfBarrierBatch* batch);
+
+/**
+ * Registered images have their layout, last access and last stage tracked per mip level and array layer.
+ * kvfRequireImageState then only records the barriers needed to reach the requested state, and none when
+ * the image is already in the right layout and the same read accesses and stages were already synchronized.
+ * New readers of an image in the right layout still wait for its last write or layout transition.
+ * Layout changes made outside of kvfRequireImageState (manual transitions, render passes final layouts...)
+ * must be reported with kvfSetImageState. Images are unregistered by kvfDestroyImage. Not thread safe.
+ */
+void kvfRegisterImage(VkImage image, VkFormat format, uint32_t mip_levels, uint32_t array_layers, VkImageLayout current_layout);
+void kvfUnregisterImage(VkImage image);
+void kvfRequireImageState(VkCommandBuffer cmd, VkImage image, VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stage);
+void kvfRequireImageSubresourceState(VkCommandBuffer cmd, VkImage image, VkImageSubresourceRange range, VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stage);
+void kvfSetImageState(VkImage image, VkImageSubresourceRange range, VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stage); // Updates the tracked state without recording anything
+VkImageLayout kvfGetImageLayout(VkImage image, uint32_t mip_level, uint32_t array_layer);
+KvfImageStateStats kvfGetImageStateStats();
+void kvfResetImageStateStats();
+
 VkSampler kvfCreateSampler(VkDevice device, VkFilter filters, VkSamplerAddressMode address_modes, VkSamplerMipmapMode mipmap_mode);
+VkSampler kvfCreateSamplerFromDescription(VkDevice device, const KvfSamplerDescription* description);
 void kvfDestroySampler(VkDevice device, VkSampler sampler);
+KvfSamplerDescription kvfGetDefaultSamplerDescription(VkFilter filters, VkSamplerAddressMode address_modes, VkSamplerMipmapMode mipmap_mode); // Same defaults as kvfCreateSampler
+
+/**
+ * Cached samplers are shared between identical descriptions and reference counted, each kvfAcquireSampler
+ * must be matched by a kvfReleaseSampler. They must not be destroyed with kvfDestroySampler.
+ * Anisotropic filtering requires the samplerAnisotropy feature to be enabled on the device.
+ * Samplers still referenced when the device is destroyed are destroyed with it. Not thread safe.
+ */
+VkSampler kvfAcquireSampler(VkDevice device, const KvfSamplerDescription* description);
+void kvfReleaseSampler(VkDevice device, VkSampler sampler);
+size_t kvfGetCachedSamplersCount(VkDevice device);
 
 VkBuffer kvfCreateBuffer(VkDevice device, VkBufferUsageFlags usage, VkDeviceSize size);
 void kvfCopyBufferToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkBuffer src, size_t size, size_t src_offset, size_t dst_offset);
 void kvfCopyBufferToImage(VkCommandBuffer cmd, VkImage dst, VkBuffer src, size_t buffer_offset, VkImageAspectFlagBits aspect, VkExtent3D extent);
+void kvfCopyBufferToImageSubresource(VkCommandBuffer cmd, VkImage dst, VkBuffer src, size_t buffer_offset, VkImageSubresourceLayers subresource, VkOffset3D offset, VkExtent3D extent); // dst must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+void kvfCopyBufferToImageRegions(VkCommandBuffer cmd, VkImage dst, VkBuffer src, uint32_t count, const VkBufferImageCopy* regions); // Same
 void kvfDestroyBuffer(VkDevice device, VkBuffer buffer);
 
+/**
+ * The texture uploader streams whole mip chains and array slices through a persistently mapped staging ring.
+ * The ring is split in frames_in_flight segments of bytes_per_frame, kvfTextureUploaderRecord fills the next one
+ * and must only be called once the GPU is done with the submission that used it frames_in_flight calls ago.
+ * Coarse mips of all queued images are uploaded first, mips too large for a frame are split by layers, slices or rows.
+ * Block compressed formats are supported, rows are then rows of texel blocks.
+ * Images are expected in VK_IMAGE_LAYOUT_UNDEFINED when added. Every mip switches to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+ * as soon as it is complete, so the image can be sampled from its finest resident mip before the whole chain is uploaded.
+ * Pixel data is read from the caller's memory until the image is complete, it must stay valid until then.
+ */
+KvfTextureUploader* kvfCreateTextureUploader(VkDevice device, VkDeviceSize bytes_per_frame, uint32_t frames_in_flight);
+void kvfDestroyTextureUploader(KvfTextureUploader* uploader);
+void kvfTextureUploaderAddImage(KvfTextureUploader* uploader, VkImage image, VkFormat format, VkExtent3D extent, uint32_t mip_levels, uint32_t array_layers, const void* data); // Data is tightly packed, mip 0 first, all layers of a mip one after another. Combined depth stencil formats are not supported
+VkDeviceSize kvfTextureUploaderRecord(KvfTextureUploader* uploader, VkCommandBuffer cmd); // Returns the amount of bytes recorded
+uint32_t kvfTextureUploaderGetFinestResidentMip(KvfTextureUploader* uploader, VkImage image); // Returns the mip levels count if nothing is resident yet, 0 for images not in the uploader
+bool kvfTextureUploaderIsIdle(KvfTextureUploader* uploader);
+
+/**
+ * The readback queue owns a ring of host visible buffers (cached when the device allows it) that copies are recorded into.
+ * Copies recorded since the last call to kvfReadbackQueueGetFence belong to the command buffer submitted with that fence.
+ * Readbacks are then polled without blocking and expose a mapped pointer once the fence is signaled, until released.
+ * Images must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL. Recording returns 0 when no slot is free or big enough.
+ */
+KvfReadbackQueue* kvfCreateReadbackQueue(VkDevice device, uint32_t slots_count, VkDeviceSize slot_size);
+void kvfDestroyReadbackQueue(KvfReadbackQueue* queue); // Waits for pending readbacks
+KvfReadback kvfReadbackQueueCopyImage(KvfReadbackQueue* queue, VkCommandBuffer cmd, VkImage image, VkFormat format, VkImageSubresourceLayers subresource, VkOffset3D offset, VkExtent3D extent); // The slot size is deduced from the format, the copied aspect and the layers
+KvfReadback kvfReadbackQueueCopyBuffer(KvfReadbackQueue* queue, VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+VkFence kvfReadbackQueueGetFence(KvfReadbackQueue* queue); // Owned by the queue, returns VK_NULL_HANDLE if nothing has been recorded
+bool kvfReadbackQueuePoll(KvfReadbackQueue* queue, KvfReadback readback);
+const void* kvfReadbackQueueGetData(KvfReadbackQueue* queue, KvfReadback readback, VkDeviceSize* size); // NULL until the readback is complete
+void kvfReadbackQueueRelease(KvfReadbackQueue* queue, KvfReadback readback); // Only once the copy has been submitted with the queue's fence
+
+/**
+ * Offscreen targets replace the swapchain for headless rendering. Each of the frames_count frames owns a color
+ * image and, unless depth_format is VK_FORMAT_UNDEFINED, a transient depth attachment, plus a framebuffer
+ * compatible with the target's render pass. The render pass clears both attachments and leaves the color image
+ * in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ready for kvfOffscreenTargetReadback to be recorded right after it.
+ * Readbacks go through the target's own readback queue, with one slot per frame.
+ */
+KvfOffscreenTarget* kvfCreateOffscreenTarget(VkDevice device, VkExtent2D extent, VkFormat color_format, VkFormat depth_format, uint32_t frames_count);
+void kvfDestroyOffscreenTarget(KvfOffscreenTarget* target); // Waits for pending readbacks
+VkRenderPass kvfOffscreenTargetGetRenderPass(KvfOffscreenTarget* target);
+VkFramebuffer kvfOffscreenTargetGetFramebuffer(KvfOffscreenTarget* target, uint32_t frame);
+VkImage kvfOffscreenTargetGetColorImage(KvfOffscreenTarget* target, uint32_t frame);
+VkImageView kvfOffscreenTargetGetColorImageView(KvfOffscreenTarget* target, uint32_t frame);
+VkExtent2D kvfOffscreenTargetGetExtent(KvfOffscreenTarget* target);
+uint32_t kvfOffscreenTargetGetFramesCount(KvfOffscreenTarget* target);
+KvfReadbackQueue* kvfOffscreenTargetGetReadbackQueue(KvfOffscreenTarget* target);
+KvfReadback kvfOffscreenTargetReadback(KvfOffscreenTarget* target, VkCommandBuffer cmd, uint32_t frame); // Must be recorded after the target's render pass
+
 VkFramebuffer kvfCreateFramebuffer(VkDevice device, VkRenderPass renderpass, VkImageView* image_views, size_t image_views_count, VkExtent2D extent);
 VkExtent2D kvfGetFramebufferSize(VkFramebuffer buffer);
 void kvfDestroyFramebuffer(VkDevice device, VkFramebuffer framebuffer);
@@ -274,15 +512,46 @@ const char* kvfVerbaliseVkResult(VkResult result);
 
 bool kvfIsStencilFormat(VkFormat format);
 bool kvfIsDepthFormat(VkFormat format);
-uint32_t kvfFormatSize(VkFormat format);
+uint32_t kvfFormatSize(VkFormat format); // Bytes per texel, 0 for block compressed and combined depth stencil formats
+KvfFormatInfo kvfGetFormatInfo(VkFormat format); // Covers all Vulkan 1.0 formats
+VkDeviceSize kvfFormatImageSize(VkFormat format, VkExtent3D extent); // Tightly packed size of one layer, partial blocks are rounded up, 0 for combined depth stencil formats
 VkPipelineStageFlags kvfLayoutToAccessMask(VkImageLayout layout, bool is_destination);
 VkPipelineStageFlags kvfAccessFlagsToPipelineStage(VkAccessFlags access_flags, VkPipelineStageFlags stage_flags);
 VkFormat kvfFindSupportFormatInCandidates(VkDevice device, VkFormat* candidates, size_t candidates_count, VkImageTiling tiling, VkFormatFeatureFlags flags);
 
 VkDescriptorSetLayout kvfCreateDescriptorSetLayout(VkDevice device, VkDescriptorSetLayoutBinding* bindings, size_t bindings_count);
+VkDescriptorSetLayout kvfCreateDescriptorSetLayoutWithFlags(VkDevice device, VkDescriptorSetLayoutBinding* bindings, size_t bindings_count, VkDescriptorSetLayoutCreateFlags flags); // Push descriptor and descriptor buffer layouts cannot allocate sets, see kvfDescriptorWriteBatchPush and KvfDescriptorBuffer
 void kvfDestroyDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout layout);
 
+/**
+ * Layouts created by kvfCreateDescriptorSetLayout can be updated in one call with a descriptor update template,
+ * which needs Vulkan 1.1 (see kvfSetInstanceAPIVersion). The data packs, for each binding in the order they were given
+ * to kvfCreateDescriptorSetLayout, descriptorCount VkDescriptorBufferInfo, VkDescriptorImageInfo or VkBufferView
+ * depending on the binding's type, so it can be described by a plain struct. Sampler bindings with immutable samplers are skipped.
+ */
+VkDescriptorUpdateTemplate kvfGetDescriptorSetLayoutUpdateTemplate(VkDevice device, VkDescriptorSetLayout layout); // Owned by the layout, created on first use
+size_t kvfGetDescriptorSetLayoutUpdateDataSize(VkDevice device, VkDescriptorSetLayout layout);
+void kvfUpdateDescriptorSetWithTemplate(VkDevice device, VkDescriptorSet set, VkDescriptorSetLayout layout, const void* data);
+
+/**
+ * Sets cached by content, keyed by the layout and the bound resources given as the same packed data as kvfUpdateDescriptorSetWithTemplate.
+ * A miss allocates the set with kvfAllocateDescriptorSet and writes it, a hit returns the set built earlier.
+ * kvfDescriptorSetCacheNextFrame frees the sets that have not been requested during the last max_unused_frames frames,
+ * which must cover the frames in flight. Sets referencing a buffer or an image view are dropped when it is destroyed,
+ * the destroyed resources are batched and looked for in the cached sets once, by the next call to the cache.
+ * kvf does not create buffer views, so sets referencing texel buffer views must be dropped with
+ * kvfInvalidateCachedDescriptorSetsForBufferView before the view is destroyed.
+ * The sets of a destroyed layout may still be in flight, they are never returned again and are freed by
+ * kvfDescriptorSetCacheNextFrame once unused for max_unused_frames frames, or with the descriptor pools.
+ */
+VkDescriptorSet kvfGetCachedDescriptorSet(VkDevice device, VkDescriptorSetLayout layout, const void* data); // Owned by the cache
+void kvfDescriptorSetCacheNextFrame(VkDevice device, uint32_t max_unused_frames);
+void kvfInvalidateCachedDescriptorSets(VkDevice device, VkBuffer buffer, VkImageView view); // Done by kvfDestroyBuffer and kvfDestroyImageView, either can be VK_NULL_HANDLE
+void kvfInvalidateCachedDescriptorSetsForBufferView(VkDevice device, VkBufferView buffer_view);
+size_t kvfGetCachedDescriptorSetsCount(VkDevice device);
+
 VkDescriptorSet kvfAllocateDescriptorSet(VkDevice device, VkDescriptorSetLayout layout);
+void kvfAllocateDescriptorSets(VkDevice device, const VkDescriptorSetLayout* layouts, uint32_t count, VkDescriptorSet* sets); // One vkAllocateDescriptorSets per pool used instead of one per set
 void kvfUpdateStorageBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding);
 void kvfUpdateUniformBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding);
 void kvfUpdateImageToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorImageInfo* info, uint32_t binding);
@@ -290,11 +559,114 @@ VkWriteDescriptorSet kvfWriteStorageBufferToDescriptorSet(VkDevice device, VkDes
 VkWriteDescriptorSet kvfWriteUniformBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding);
 VkWriteDescriptorSet kvfWriteImageToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorImageInfo* info, uint32_t binding);
 
-void kvfResetDeviceDescriptorPools(VkDevice device);
+void kvfResetDeviceDescriptorPools(VkDevice device); // Also empties the descriptor set cache
+
+/**
+ * Sets are allocated from a growing list of pools. A pool that runs out of memory is skipped and a new one,
+ * twice as big up to KVF_DESCRIPTOR_POOL_MAX_CAPACITY sets, is created when no existing pool can hold the set.
+ * Pools hold ratio * max sets descriptors of each type, one of each core type per set by default.
+ * Ratios only apply to pools created afterwards, NULL restores the defaults.
+ * Ratios can be derived from layouts created by kvfCreateDescriptorSetLayout, as the average of their bindings.
+ */
+void kvfSetDescriptorPoolRatios(VkDevice device, const KvfDescriptorPoolRatio* ratios, size_t ratios_count);
+void kvfSetDescriptorPoolRatiosFromLayouts(VkDevice device, const VkDescriptorSetLayout* layouts, size_t layouts_count);
+KvfDescriptorPoolStats kvfGetDescriptorPoolStats(VkDevice device); // Sum of all pools
+KvfDescriptorPoolStats kvfGetDescriptorPoolStatsByIndex(VkDevice device, size_t pool_index); // pools_count and failed_allocations are left to 0
+
+/**
+ * Linear allocator for sets that only live for one frame. Each frame in flight owns pools created without
+ * VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT that are filled one after the other and reset all at once
+ * by kvfDescriptorFrameRingBeginFrame, after waiting for the fence of the frame's last submission if one is given.
+ * Sets allocated from the ring must not be freed individually. Persistent sets belong to kvfAllocateDescriptorSet.
+ * sets_per_pool of 0 defaults to KVF_DESCRIPTOR_POOL_CAPACITY, pools are sized with the device's descriptor pool ratios.
+ */
+KvfDescriptorFrameRing* kvfCreateDescriptorFrameRing(VkDevice device, uint32_t frames_count, uint32_t sets_per_pool);
+void kvfDestroyDescriptorFrameRing(KvfDescriptorFrameRing* ring); // Sets of pending frames must not be in use anymore
+void kvfDescriptorFrameRingBeginFrame(KvfDescriptorFrameRing* ring, uint32_t frame, VkFence fence); // fence can be VK_NULL_HANDLE if already waited on
+VkDescriptorSet kvfDescriptorFrameRingAllocate(KvfDescriptorFrameRing* ring, VkDescriptorSetLayout layout); // Allocates from the frame given to the last kvfDescriptorFrameRingBeginFrame
+KvfDescriptorPoolStats kvfDescriptorFrameRingGetStats(KvfDescriptorFrameRing* ring, uint32_t frame);
+
+/**
+ * Accumulates descriptor writes and submits them with a single vkUpdateDescriptorSets.
+ * Infos are copied into the batch, a write covers count consecutive array elements starting at array_element.
+ * Writes that continue the previous one (same set, binding and type, next array element) are merged.
+ * A batch can also be recorded into a command buffer with kvfDescriptorWriteBatchPush for a layout created with
+ * VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR (VK_KHR_push_descriptor must be enabled on the device),
+ * in which case the writes' set is ignored and can be VK_NULL_HANDLE. No set is allocated nor updated.
+ */
+KvfDescriptorWriteBatch* kvfCreateDescriptorWriteBatch(VkDevice device);
+void kvfDestroyDescriptorWriteBatch(KvfDescriptorWriteBatch* batch);
+void kvfDescriptorWriteBatchAddBuffers(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkDescriptorBufferInfo* infos, uint32_t count);
+void kvfDescriptorWriteBatchAddImages(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkDescriptorImageInfo* infos, uint32_t count);
+void kvfDescriptorWriteBatchAddTexelBuffers(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkBufferView* views, uint32_t count);
+size_t kvfDescriptorWriteBatchGetSize(KvfDescriptorWriteBatch* batch); // Writes after merging
+void kvfDescriptorWriteBatchFlush(KvfDescriptorWriteBatch* batch); // Updates the sets and resets the batch
+void kvfDescriptorWriteBatchReset(KvfDescriptorWriteBatch* batch);
+#ifndef KVF_NO_KHR
+	void kvfDescriptorWriteBatchPush(VkCommandBuffer cmd, KvfDescriptorWriteBatch* batch, VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t set); // Records the writes with vkCmdPushDescriptorSetKHR and resets the batch
+#endif
+
+/**
+ * Bindless mode, one descriptor set holding a partially bound, update-after-bind array per KvfBindlessResourceType
+ * that shaders index directly, so draws no longer bind per material sets. The device must be created with the
+ * descriptor indexing features (Vulkan 1.2 or VK_EXT_descriptor_indexing) filled by kvfFillBindlessFeatures,
+ * chained through kvfCreateDeviceNext.
+ * Registered resources get a stable index that is valid until released. Released indices are only handed out
+ * again once more than frames_in_flight calls to kvfBindlessTableNextFrame have passed (one call per frame, at its
+ * start or end), when no frame that could read them is still running on the GPU.
+ * Writes are batched, kvfBindlessTableFlush must be called before submitting work that uses newly registered indices.
+ */
+void kvfFillBindlessFeatures(VkPhysicalDeviceDescriptorIndexingFeatures* features); // Resets features and enables the ones bindless tables need
+KvfBindlessTable* kvfCreateBindlessTable(VkDevice device, uint32_t sampled_images_capacity, uint32_t storage_buffers_capacity, uint32_t samplers_capacity, uint32_t frames_in_flight);
+void kvfDestroyBindlessTable(KvfBindlessTable* table); // The table must not be in use anymore
+uint32_t kvfBindlessTableRegisterSampledImage(KvfBindlessTable* table, VkImageView view, VkImageLayout layout);
+uint32_t kvfBindlessTableRegisterStorageBuffer(KvfBindlessTable* table, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+uint32_t kvfBindlessTableRegisterSampler(KvfBindlessTable* table, VkSampler sampler);
+void kvfBindlessTableRelease(KvfBindlessTable* table, KvfBindlessResourceType type, uint32_t index); // Exactly once per registered index
+void kvfBindlessTableFlush(KvfBindlessTable* table);
+void kvfBindlessTableNextFrame(KvfBindlessTable* table); // Flushes and recycles the indices released more than frames_in_flight frames ago
+VkDescriptorSetLayout kvfBindlessTableGetLayout(KvfBindlessTable* table);
+VkDescriptorSet kvfBindlessTableGetSet(KvfBindlessTable* table);
+uint32_t kvfBindlessTableGetUsedCount(KvfBindlessTable* table, KvfBindlessResourceType type); // Indices that are registered or waiting to be recycled
+
+/**
+ * Descriptor buffers (VK_EXT_descriptor_buffer) replace pools and sets, descriptors are written straight into a persistently
+ * mapped buffer with vkGetDescriptorEXT and bound with offsets. Layouts are still created with kvfCreateDescriptorSetLayoutWithFlags,
+ * with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT, and pipelines using them need VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT.
+ * The device must enable the extension and the features filled by kvfFillDescriptorBufferFeatures, chained through kvfCreateDeviceNext
+ * (buffer device addresses need Vulkan 1.2 or VK_KHR_buffer_device_address). Buffers are referenced by their device address.
+ * Sets are sub-allocated linearly and all freed at once by kvfDescriptorBufferReset once the GPU is done with them,
+ * typically with one descriptor buffer per frame in flight. Not thread safe.
+ */
+void kvfFillDescriptorBufferFeatures(VkPhysicalDeviceDescriptorBufferFeaturesEXT* descriptor_buffer, VkPhysicalDeviceBufferDeviceAddressFeatures* device_address); // Resets both and chains device_address after descriptor_buffer
+KvfDescriptorBuffer* kvfCreateDescriptorBuffer(VkDevice device, VkDeviceSize size);
+void kvfDestroyDescriptorBuffer(KvfDescriptorBuffer* descriptor_buffer); // Must not be in use anymore
+VkDeviceSize kvfDescriptorBufferAllocate(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout); // Returns the offset of the set in the buffer
+void kvfDescriptorBufferWriteBuffer(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout, VkDeviceSize set_offset, uint32_t binding, uint32_t array_element, VkDescriptorType type, VkDeviceAddress address, VkDeviceSize range);
+void kvfDescriptorBufferWriteImage(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout, VkDeviceSize set_offset, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkDescriptorImageInfo* info); // Also writes sampler descriptors
+void kvfDescriptorBufferReset(KvfDescriptorBuffer* descriptor_buffer);
+VkDeviceSize kvfDescriptorBufferGetUsedSize(KvfDescriptorBuffer* descriptor_buffer);
+void kvfDescriptorBufferBind(VkCommandBuffer cmd, KvfDescriptorBuffer* descriptor_buffer); // Binds the buffer at index 0
+void kvfDescriptorBufferBindSet(VkCommandBuffer cmd, KvfDescriptorBuffer* descriptor_buffer, VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t set, VkDeviceSize set_offset); // Replaces vkCmdBindDescriptorSets
 
 VkPipelineLayout kvfCreatePipelineLayout(VkDevice device, VkDescriptorSetLayout* set_layouts, size_t set_layouts_count, VkPushConstantRange* pc, size_t pc_count);
 void kvfDestroyPipelineLayout(VkDevice device, VkPipelineLayout layout);
 
+/**
+ * Cached layouts are shared between identical creation parameters and reference counted, each acquire must be matched
+ * by a release. Set layouts match on their flags and bindings, in the order given, immutable samplers included.
+ * Pipeline layouts match on their set layouts and push constant ranges, and keep a reference to the set layouts they use,
+ * which must themselves come from kvfAcquireDescriptorSetLayout since handles created elsewhere could be destroyed and reused. Sharing handles keeps pipelines layout compatible so bound sets stay valid across pipeline switches.
+ * Cached layouts must not be destroyed with kvfDestroyDescriptorSetLayout or kvfDestroyPipelineLayout.
+ * Layouts still referenced when the device is destroyed are destroyed with it. Not thread safe.
+ */
+VkDescriptorSetLayout kvfAcquireDescriptorSetLayout(VkDevice device, const VkDescriptorSetLayoutBinding* bindings, size_t bindings_count, VkDescriptorSetLayoutCreateFlags flags);
+void kvfReleaseDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout layout);
+VkPipelineLayout kvfAcquirePipelineLayout(VkDevice device, const VkDescriptorSetLayout* set_layouts, size_t set_layouts_count, const VkPushConstantRange* pc, size_t pc_count);
+void kvfReleasePipelineLayout(VkDevice device, VkPipelineLayout layout);
+size_t kvfGetCachedDescriptorSetLayoutsCount(VkDevice device);
+size_t kvfGetCachedPipelineLayoutsCount(VkDevice device);
+
 KvfGraphicsPipelineBuilder* kvfCreateGPipelineBuilder();
 void kvfDestroyGPipelineBuilder(KvfGraphicsPipelineBuilder* builder);
 
@@ -316,6 +688,18 @@ void kvfGPipelineBuilderResetShaderStages(KvfGraphicsPipelineBuilder* builder);
 VkPipeline kvfCreateGraphicsPipeline(VkDevice device, VkPipelineCache cache, VkPipelineLayout layout, KvfGraphicsPipelineBuilder* builder, VkRenderPass pass);
 void kvfDestroyPipeline(VkDevice device, VkPipeline pipeline);
 
+/**
+ * Pipeline caches persisted on disk. Files wrap the driver's cache data with a size and a checksum, and are ignored,
+ * giving an empty cache, when they are corrupted or when the driver's header does not match the device's vendor ID,
+ * device ID and pipelineCacheUUID. Caches filled by several threads can be merged into one before saving.
+ * Saving writes a temporary file next to path, flushes it to the disk and renames it over path, so a crash never leaves
+ * a truncated cache.
+ */
+VkPipelineCache kvfCreatePipelineCache(VkDevice device, const char* path, bool* loaded); // path can be NULL for an empty cache, loaded can be NULL
+void kvfDestroyPipelineCache(VkDevice device, VkPipelineCache cache);
+void kvfMergePipelineCaches(VkDevice device, VkPipelineCache dst, const VkPipelineCache* srcs, uint32_t srcs_count);
+bool kvfSavePipelineCache(VkDevice device, VkPipelineCache cache, const char* path); // Returns false if the file could not be written
+
 void kvfCheckVk(VkResult result);
 int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
 
@@ -344,6 +728,7 @@ int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetPhysicalDeviceImageFormatProperties);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetPhysicalDeviceMemoryProperties);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetPhysicalDeviceProperties);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetPhysicalDeviceProperties2);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetPhysicalDeviceQueueFamilyProperties);
 		#ifndef KVF_NO_KHR
 			KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroySurfaceKHR);
@@ -394,23 +779,31 @@ int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter
 	{
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkAllocateCommandBuffers);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkAllocateDescriptorSets);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkAllocateMemory);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkBeginCommandBuffer);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkBindBufferMemory);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkBindImageMemory);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdBeginRenderPass);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdBindDescriptorBuffersEXT);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdBlitImage);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdCopyBuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdCopyBufferToImage);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdCopyImage);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdCopyImageToBuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdEndRenderPass);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdPipelineBarrier);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdSetDescriptorBufferOffsetsEXT);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateBuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateCommandPool);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateDescriptorPool);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateDescriptorSetLayout);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateDescriptorUpdateTemplate);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateFence);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateFramebuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateGraphicsPipelines);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateImage);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateImageView);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreatePipelineCache);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreatePipelineLayout);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateRenderPass);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateSampler);
@@ -420,12 +813,14 @@ int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyCommandPool);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyDescriptorPool);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyDescriptorSetLayout);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyDescriptorUpdateTemplate);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyDevice);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyFence);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyFramebuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyImage);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyImageView);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyPipeline);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyPipelineCache);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyPipelineLayout);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroyRenderPass);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroySampler);
@@ -434,16 +829,32 @@ int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDeviceWaitIdle);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkEndCommandBuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkFreeCommandBuffers);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkFreeDescriptorSets);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkFreeMemory);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetBufferDeviceAddress);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetBufferMemoryRequirements);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetDescriptorEXT);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetDescriptorSetLayoutBindingOffsetEXT);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetDescriptorSetLayoutSizeEXT);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetDeviceQueue);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetFenceStatus);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetImageMemoryRequirements);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetImageSubresourceLayout);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetPipelineCacheData);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkInvalidateMappedMemoryRanges);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkMapMemory);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkMergePipelineCaches);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkQueueSubmit);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkResetCommandBuffer);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkResetDescriptorPool);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkResetEvent);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkResetFences);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkUnmapMemory);
+		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkUpdateDescriptorSetWithTemplate);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkUpdateDescriptorSets);
 		KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkWaitForFences);
 		#ifndef KVF_NO_KHR
+			KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCmdPushDescriptorSetKHR);
 			KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkCreateSwapchainKHR);
 			KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkDestroySwapchainKHR);
 			KVF_DEFINE_VULKAN_FUNCTION_PROTOTYPE(vkGetSwapchainImagesKHR);
@@ -490,16 +901,52 @@ int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef KVF_DESCRIPTOR_POOL_CAPACITY
-	#undef KVF_DESCRIPTOR_POOL_CAPACITY
+#ifdef _WIN32
+	#include <io.h>
+	#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+	#include <unistd.h>
+#endif
+
+#ifndef KVF_DESCRIPTOR_POOL_CAPACITY
+	#define KVF_DESCRIPTOR_POOL_CAPACITY 1024 // Max sets of the first pool
 #endif
-#define KVF_DESCRIPTOR_POOL_CAPACITY 1024
+#ifndef KVF_DESCRIPTOR_POOL_MAX_CAPACITY
+	#define KVF_DESCRIPTOR_POOL_MAX_CAPACITY 16384
+#endif
+#define __KVF_DESCRIPTOR_TYPE_COUNT (VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1) // Core descriptor types
+#define __KVF_SETLESS_LAYOUT_FLAGS (VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR | VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT)
+#define __KVF_NO_BINDING_OFFSET (~(VkDeviceSize)0) // Binding numbers skipped by sparse layouts
 
 #ifdef KVF_COMMAND_POOL_CAPACITY
 	#undef KVF_COMMAND_POOL_CAPACITY
 #endif
 #define KVF_COMMAND_POOL_CAPACITY 1024
 
+#ifndef KVF_SCRATCH_BLOCK_SIZE
+	#define KVF_SCRATCH_BLOCK_SIZE 16384
+#endif
+#define KVF_SCRATCH_ALIGNMENT 16
+
+// Allocation tracking buckets, core object types are used as is
+#define KVF_TRACKING_BUCKET_SURFACE (VK_OBJECT_TYPE_COMMAND_POOL + 1)
+#define KVF_TRACKING_BUCKET_SWAPCHAIN (VK_OBJECT_TYPE_COMMAND_POOL + 2)
+#define KVF_TRACKING_BUCKET_DEBUG_MESSENGER (VK_OBJECT_TYPE_COMMAND_POOL + 3)
+#define KVF_TRACKING_BUCKET_DESCRIPTOR_UPDATE_TEMPLATE (VK_OBJECT_TYPE_COMMAND_POOL + 4)
+#define KVF_TRACKING_BUCKET_OTHER (VK_OBJECT_TYPE_COMMAND_POOL + 5)
+#define KVF_TRACKING_BUCKET_COUNT (VK_OBJECT_TYPE_COMMAND_POOL + 6)
+#define KVF_TRACKING_SCOPE_COUNT (VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1)
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+	#define KVF_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+	#define KVF_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+	#define KVF_THREAD_LOCAL __declspec(thread)
+#else
+	#define KVF_THREAD_LOCAL __thread
+#endif
+
 typedef struct
 {
 	int32_t graphics;
@@ -512,23 +959,161 @@ typedef struct __KvfDescriptorPool
 	VkDescriptorPool pool;
 	size_t capacity;
 	size_t size;
+	uint32_t descriptors_capacity[__KVF_DESCRIPTOR_TYPE_COUNT];
+	uint32_t descriptors_size[__KVF_DESCRIPTOR_TYPE_COUNT];
+	bool full; // Set when the driver ran out of pool memory, until the next reset
 } __KvfDescriptorPool;
 
+typedef struct __KvfDescriptorSetLayoutInfo
+{
+	VkDescriptorSetLayout layout;
+	VkDescriptorSetLayoutCreateFlags flags;
+	VkDescriptorUpdateTemplate update_template; // Created on first use
+	VkDescriptorUpdateTemplateEntry* template_entries;
+	uint32_t template_entries_count;
+	size_t template_data_size;
+	VkDeviceSize* binding_offsets; // Indexed by binding number, only for descriptor buffer layouts, __KVF_NO_BINDING_OFFSET for missing bindings
+	uint32_t binding_offsets_count;
+	VkDeviceSize descriptor_buffer_size;
+	uint32_t counts[__KVF_DESCRIPTOR_TYPE_COUNT];
+} __KvfDescriptorSetLayoutInfo;
+
+typedef struct __KvfDescriptorBufferFunctions
+{
+	PFN_vkCmdBindDescriptorBuffersEXT vkCmdBindDescriptorBuffersEXT;
+	PFN_vkCmdSetDescriptorBufferOffsetsEXT vkCmdSetDescriptorBufferOffsetsEXT;
+	PFN_vkGetBufferDeviceAddress vkGetBufferDeviceAddress;
+	PFN_vkGetDescriptorEXT vkGetDescriptorEXT;
+	PFN_vkGetDescriptorSetLayoutBindingOffsetEXT vkGetDescriptorSetLayoutBindingOffsetEXT;
+	PFN_vkGetDescriptorSetLayoutSizeEXT vkGetDescriptorSetLayoutSizeEXT;
+	bool loaded;
+} __KvfDescriptorBufferFunctions;
+
+typedef struct __KvfTrackingContext
+{
+	VkAllocationCallbacks parent;
+	bool has_parent;
+	uint32_t bucket;
+} __KvfTrackingContext;
+
+typedef struct __KvfAllocationHeader
+{
+	void* raw;
+	size_t size;
+	uint32_t scope;
+	uint32_t bucket;
+} __KvfAllocationHeader; // Stored right before each tracked allocation
+
+#define KVF_TRACKING_HEADER_SIZE ((sizeof(__KvfAllocationHeader) + 15) & ~(size_t)15)
+
+typedef struct __KvfSamplerCacheEntry
+{
+	KvfSamplerDescription description;
+	VkSampler sampler; // VK_NULL_HANDLE for empty slots
+	uint32_t hash;
+	uint32_t references;
+} __KvfSamplerCacheEntry;
+
+typedef struct __KvfImageViewCacheKey
+{
+	VkImage image;
+	VkFormat format;
+	VkImageViewType type;
+	VkImageSubresourceRange range;
+} __KvfImageViewCacheKey;
+
+typedef struct __KvfImageViewCacheEntry
+{
+	__KvfImageViewCacheKey key;
+	VkImageView view; // VK_NULL_HANDLE for empty slots
+	uint32_t hash;
+} __KvfImageViewCacheEntry;
+
+typedef struct __KvfDescriptorSetCacheEntry
+{
+	VkDescriptorSetLayout layout;
+	VkDescriptorSet set; // VK_NULL_HANDLE for empty slots
+	void* data; // Normalized copy of the bound resources, padding zeroed
+	size_t data_size;
+	size_t pool_index;
+	uint64_t last_used_frame;
+	uint32_t counts[__KVF_DESCRIPTOR_TYPE_COUNT]; // Descriptors taken from the pool, the layout may be gone when the set is freed
+	uint32_t hash;
+	bool orphaned; // Layout destroyed, never matched again
+} __KvfDescriptorSetCacheEntry;
+
+typedef struct __KvfDescriptorSetCacheInvalidation
+{
+	uint64_t handle; // 0 for empty slots of the lookup table
+	VkObjectType type; // VK_OBJECT_TYPE_BUFFER, VK_OBJECT_TYPE_IMAGE_VIEW or VK_OBJECT_TYPE_BUFFER_VIEW
+} __KvfDescriptorSetCacheInvalidation;
+
+typedef struct __KvfLayoutCacheEntry
+{
+	uint64_t* key; // Packed creation parameters
+	size_t key_size; // In words
+	uint64_t layout; // VkDescriptorSetLayout or VkPipelineLayout, 0 for empty slots
+	uint32_t hash;
+	uint32_t references;
+} __KvfLayoutCacheEntry;
+
+typedef struct __KvfLayoutCacheHandle
+{
+	uint64_t layout; // 0 for empty slots
+	const uint64_t* key; // The entry's key, its address does not change when entries move
+	size_t key_size;
+	uint32_t hash; // Of the key
+} __KvfLayoutCacheHandle;
+
+typedef struct __KvfLayoutCache
+{
+	__KvfLayoutCacheEntry* entries; // Open addressing hash table, capacity is a power of two
+	__KvfLayoutCacheHandle* handles; // Same with the same capacity, to find entries from their layout
+	size_t size;
+	size_t capacity;
+} __KvfLayoutCache;
+
 typedef struct __KvfDevice
 {
 	__KvfQueueFamilies queues;
 	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
 		KvfDeviceVulkanFunctions fns;
+	#else
+		PFN_vkCmdPushDescriptorSetKHR push_descriptor_set; // Not exported by the loader, resolved on first use
 	#endif
 	VkDevice device;
 	VkAllocationCallbacks* callbacks;
+	VkAllocationCallbacks* tracking_callbacks; // One per tracking bucket, NULL until tracking is enabled
+	__KvfTrackingContext* tracking_contexts;
 	VkPhysicalDevice physical;
 	VkCommandPool cmd_pool;
 	VkCommandBuffer* cmd_buffers;
 	__KvfDescriptorPool* sets_pools;
+	__KvfDescriptorSetLayoutInfo* set_layouts;
+	__KvfSamplerCacheEntry* samplers; // Open addressing hash table, capacity is a power of two
+	__KvfImageViewCacheEntry* image_views; // Same
+	__KvfDescriptorSetCacheEntry* descriptor_sets; // Same
+	__KvfDescriptorSetCacheInvalidation* descriptor_sets_invalidations; // Resources destroyed since the last scan of the cached sets
+	__KvfLayoutCache set_layouts_cache;
+	__KvfLayoutCache pipeline_layouts_cache;
+	__KvfDescriptorBufferFunctions descriptor_buffer_fns; // Loaded on first use
 	size_t cmd_buffers_size;
 	size_t cmd_buffers_capacity;
 	size_t sets_pools_size;
+	size_t sets_pools_failed_allocations;
+	size_t set_layouts_size;
+	size_t set_layouts_capacity;
+	size_t samplers_size;
+	size_t samplers_capacity;
+	size_t image_views_size;
+	size_t image_views_capacity;
+	size_t descriptor_sets_size;
+	size_t descriptor_sets_capacity;
+	size_t descriptor_sets_invalidations_size;
+	size_t descriptor_sets_invalidations_capacity;
+	uint64_t descriptor_sets_frame;
+	float max_sampler_anisotropy; // Queried on first use, 0 until then
+	float descriptor_ratios[__KVF_DESCRIPTOR_TYPE_COUNT];
 } __KvfDevice;
 
 #ifndef KVF_NO_KHR
@@ -557,6 +1142,37 @@ typedef struct __KvfFramebuffer
 	VkExtent2D extent;
 } __KvfFramebuffer;
 
+typedef struct __KvfImageState
+{
+	VkImageLayout layout;
+	VkAccessFlags access; // Last write, or readers accumulated since then
+	VkPipelineStageFlags stage;
+	VkAccessFlags write_access; // Last write that later readers must wait for
+	VkPipelineStageFlags write_stage; // Stages of the last write and of the following layout transition, 0 when there is nothing to wait for
+} __KvfImageState;
+
+typedef struct __KvfTrackedImage
+{
+	VkImage image;
+	VkFormat format;
+	uint32_t mip_levels;
+	uint32_t array_layers;
+	__KvfImageState* states; // mip_levels * array_layers, indexed by mip * array_layers + layer
+} __KvfTrackedImage;
+
+typedef struct __KvfScratchBlock
+{
+	struct __KvfScratchBlock* next;
+	size_t capacity;
+	size_t offset;
+} __KvfScratchBlock; // Block data directly follows the header
+
+typedef struct __KvfScratchMarker
+{
+	__KvfScratchBlock* block;
+	size_t offset;
+} __KvfScratchMarker;
+
 struct KvfGraphicsPipelineBuilder
 {
 	VkPipelineShaderStageCreateInfo* shader_stages;
@@ -570,6 +1186,438 @@ struct KvfGraphicsPipelineBuilder
 	size_t shader_stages_count;
 };
 
+typedef struct __KvfAliasedImage
+{
+	VkImage image;
+	VkMemoryRequirements requirements;
+	VkDeviceSize offset;
+	uint32_t first_use;
+	uint32_t last_use;
+	int32_t memory_type;
+} __KvfAliasedImage;
+
+struct KvfAliasingAllocator
+{
+	VkDevice device;
+	__KvfAliasedImage* images;
+	VkDeviceMemory* memories;
+	size_t images_size;
+	size_t images_capacity;
+	size_t memories_size;
+	VkDeviceSize memory_size;
+	VkDeviceSize unaliased_size;
+	bool baked;
+};
+
+typedef struct __KvfTextureUpload
+{
+	VkImage image;
+	VkFormat format;
+	VkExtent3D extent;
+	const uint8_t* data;
+	uint32_t block_size;
+	uint32_t block_width;
+	uint32_t block_height;
+	uint32_t mip_levels;
+	uint32_t array_layers;
+	uint32_t mip; // Mip being uploaded, goes from the coarsest to 0
+	uint32_t layer; // Cursor inside the current mip
+	uint32_t z;
+	uint32_t y; // In block rows
+	bool started;
+	bool completed;
+} __KvfTextureUpload;
+
+struct KvfTextureUploader
+{
+	VkDevice device;
+	VkBuffer staging;
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	VkDeviceSize bytes_per_frame;
+	uint32_t frames_in_flight;
+	uint32_t frame;
+	__KvfTextureUpload* uploads;
+	size_t uploads_size;
+	size_t uploads_capacity;
+	VkBufferImageCopy* regions;
+	VkImage* regions_images;
+	size_t regions_size;
+	size_t regions_capacity;
+	KvfBarrierBatch* pre_barriers;
+	KvfBarrierBatch* post_barriers;
+};
+
+typedef enum
+{
+	__KVF_READBACK_FREE = 0,
+	__KVF_READBACK_RECORDED = 1,
+	__KVF_READBACK_PENDING = 2,
+	__KVF_READBACK_READY = 3,
+} __KvfReadbackState;
+
+typedef struct __KvfReadbackSlot
+{
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	int32_t fence; // Index in the queue's fences, -1 until submitted
+	uint32_t generation;
+	__KvfReadbackState state;
+} __KvfReadbackSlot;
+
+typedef struct __KvfReadbackFence
+{
+	VkFence fence;
+	uint32_t users;
+} __KvfReadbackFence;
+
+struct KvfReadbackQueue
+{
+	VkDevice device;
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	bool coherent;
+	VkDeviceSize slot_size;
+	__KvfReadbackSlot* slots;
+	uint32_t slots_count;
+	uint32_t next_slot;
+	__KvfReadbackFence* fences;
+	uint32_t fences_count; // At most one fence per slot
+};
+
+typedef struct __KvfOffscreenFrame
+{
+	VkImage color;
+	VkDeviceMemory color_memory;
+	VkImageView color_view;
+	VkImage depth;
+	VkDeviceMemory depth_memory;
+	VkImageView depth_view;
+	VkFramebuffer framebuffer;
+} __KvfOffscreenFrame;
+
+struct KvfOffscreenTarget
+{
+	VkDevice device;
+	VkRenderPass render_pass;
+	KvfReadbackQueue* readbacks;
+	__KvfOffscreenFrame* frames;
+	VkExtent2D extent;
+	VkFormat color_format;
+	VkFormat depth_format;
+	uint32_t frames_count;
+};
+
+typedef struct __KvfDescriptorFrame
+{
+	__KvfDescriptorPool* pools;
+	size_t pools_size;
+	size_t current_pool; // Pools before this one are full
+	size_t failed_allocations;
+} __KvfDescriptorFrame;
+
+struct KvfDescriptorFrameRing
+{
+	VkDevice device;
+	__KvfDescriptorFrame* frames;
+	size_t sets_per_pool;
+	uint32_t frames_count;
+	uint32_t current_frame;
+};
+
+struct KvfDescriptorWriteBatch
+{
+	VkDevice device;
+	VkWriteDescriptorSet* writes; // Info pointers are only set on flush as the infos arrays may move
+	VkDescriptorBufferInfo* buffer_infos;
+	VkDescriptorImageInfo* image_infos;
+	VkBufferView* texel_views;
+	size_t writes_size;
+	size_t writes_capacity;
+	size_t buffer_infos_size;
+	size_t buffer_infos_capacity;
+	size_t image_infos_size;
+	size_t image_infos_capacity;
+	size_t texel_views_size;
+	size_t texel_views_capacity;
+};
+
+#define __KVF_BINDLESS_RESOURCE_TYPE_COUNT 3
+
+#define __KVF_BINDLESS_INDEX_FREE 0
+#define __KVF_BINDLESS_INDEX_LIVE 1
+#define __KVF_BINDLESS_INDEX_PENDING 2 // Released, waiting for the GPU
+
+typedef struct __KvfBindlessRelease
+{
+	uint64_t frame;
+	uint32_t index;
+} __KvfBindlessRelease;
+
+typedef struct __KvfBindlessArray
+{
+	uint32_t* free_indices; // Recycled indices, handed out before new ones
+	__KvfBindlessRelease* releases; // Waiting for the GPU, in release order
+	uint8_t* states; // __KVF_BINDLESS_INDEX_* per index, catches double releases that would hand one slot out twice
+	size_t free_indices_size;
+	size_t free_indices_capacity;
+	size_t releases_size;
+	size_t releases_capacity;
+	uint32_t capacity;
+	uint32_t next_index; // Indices from this one have never been handed out
+} __KvfBindlessArray;
+
+struct KvfBindlessTable
+{
+	VkDevice device;
+	VkDescriptorPool pool;
+	VkDescriptorSetLayout layout;
+	VkDescriptorSet set;
+	KvfDescriptorWriteBatch* writes;
+	__KvfBindlessArray arrays[__KVF_BINDLESS_RESOURCE_TYPE_COUNT];
+	uint64_t frame;
+	uint32_t frames_in_flight;
+};
+
+struct KvfDescriptorBuffer
+{
+	VkDevice device;
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	VkDeviceAddress address;
+	VkDeviceSize size;
+	VkDeviceSize used;
+	VkPhysicalDeviceDescriptorBufferPropertiesEXT properties;
+};
+
+#define __KVF_PIPELINE_CACHE_FILE_MAGIC 0x5046564B // "KVFP"
+#define __KVF_PIPELINE_CACHE_FILE_VERSION 1
+
+typedef struct __KvfPipelineCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t data_size;
+	uint32_t checksum; // Hash of the driver's data
+	uint32_t reserved;
+} __KvfPipelineCacheFileHeader;
+
+struct KvfBarrierBatch
+{
+	VkImageMemoryBarrier* image_barriers;
+	VkBufferMemoryBarrier* buffer_barriers;
+	size_t image_barriers_size;
+	size_t image_barriers_capacity;
+	size_t buffer_barriers_size;
+	size_t buffer_barriers_capacity;
+	VkPipelineStageFlags src_stages;
+	VkPipelineStageFlags dst_stages;
+};
+
+#define __KVF_FORMAT_COMPRESSED 0x1
+#define __KVF_FORMAT_DEPTH 0x2
+#define __KVF_FORMAT_STENCIL 0x4
+#define __KVF_FORMAT_SRGB 0x8
+
+typedef struct __KvfFormatTableEntry
+{
+	uint8_t block_size;
+	uint8_t block_width;
+	uint8_t block_height;
+	uint8_t flags;
+} __KvfFormatTableEntry;
+
+// Indexed by VkFormat, Vulkan 1.0 formats are contiguous
+static const __KvfFormatTableEntry __kvf_format_table[] = {
+	{ 0, 1, 1, 0 }, // VK_FORMAT_UNDEFINED
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R4G4_UNORM_PACK8
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R4G4B4A4_UNORM_PACK16
+	{ 2, 1, 1, 0 }, // VK_FORMAT_B4G4R4A4_UNORM_PACK16
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R5G6B5_UNORM_PACK16
+	{ 2, 1, 1, 0 }, // VK_FORMAT_B5G6R5_UNORM_PACK16
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R5G5B5A1_UNORM_PACK16
+	{ 2, 1, 1, 0 }, // VK_FORMAT_B5G5R5A1_UNORM_PACK16
+	{ 2, 1, 1, 0 }, // VK_FORMAT_A1R5G5B5_UNORM_PACK16
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R8_UNORM
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R8_SNORM
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R8_USCALED
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R8_SSCALED
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R8_UINT
+	{ 1, 1, 1, 0 }, // VK_FORMAT_R8_SINT
+	{ 1, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_R8_SRGB
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R8G8_UNORM
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R8G8_SNORM
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R8G8_USCALED
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R8G8_SSCALED
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R8G8_UINT
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R8G8_SINT
+	{ 2, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_R8G8_SRGB
+	{ 3, 1, 1, 0 }, // VK_FORMAT_R8G8B8_UNORM
+	{ 3, 1, 1, 0 }, // VK_FORMAT_R8G8B8_SNORM
+	{ 3, 1, 1, 0 }, // VK_FORMAT_R8G8B8_USCALED
+	{ 3, 1, 1, 0 }, // VK_FORMAT_R8G8B8_SSCALED
+	{ 3, 1, 1, 0 }, // VK_FORMAT_R8G8B8_UINT
+	{ 3, 1, 1, 0 }, // VK_FORMAT_R8G8B8_SINT
+	{ 3, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_R8G8B8_SRGB
+	{ 3, 1, 1, 0 }, // VK_FORMAT_B8G8R8_UNORM
+	{ 3, 1, 1, 0 }, // VK_FORMAT_B8G8R8_SNORM
+	{ 3, 1, 1, 0 }, // VK_FORMAT_B8G8R8_USCALED
+	{ 3, 1, 1, 0 }, // VK_FORMAT_B8G8R8_SSCALED
+	{ 3, 1, 1, 0 }, // VK_FORMAT_B8G8R8_UINT
+	{ 3, 1, 1, 0 }, // VK_FORMAT_B8G8R8_SINT
+	{ 3, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_B8G8R8_SRGB
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R8G8B8A8_UNORM
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R8G8B8A8_SNORM
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R8G8B8A8_USCALED
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R8G8B8A8_SSCALED
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R8G8B8A8_UINT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R8G8B8A8_SINT
+	{ 4, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_R8G8B8A8_SRGB
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B8G8R8A8_UNORM
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B8G8R8A8_SNORM
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B8G8R8A8_USCALED
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B8G8R8A8_SSCALED
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B8G8R8A8_UINT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B8G8R8A8_SINT
+	{ 4, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_B8G8R8A8_SRGB
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A8B8G8R8_UNORM_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A8B8G8R8_SNORM_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A8B8G8R8_USCALED_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A8B8G8R8_SSCALED_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A8B8G8R8_UINT_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A8B8G8R8_SINT_PACK32
+	{ 4, 1, 1, __KVF_FORMAT_SRGB }, // VK_FORMAT_A8B8G8R8_SRGB_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2R10G10B10_UNORM_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2R10G10B10_SNORM_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2R10G10B10_USCALED_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2R10G10B10_SSCALED_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2R10G10B10_UINT_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2R10G10B10_SINT_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2B10G10R10_UNORM_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2B10G10R10_SNORM_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2B10G10R10_USCALED_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2B10G10R10_SSCALED_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2B10G10R10_UINT_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_A2B10G10R10_SINT_PACK32
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_UNORM
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_SNORM
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_USCALED
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_SSCALED
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_UINT
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_SINT
+	{ 2, 1, 1, 0 }, // VK_FORMAT_R16_SFLOAT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_UNORM
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_SNORM
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_USCALED
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_SSCALED
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_UINT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_SINT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R16G16_SFLOAT
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_UNORM
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_SNORM
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_USCALED
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_SSCALED
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_UINT
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_SINT
+	{ 6, 1, 1, 0 }, // VK_FORMAT_R16G16B16_SFLOAT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_UNORM
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_SNORM
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_USCALED
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_SSCALED
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_UINT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_SINT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R16G16B16A16_SFLOAT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R32_UINT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R32_SINT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_R32_SFLOAT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R32G32_UINT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R32G32_SINT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R32G32_SFLOAT
+	{ 12, 1, 1, 0 }, // VK_FORMAT_R32G32B32_UINT
+	{ 12, 1, 1, 0 }, // VK_FORMAT_R32G32B32_SINT
+	{ 12, 1, 1, 0 }, // VK_FORMAT_R32G32B32_SFLOAT
+	{ 16, 1, 1, 0 }, // VK_FORMAT_R32G32B32A32_UINT
+	{ 16, 1, 1, 0 }, // VK_FORMAT_R32G32B32A32_SINT
+	{ 16, 1, 1, 0 }, // VK_FORMAT_R32G32B32A32_SFLOAT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R64_UINT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R64_SINT
+	{ 8, 1, 1, 0 }, // VK_FORMAT_R64_SFLOAT
+	{ 16, 1, 1, 0 }, // VK_FORMAT_R64G64_UINT
+	{ 16, 1, 1, 0 }, // VK_FORMAT_R64G64_SINT
+	{ 16, 1, 1, 0 }, // VK_FORMAT_R64G64_SFLOAT
+	{ 24, 1, 1, 0 }, // VK_FORMAT_R64G64B64_UINT
+	{ 24, 1, 1, 0 }, // VK_FORMAT_R64G64B64_SINT
+	{ 24, 1, 1, 0 }, // VK_FORMAT_R64G64B64_SFLOAT
+	{ 32, 1, 1, 0 }, // VK_FORMAT_R64G64B64A64_UINT
+	{ 32, 1, 1, 0 }, // VK_FORMAT_R64G64B64A64_SINT
+	{ 32, 1, 1, 0 }, // VK_FORMAT_R64G64B64A64_SFLOAT
+	{ 4, 1, 1, 0 }, // VK_FORMAT_B10G11R11_UFLOAT_PACK32
+	{ 4, 1, 1, 0 }, // VK_FORMAT_E5B9G9R9_UFLOAT_PACK32
+	{ 2, 1, 1, __KVF_FORMAT_DEPTH }, // VK_FORMAT_D16_UNORM
+	{ 4, 1, 1, __KVF_FORMAT_DEPTH }, // VK_FORMAT_X8_D24_UNORM_PACK32
+	{ 4, 1, 1, __KVF_FORMAT_DEPTH }, // VK_FORMAT_D32_SFLOAT
+	{ 1, 1, 1, __KVF_FORMAT_STENCIL }, // VK_FORMAT_S8_UINT
+	{ 0, 1, 1, __KVF_FORMAT_DEPTH | __KVF_FORMAT_STENCIL }, // VK_FORMAT_D16_UNORM_S8_UINT, no packed layout covers both aspects
+	{ 0, 1, 1, __KVF_FORMAT_DEPTH | __KVF_FORMAT_STENCIL }, // VK_FORMAT_D24_UNORM_S8_UINT
+	{ 0, 1, 1, __KVF_FORMAT_DEPTH | __KVF_FORMAT_STENCIL }, // VK_FORMAT_D32_SFLOAT_S8_UINT
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC2_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_BC2_SRGB_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC3_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_BC3_SRGB_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC4_UNORM_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC4_SNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC5_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC5_SNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC6H_UFLOAT_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC6H_SFLOAT_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_BC7_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_BC7_SRGB_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_EAC_R11_UNORM_BLOCK
+	{ 8, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_EAC_R11_SNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_EAC_R11G11_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_EAC_R11G11_SNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+	{ 16, 4, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_4x4_SRGB_BLOCK
+	{ 16, 5, 4, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_5x4_UNORM_BLOCK
+	{ 16, 5, 4, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_5x4_SRGB_BLOCK
+	{ 16, 5, 5, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_5x5_UNORM_BLOCK
+	{ 16, 5, 5, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_5x5_SRGB_BLOCK
+	{ 16, 6, 5, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_6x5_UNORM_BLOCK
+	{ 16, 6, 5, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_6x5_SRGB_BLOCK
+	{ 16, 6, 6, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_6x6_UNORM_BLOCK
+	{ 16, 6, 6, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_6x6_SRGB_BLOCK
+	{ 16, 8, 5, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_8x5_UNORM_BLOCK
+	{ 16, 8, 5, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_8x5_SRGB_BLOCK
+	{ 16, 8, 6, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_8x6_UNORM_BLOCK
+	{ 16, 8, 6, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_8x6_SRGB_BLOCK
+	{ 16, 8, 8, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_8x8_UNORM_BLOCK
+	{ 16, 8, 8, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_8x8_SRGB_BLOCK
+	{ 16, 10, 5, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_10x5_UNORM_BLOCK
+	{ 16, 10, 5, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_10x5_SRGB_BLOCK
+	{ 16, 10, 6, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_10x6_UNORM_BLOCK
+	{ 16, 10, 6, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_10x6_SRGB_BLOCK
+	{ 16, 10, 8, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_10x8_UNORM_BLOCK
+	{ 16, 10, 8, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_10x8_SRGB_BLOCK
+	{ 16, 10, 10, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_10x10_UNORM_BLOCK
+	{ 16, 10, 10, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_10x10_SRGB_BLOCK
+	{ 16, 12, 10, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_12x10_UNORM_BLOCK
+	{ 16, 12, 10, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_12x10_SRGB_BLOCK
+	{ 16, 12, 12, __KVF_FORMAT_COMPRESSED }, // VK_FORMAT_ASTC_12x12_UNORM_BLOCK
+	{ 16, 12, 12, __KVF_FORMAT_COMPRESSED | __KVF_FORMAT_SRGB }, // VK_FORMAT_ASTC_12x12_SRGB_BLOCK
+};
+
 // Dynamic arrays
 static __KvfDevice* __kvf_internal_devices = NULL;
 static size_t __kvf_internal_devices_size = 0;
@@ -585,12 +1633,34 @@ static __KvfFramebuffer* __kvf_internal_framebuffers = NULL;
 static size_t __kvf_internal_framebuffers_size = 0;
 static size_t __kvf_internal_framebuffers_capacity = 0;
 
+static __KvfTrackedImage* __kvf_internal_tracked_images = NULL;
+static size_t __kvf_internal_tracked_images_size = 0;
+static size_t __kvf_internal_tracked_images_capacity = 0;
+static KvfImageStateStats __kvf_image_state_stats;
+
 #ifdef KVF_ENABLE_VALIDATION_LAYERS
 	static VkDebugUtilsMessengerEXT __kvf_debug_messenger = VK_NULL_HANDLE;
 	static char** __kvf_extra_layers = NULL;
 	static size_t __kvf_extra_layers_count = 0;
 #endif
 
+// Per-thread scratch arena
+static KVF_THREAD_LOCAL __KvfScratchBlock* __kvf_scratch_head = NULL;
+static KVF_THREAD_LOCAL __KvfScratchBlock* __kvf_scratch_current = NULL;
+
+static VkAllocationCallbacks __kvf_default_callbacks;
+static bool __kvf_has_default_callbacks = false;
+
+static uint32_t __kvf_internal_instance_api_version = 0;
+static size_t __kvf_internal_instances_count = 0;
+
+static bool __kvf_host_memory_tracking = false;
+static VkAllocationCallbacks __kvf_instance_tracking_callbacks[KVF_TRACKING_BUCKET_COUNT];
+static __KvfTrackingContext __kvf_instance_tracking_contexts[KVF_TRACKING_BUCKET_COUNT];
+static KvfHostMemoryStats __kvf_host_memory_scope_stats[KVF_TRACKING_SCOPE_COUNT];
+static KvfHostMemoryStats __kvf_host_memory_type_stats[KVF_TRACKING_BUCKET_COUNT];
+static KvfHostMemoryStats __kvf_host_memory_total_stats;
+
 static KvfErrorCallback __kvf_error_callback = NULL;
 static KvfErrorCallback __kvf_warning_callback = NULL;
 static KvfErrorCallback __kvf_validation_error_callback = NULL;
@@ -651,92 +1721,465 @@ int32_t kvfFindMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter
 	return -1;
 }
 
-void __kvfAddDeviceToArray(VkPhysicalDevice device, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue)
+__KvfScratchMarker __kvfScratchMark()
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	if(__kvf_internal_devices_size == __kvf_internal_devices_capacity)
+	__KvfScratchMarker marker;
+	marker.block = __kvf_scratch_current;
+	marker.offset = (__kvf_scratch_current != NULL ? __kvf_scratch_current->offset : 0);
+	return marker;
+}
+
+void __kvfScratchRewind(__KvfScratchMarker marker)
+{
+	if(marker.block == NULL)
 	{
-		// Resize the dynamic array if necessary
-		__kvf_internal_devices_capacity += 2;
-		__kvf_internal_devices = (__KvfDevice*)KVF_REALLOC(__kvf_internal_devices, __kvf_internal_devices_capacity * sizeof(__KvfDevice));
+		// Nothing was allocated when the marker was taken
+		__kvf_scratch_current = __kvf_scratch_head;
+		if(__kvf_scratch_current != NULL)
+			__kvf_scratch_current->offset = 0;
+		return;
 	}
-
-	__kvf_internal_devices[__kvf_internal_devices_size].physical = device;
-	__kvf_internal_devices[__kvf_internal_devices_size].queues.graphics = graphics_queue;
-	__kvf_internal_devices[__kvf_internal_devices_size].queues.compute = compute_queue;
-	__kvf_internal_devices[__kvf_internal_devices_size].queues.present = present_queue;
-	__kvf_internal_devices_size++;
+	__kvf_scratch_current = marker.block;
+	__kvf_scratch_current->offset = marker.offset;
 }
 
-void __kvfCompleteDevice(VkPhysicalDevice physical, VkDevice device)
+void* __kvfScratchTryPushInBlock(__KvfScratchBlock* block, size_t size)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(physical != VK_NULL_HANDLE);
+	uintptr_t data = (uintptr_t)(block + 1);
+	uintptr_t ptr = (data + block->offset + KVF_SCRATCH_ALIGNMENT - 1) & ~(uintptr_t)(KVF_SCRATCH_ALIGNMENT - 1);
+	if(ptr + size > data + block->capacity)
+		return NULL;
+	block->offset = (ptr - data) + size;
+	return (void*)ptr;
+}
 
-	__KvfDevice* kvf_device = NULL;
+// Memory returned is only valid until the next rewind to a marker taken before the push
+void* __kvfScratchPush(size_t size)
+{
+	if(size == 0)
+		size = 1;
+	if(__kvf_scratch_current != NULL)
+	{
+		void* ptr = __kvfScratchTryPushInBlock(__kvf_scratch_current, size);
+		if(ptr != NULL)
+			return ptr;
+		// Try to reuse the next block left by a previous rewind
+		__KvfScratchBlock* next = __kvf_scratch_current->next;
+		if(next != NULL)
+		{
+			next->offset = 0;
+			ptr = __kvfScratchTryPushInBlock(next, size);
+			if(ptr != NULL)
+			{
+				__kvf_scratch_current = next;
+				return ptr;
+			}
+		}
+	}
 
-	for(size_t i = 0; i < __kvf_internal_devices_size; i++)
+	size_t capacity = size + KVF_SCRATCH_ALIGNMENT;
+	if(capacity < KVF_SCRATCH_BLOCK_SIZE)
+		capacity = KVF_SCRATCH_BLOCK_SIZE;
+	__KvfScratchBlock* block = (__KvfScratchBlock*)KVF_MALLOC(sizeof(__KvfScratchBlock) + capacity);
+	KVF_ASSERT(block != NULL && "allocation failed :(");
+	block->capacity = capacity;
+	block->offset = 0;
+	if(__kvf_scratch_current != NULL)
 	{
-		if(__kvf_internal_devices[i].physical == physical)
-			kvf_device = &__kvf_internal_devices[i];
+		block->next = __kvf_scratch_current->next;
+		__kvf_scratch_current->next = block;
+	}
+	else
+	{
+		block->next = __kvf_scratch_head;
+		__kvf_scratch_head = block;
 	}
+	__kvf_scratch_current = block;
+	return __kvfScratchTryPushInBlock(block, size);
+}
 
-	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+#define __KVF_FNV_OFFSET_BASIS 2166136261u
+#define __KVF_FNV_PRIME 16777619u
 
-	VkCommandPool pool;
-	VkCommandPoolCreateInfo pool_info = {};
-	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	pool_info.queueFamilyIndex = kvf_device->queues.graphics;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateCommandPool)(device, &pool_info, NULL, &pool));
+// FNV-1a, the hash can be chained by passing the result of a previous call
+uint32_t __kvfHashBytes(const void* data, size_t size, uint32_t hash)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	for(size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= __KVF_FNV_PRIME;
+	}
+	return hash;
+}
 
-	kvf_device->device = device;
-	kvf_device->cmd_pool = pool;
-	kvf_device->callbacks = NULL;
-	kvf_device->sets_pools = NULL;
-	kvf_device->sets_pools_size = 0;
-	kvf_device->cmd_buffers_size = 0;
-	kvf_device->cmd_buffers_capacity = KVF_COMMAND_POOL_CAPACITY;
-	kvf_device->cmd_buffers = (VkCommandBuffer*)KVF_MALLOC(KVF_COMMAND_POOL_CAPACITY * sizeof(VkCommandBuffer));
-	KVF_ASSERT(kvf_device->cmd_buffers != NULL && "allocation failed :(");
+void kvfReleaseThreadScratchMemory()
+{
+	__KvfScratchBlock* block = __kvf_scratch_head;
+	while(block != NULL)
+	{
+		__KvfScratchBlock* next = block->next;
+		KVF_FREE(block);
+		block = next;
+	}
+	__kvf_scratch_head = NULL;
+	__kvf_scratch_current = NULL;
 }
 
-void __kvfCompleteDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical, VkDevice device, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue)
+uint32_t __kvfObjectTypeToTrackingBucket(VkObjectType type)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(physical != VK_NULL_HANDLE);
+	if((uint32_t)type <= (uint32_t)VK_OBJECT_TYPE_COMMAND_POOL)
+		return (uint32_t)type;
+	switch(type)
+	{
+		case VK_OBJECT_TYPE_SURFACE_KHR: return KVF_TRACKING_BUCKET_SURFACE;
+		case VK_OBJECT_TYPE_SWAPCHAIN_KHR: return KVF_TRACKING_BUCKET_SWAPCHAIN;
+		case VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT: return KVF_TRACKING_BUCKET_DEBUG_MESSENGER;
+		case VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE: return KVF_TRACKING_BUCKET_DESCRIPTOR_UPDATE_TEMPLATE;
 
-	__kvfAddDeviceToArray(physical, graphics_queue, present_queue, compute_queue);
+		default: return KVF_TRACKING_BUCKET_OTHER;
+	}
+	return KVF_TRACKING_BUCKET_OTHER;
+}
 
-	__KvfDevice* kvf_device = NULL;
+void __kvfHostMemoryStatsAdd(KvfHostMemoryStats* stats, size_t size)
+{
+	stats->live_bytes += size;
+	stats->live_allocations++;
+	stats->total_allocations++;
+	if(stats->live_bytes > stats->peak_bytes)
+		stats->peak_bytes = stats->live_bytes;
+}
 
-	for(size_t i = 0; i < __kvf_internal_devices_size; i++)
-	{
-		if(__kvf_internal_devices[i].physical == physical)
-			kvf_device = &__kvf_internal_devices[i];
-	}
+void __kvfHostMemoryStatsRemove(KvfHostMemoryStats* stats, size_t size)
+{
+	stats->live_bytes -= size;
+	stats->live_allocations--;
+}
 
-	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+void __kvfTrackHostAllocation(uint32_t bucket, VkSystemAllocationScope scope, size_t size)
+{
+	uint32_t scope_index = (uint32_t)scope < KVF_TRACKING_SCOPE_COUNT ? (uint32_t)scope : (uint32_t)VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+	__kvfHostMemoryStatsAdd(&__kvf_host_memory_scope_stats[scope_index], size);
+	__kvfHostMemoryStatsAdd(&__kvf_host_memory_type_stats[bucket], size);
+	__kvfHostMemoryStatsAdd(&__kvf_host_memory_total_stats, size);
+}
 
-	VkCommandPool pool;
-	VkCommandPoolCreateInfo pool_info = {};
-	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	pool_info.queueFamilyIndex = kvf_device->queues.graphics;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateCommandPool)(device, &pool_info, NULL, &pool));
+void __kvfTrackHostFree(uint32_t bucket, VkSystemAllocationScope scope, size_t size)
+{
+	uint32_t scope_index = (uint32_t)scope < KVF_TRACKING_SCOPE_COUNT ? (uint32_t)scope : (uint32_t)VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+	__kvfHostMemoryStatsRemove(&__kvf_host_memory_scope_stats[scope_index], size);
+	__kvfHostMemoryStatsRemove(&__kvf_host_memory_type_stats[bucket], size);
+	__kvfHostMemoryStatsRemove(&__kvf_host_memory_total_stats, size);
+}
 
+VKAPI_ATTR void* VKAPI_CALL __kvfTrackingAllocation(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	__KvfTrackingContext* context = (__KvfTrackingContext*)user_data;
+	if(size == 0)
+		return NULL;
+	if(alignment < 16)
+		alignment = 16;
+	size_t total = size + alignment + KVF_TRACKING_HEADER_SIZE;
+	void* raw = NULL;
+	if(context->has_parent)
+		raw = context->parent.pfnAllocation(context->parent.pUserData, total, alignment, scope);
+	else
+		raw = KVF_MALLOC(total);
+	if(raw == NULL)
+		return NULL;
+	uintptr_t ptr = ((uintptr_t)raw + KVF_TRACKING_HEADER_SIZE + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	__KvfAllocationHeader* header = (__KvfAllocationHeader*)(ptr - KVF_TRACKING_HEADER_SIZE);
+	header->raw = raw;
+	header->size = size;
+	header->scope = (uint32_t)scope;
+	header->bucket = context->bucket;
+	__kvfTrackHostAllocation(context->bucket, scope, size);
+	return (void*)ptr;
+}
+
+VKAPI_ATTR void VKAPI_CALL __kvfTrackingFree(void* user_data, void* memory)
+{
+	__KvfTrackingContext* context = (__KvfTrackingContext*)user_data;
+	if(memory == NULL)
+		return;
+	__KvfAllocationHeader* header = (__KvfAllocationHeader*)((uintptr_t)memory - KVF_TRACKING_HEADER_SIZE);
+	__kvfTrackHostFree(header->bucket, (VkSystemAllocationScope)header->scope, header->size);
+	if(context->has_parent)
+		context->parent.pfnFree(context->parent.pUserData, header->raw);
+	else
+		KVF_FREE(header->raw);
+}
+
+VKAPI_ATTR void* VKAPI_CALL __kvfTrackingReallocation(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if(original == NULL)
+		return __kvfTrackingAllocation(user_data, size, alignment, scope);
+	if(size == 0)
+	{
+		__kvfTrackingFree(user_data, original);
+		return NULL;
+	}
+	// The header and alignment padding prevent from forwarding to a plain realloc
+	void* memory = __kvfTrackingAllocation(user_data, size, alignment, scope);
+	if(memory == NULL)
+		return NULL;
+	__KvfAllocationHeader* header = (__KvfAllocationHeader*)((uintptr_t)original - KVF_TRACKING_HEADER_SIZE);
+	memcpy(memory, original, header->size < size ? header->size : size);
+	__kvfTrackingFree(user_data, original);
+	return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL __kvfTrackingInternalAllocation(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	__KvfTrackingContext* context = (__KvfTrackingContext*)user_data;
+	__kvfTrackHostAllocation(context->bucket, scope, size);
+	if(context->has_parent && context->parent.pfnInternalAllocation != NULL)
+		context->parent.pfnInternalAllocation(context->parent.pUserData, size, type, scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL __kvfTrackingInternalFree(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	__KvfTrackingContext* context = (__KvfTrackingContext*)user_data;
+	__kvfTrackHostFree(context->bucket, scope, size);
+	if(context->has_parent && context->parent.pfnInternalFree != NULL)
+		context->parent.pfnInternalFree(context->parent.pUserData, size, type, scope);
+}
+
+void __kvfFillTrackingCallbacks(VkAllocationCallbacks* callbacks, __KvfTrackingContext* contexts, const VkAllocationCallbacks* parent)
+{
+	for(uint32_t i = 0; i < KVF_TRACKING_BUCKET_COUNT; i++)
+	{
+		contexts[i].has_parent = (parent != NULL);
+		if(parent != NULL)
+			contexts[i].parent = *parent;
+		contexts[i].bucket = i;
+		callbacks[i].pUserData = &contexts[i];
+		callbacks[i].pfnAllocation = __kvfTrackingAllocation;
+		callbacks[i].pfnReallocation = __kvfTrackingReallocation;
+		callbacks[i].pfnFree = __kvfTrackingFree;
+		callbacks[i].pfnInternalAllocation = __kvfTrackingInternalAllocation;
+		callbacks[i].pfnInternalFree = __kvfTrackingInternalFree;
+	}
+}
+
+// Callbacks for objects that do not belong to a device (instance, surfaces, devices themselves...)
+const VkAllocationCallbacks* __kvfGetInstanceAllocationCallbacks(VkObjectType type)
+{
+	if(__kvf_host_memory_tracking)
+		return &__kvf_instance_tracking_callbacks[__kvfObjectTypeToTrackingBucket(type)];
+	return __kvf_has_default_callbacks ? &__kvf_default_callbacks : NULL;
+}
+
+const VkAllocationCallbacks* __kvfGetAllocationCallbacks(__KvfDevice* kvf_device, VkObjectType type)
+{
+	KVF_ASSERT(kvf_device != NULL);
+	if(!__kvf_host_memory_tracking)
+		return kvf_device->callbacks;
+	if(kvf_device->tracking_callbacks == NULL)
+	{
+		kvf_device->tracking_callbacks = (VkAllocationCallbacks*)KVF_MALLOC(sizeof(VkAllocationCallbacks) * KVF_TRACKING_BUCKET_COUNT);
+		KVF_ASSERT(kvf_device->tracking_callbacks != NULL && "allocation failed :(");
+		kvf_device->tracking_contexts = (__KvfTrackingContext*)KVF_MALLOC(sizeof(__KvfTrackingContext) * KVF_TRACKING_BUCKET_COUNT);
+		KVF_ASSERT(kvf_device->tracking_contexts != NULL && "allocation failed :(");
+		__kvfFillTrackingCallbacks(kvf_device->tracking_callbacks, kvf_device->tracking_contexts, kvf_device->callbacks);
+	}
+	return &kvf_device->tracking_callbacks[__kvfObjectTypeToTrackingBucket(type)];
+}
+
+void kvfSetDefaultAllocationCallbacks(const VkAllocationCallbacks* callbacks)
+{
+	// Live objects would be freed through callbacks that did not allocate them
+	KVF_ASSERT(__kvf_internal_devices_size == 0 && __kvf_internal_instances_count == 0 && "must be called before creating instances or devices");
+	__kvf_has_default_callbacks = (callbacks != NULL);
+	if(callbacks != NULL)
+		__kvf_default_callbacks = *callbacks;
+	if(__kvf_host_memory_tracking)
+		__kvfFillTrackingCallbacks(__kvf_instance_tracking_callbacks, __kvf_instance_tracking_contexts, callbacks);
+}
+
+void kvfEnableHostMemoryTracking()
+{
+	if(__kvf_host_memory_tracking)
+		return;
+	// Live allocations have no tracking header to be freed with
+	KVF_ASSERT(__kvf_internal_devices_size == 0 && __kvf_internal_instances_count == 0 && "must be called before creating instances or devices");
+	__kvfFillTrackingCallbacks(__kvf_instance_tracking_callbacks, __kvf_instance_tracking_contexts, __kvf_has_default_callbacks ? &__kvf_default_callbacks : NULL);
+	__kvf_host_memory_tracking = true;
+}
+
+KvfHostMemoryStats kvfGetHostMemoryStatsByScope(VkSystemAllocationScope scope)
+{
+	KVF_ASSERT((uint32_t)scope < KVF_TRACKING_SCOPE_COUNT && "invalid allocation scope");
+	return __kvf_host_memory_scope_stats[scope];
+}
+
+KvfHostMemoryStats kvfGetHostMemoryStatsByObjectType(VkObjectType type)
+{
+	return __kvf_host_memory_type_stats[__kvfObjectTypeToTrackingBucket(type)];
+}
+
+KvfHostMemoryStats kvfGetHostMemoryTotalStats()
+{
+	return __kvf_host_memory_total_stats;
+}
+
+void __kvfAddDeviceToArray(VkPhysicalDevice device, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	if(__kvf_internal_devices_size == __kvf_internal_devices_capacity)
+	{
+		// Resize the dynamic array if necessary
+		__kvf_internal_devices_capacity += 2;
+		__kvf_internal_devices = (__KvfDevice*)KVF_REALLOC(__kvf_internal_devices, __kvf_internal_devices_capacity * sizeof(__KvfDevice));
+	}
+
+	__kvf_internal_devices[__kvf_internal_devices_size].physical = device;
+	__kvf_internal_devices[__kvf_internal_devices_size].queues.graphics = graphics_queue;
+	__kvf_internal_devices[__kvf_internal_devices_size].queues.compute = compute_queue;
+	__kvf_internal_devices[__kvf_internal_devices_size].queues.present = present_queue;
+	__kvf_internal_devices_size++;
+}
+
+void __kvfCompleteDevice(VkPhysicalDevice physical, VkDevice device)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(physical != VK_NULL_HANDLE);
+
+	__KvfDevice* kvf_device = NULL;
+
+	for(size_t i = 0; i < __kvf_internal_devices_size; i++)
+	{
+		if(__kvf_internal_devices[i].physical == physical)
+			kvf_device = &__kvf_internal_devices[i];
+	}
+
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	VkCommandPool pool;
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = kvf_device->queues.graphics;
 	kvf_device->device = device;
+	kvf_device->callbacks = NULL;
+	kvf_device->tracking_callbacks = NULL;
+	kvf_device->tracking_contexts = NULL;
+	if(__kvf_has_default_callbacks)
+	{
+		kvf_device->callbacks = (VkAllocationCallbacks*)KVF_MALLOC(sizeof(VkAllocationCallbacks));
+		KVF_ASSERT(kvf_device->callbacks != NULL && "allocation failed :(");
+		*kvf_device->callbacks = __kvf_default_callbacks;
+	}
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateCommandPool)(device, &pool_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_COMMAND_POOL), &pool));
+
 	kvf_device->cmd_pool = pool;
 	kvf_device->sets_pools = NULL;
 	kvf_device->sets_pools_size = 0;
+	kvf_device->sets_pools_failed_allocations = 0;
+	kvf_device->set_layouts = NULL;
+	kvf_device->set_layouts_size = 0;
+	kvf_device->set_layouts_capacity = 0;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+		kvf_device->descriptor_ratios[i] = 1.0f;
+	kvf_device->samplers = NULL;
+	kvf_device->samplers_size = 0;
+	kvf_device->samplers_capacity = 0;
+	kvf_device->image_views = NULL;
+	kvf_device->image_views_size = 0;
+	kvf_device->image_views_capacity = 0;
+	kvf_device->descriptor_sets = NULL;
+	kvf_device->descriptor_sets_size = 0;
+	kvf_device->descriptor_sets_capacity = 0;
+	kvf_device->descriptor_sets_invalidations = NULL;
+	kvf_device->descriptor_sets_invalidations_size = 0;
+	kvf_device->descriptor_sets_invalidations_capacity = 0;
+	kvf_device->descriptor_sets_frame = 0;
+	memset(&kvf_device->set_layouts_cache, 0, sizeof(__KvfLayoutCache));
+	memset(&kvf_device->pipeline_layouts_cache, 0, sizeof(__KvfLayoutCache));
+	memset(&kvf_device->descriptor_buffer_fns, 0, sizeof(__KvfDescriptorBufferFunctions));
+	kvf_device->max_sampler_anisotropy = 0.0f;
+	#ifndef KVF_IMPL_VK_NO_PROTOTYPES
+		kvf_device->push_descriptor_set = NULL;
+	#endif
 	kvf_device->cmd_buffers_size = 0;
 	kvf_device->cmd_buffers_capacity = KVF_COMMAND_POOL_CAPACITY;
 	kvf_device->cmd_buffers = (VkCommandBuffer*)KVF_MALLOC(KVF_COMMAND_POOL_CAPACITY * sizeof(VkCommandBuffer));
+	KVF_ASSERT(kvf_device->cmd_buffers != NULL && "allocation failed :(");
+}
+
+void __kvfCompleteDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical, VkDevice device, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(physical != VK_NULL_HANDLE);
+
+	__kvfAddDeviceToArray(physical, graphics_queue, present_queue, compute_queue);
+
+	__KvfDevice* kvf_device = NULL;
+
+	for(size_t i = 0; i < __kvf_internal_devices_size; i++)
+	{
+		if(__kvf_internal_devices[i].physical == physical)
+			kvf_device = &__kvf_internal_devices[i];
+	}
+
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	VkCommandPool pool;
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = kvf_device->queues.graphics;
+	kvf_device->device = device;
 	kvf_device->callbacks = NULL;
+	kvf_device->tracking_callbacks = NULL;
+	kvf_device->tracking_contexts = NULL;
+	if(__kvf_has_default_callbacks)
+	{
+		kvf_device->callbacks = (VkAllocationCallbacks*)KVF_MALLOC(sizeof(VkAllocationCallbacks));
+		KVF_ASSERT(kvf_device->callbacks != NULL && "allocation failed :(");
+		*kvf_device->callbacks = __kvf_default_callbacks;
+	}
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateCommandPool)(device, &pool_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_COMMAND_POOL), &pool));
+
+	kvf_device->cmd_pool = pool;
+	kvf_device->sets_pools = NULL;
+	kvf_device->sets_pools_size = 0;
+	kvf_device->sets_pools_failed_allocations = 0;
+	kvf_device->set_layouts = NULL;
+	kvf_device->set_layouts_size = 0;
+	kvf_device->set_layouts_capacity = 0;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+		kvf_device->descriptor_ratios[i] = 1.0f;
+	kvf_device->samplers = NULL;
+	kvf_device->samplers_size = 0;
+	kvf_device->samplers_capacity = 0;
+	kvf_device->image_views = NULL;
+	kvf_device->image_views_size = 0;
+	kvf_device->image_views_capacity = 0;
+	kvf_device->descriptor_sets = NULL;
+	kvf_device->descriptor_sets_size = 0;
+	kvf_device->descriptor_sets_capacity = 0;
+	kvf_device->descriptor_sets_invalidations = NULL;
+	kvf_device->descriptor_sets_invalidations_size = 0;
+	kvf_device->descriptor_sets_invalidations_capacity = 0;
+	kvf_device->descriptor_sets_frame = 0;
+	memset(&kvf_device->set_layouts_cache, 0, sizeof(__KvfLayoutCache));
+	memset(&kvf_device->pipeline_layouts_cache, 0, sizeof(__KvfLayoutCache));
+	memset(&kvf_device->descriptor_buffer_fns, 0, sizeof(__KvfDescriptorBufferFunctions));
+	kvf_device->max_sampler_anisotropy = 0.0f;
+	#ifndef KVF_IMPL_VK_NO_PROTOTYPES
+		kvf_device->push_descriptor_set = NULL;
+	#endif
+	kvf_device->cmd_buffers_size = 0;
+	kvf_device->cmd_buffers_capacity = KVF_COMMAND_POOL_CAPACITY;
+	kvf_device->cmd_buffers = (VkCommandBuffer*)KVF_MALLOC(KVF_COMMAND_POOL_CAPACITY * sizeof(VkCommandBuffer));
 	KVF_ASSERT(kvf_device->cmd_buffers != NULL && "allocation failed :(");
 }
 
 void __kvfDestroyDescriptorPools(VkDevice device);
+void __kvfDestroyDescriptorSetLayout(__KvfDevice* kvf_device, VkDescriptorSetLayout layout);
+void __kvfFlushDescriptorSetCacheInvalidations(__KvfDevice* kvf_device);
 
 __KvfDevice* __kvfGetKvfDeviceFromVkPhysicalDevice(VkPhysicalDevice device)
 {
@@ -779,9 +2222,218 @@ void kvfSetAllocationCallbacks(VkDevice device, const VkAllocationCallbacks* cal
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	kvf_device->callbacks = (VkAllocationCallbacks*)KVF_MALLOC(sizeof(VkAllocationCallbacks));
-	KVF_ASSERT(kvf_device->callbacks && "allocation failed :(");
-	memcpy(kvf_device->callbacks, callbacks, sizeof(VkAllocationCallbacks));
+	KVF_ASSERT(kvf_device->cmd_buffers_size == 0 && kvf_device->sets_pools_size == 0 && "allocation callbacks must be set before creating objects from the device");
+
+	// The internal command pool must be freed with the callbacks it has been created with
+	KVF_GET_DEVICE_FUNCTION(vkDestroyCommandPool)(device, kvf_device->cmd_pool, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_COMMAND_POOL));
+
+	if(callbacks == NULL && __kvf_has_default_callbacks)
+		callbacks = &__kvf_default_callbacks;
+	if(callbacks != NULL)
+	{
+		if(kvf_device->callbacks == NULL)
+			kvf_device->callbacks = (VkAllocationCallbacks*)KVF_MALLOC(sizeof(VkAllocationCallbacks));
+		KVF_ASSERT(kvf_device->callbacks != NULL && "allocation failed :(");
+		*kvf_device->callbacks = *callbacks;
+	}
+	else
+	{
+		KVF_FREE(kvf_device->callbacks);
+		kvf_device->callbacks = NULL;
+	}
+	if(kvf_device->tracking_callbacks != NULL)
+		__kvfFillTrackingCallbacks(kvf_device->tracking_callbacks, kvf_device->tracking_contexts, kvf_device->callbacks);
+
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = kvf_device->queues.graphics;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateCommandPool)(device, &pool_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_COMMAND_POOL), &kvf_device->cmd_pool));
+}
+
+void __kvfDestroySamplerCache(__KvfDevice* kvf_device)
+{
+	for(size_t i = 0; i < kvf_device->samplers_capacity; i++)
+	{
+		if(kvf_device->samplers[i].sampler != VK_NULL_HANDLE)
+			KVF_GET_DEVICE_FUNCTION(vkDestroySampler)(kvf_device->device, kvf_device->samplers[i].sampler, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SAMPLER));
+	}
+	KVF_FREE(kvf_device->samplers);
+	kvf_device->samplers = NULL;
+	kvf_device->samplers_size = 0;
+	kvf_device->samplers_capacity = 0;
+}
+
+void __kvfDestroyImageViewCache(__KvfDevice* kvf_device)
+{
+	for(size_t i = 0; i < kvf_device->image_views_capacity; i++)
+	{
+		if(kvf_device->image_views[i].view != VK_NULL_HANDLE)
+			KVF_GET_DEVICE_FUNCTION(vkDestroyImageView)(kvf_device->device, kvf_device->image_views[i].view, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE_VIEW));
+	}
+	KVF_FREE(kvf_device->image_views);
+	kvf_device->image_views = NULL;
+	kvf_device->image_views_size = 0;
+	kvf_device->image_views_capacity = 0;
+}
+
+// Returns the slot holding the key, or the empty slot where it should be inserted
+__KvfLayoutCacheEntry* __kvfLayoutCacheFind(__KvfLayoutCache* cache, const uint64_t* key, size_t key_size, uint32_t hash)
+{
+	size_t mask = cache->capacity - 1;
+	for(size_t i = hash & mask;; i = (i + 1) & mask)
+	{
+		__KvfLayoutCacheEntry* entry = &cache->entries[i];
+		if(entry->layout == 0)
+			return entry;
+		if(entry->hash == hash && entry->key_size == key_size && memcmp(entry->key, key, key_size * sizeof(uint64_t)) == 0)
+			return entry;
+	}
+}
+
+// Returns the slot holding the layout, or the empty slot where it should be inserted
+__KvfLayoutCacheHandle* __kvfLayoutCacheFindHandle(__KvfLayoutCache* cache, uint64_t layout)
+{
+	size_t mask = cache->capacity - 1;
+	for(size_t i = __kvfHashBytes(&layout, sizeof(uint64_t), __KVF_FNV_OFFSET_BASIS) & mask;; i = (i + 1) & mask)
+	{
+		__KvfLayoutCacheHandle* handle = &cache->handles[i];
+		if(handle->layout == 0 || handle->layout == layout)
+			return handle;
+	}
+}
+
+void __kvfLayoutCacheGrow(__KvfLayoutCache* cache)
+{
+	__KvfLayoutCacheEntry* old_entries = cache->entries;
+	__KvfLayoutCacheHandle* old_handles = cache->handles;
+	size_t old_capacity = cache->capacity;
+	cache->capacity = (old_capacity == 0 ? 16 : old_capacity * 2);
+	cache->entries = (__KvfLayoutCacheEntry*)KVF_MALLOC(sizeof(__KvfLayoutCacheEntry) * cache->capacity);
+	KVF_ASSERT(cache->entries != NULL && "allocation failed :(");
+	memset(cache->entries, 0, sizeof(__KvfLayoutCacheEntry) * cache->capacity);
+	cache->handles = (__KvfLayoutCacheHandle*)KVF_MALLOC(sizeof(__KvfLayoutCacheHandle) * cache->capacity);
+	KVF_ASSERT(cache->handles != NULL && "allocation failed :(");
+	memset(cache->handles, 0, sizeof(__KvfLayoutCacheHandle) * cache->capacity);
+	for(size_t i = 0; i < old_capacity; i++)
+	{
+		if(old_entries[i].layout != 0)
+			*__kvfLayoutCacheFind(cache, old_entries[i].key, old_entries[i].key_size, old_entries[i].hash) = old_entries[i];
+		if(old_handles[i].layout != 0)
+			*__kvfLayoutCacheFindHandle(cache, old_handles[i].layout) = old_handles[i];
+	}
+	KVF_FREE(old_entries);
+	KVF_FREE(old_handles);
+}
+
+// Takes a reference on the entry matching the key. On a miss the entry is inserted with a copy of the key and
+// its layout left to 0, the caller must create it right away
+__KvfLayoutCacheEntry* __kvfLayoutCacheAcquire(__KvfLayoutCache* cache, const uint64_t* key, size_t key_size)
+{
+	uint32_t hash = __kvfHashBytes(key, key_size * sizeof(uint64_t), __KVF_FNV_OFFSET_BASIS);
+	// Keeps the load factor under 3/4
+	if((cache->size + 1) * 4 > cache->capacity * 3)
+		__kvfLayoutCacheGrow(cache);
+	__KvfLayoutCacheEntry* entry = __kvfLayoutCacheFind(cache, key, key_size, hash);
+	if(entry->layout != 0)
+	{
+		entry->references++;
+		return entry;
+	}
+	entry->key = (uint64_t*)KVF_MALLOC(key_size * sizeof(uint64_t));
+	KVF_ASSERT(entry->key != NULL && "allocation failed :(");
+	memcpy(entry->key, key, key_size * sizeof(uint64_t));
+	entry->key_size = key_size;
+	entry->hash = hash;
+	entry->references = 1;
+	cache->size++;
+	return entry;
+}
+
+// Gives its layout to an entry inserted by __kvfLayoutCacheAcquire
+void __kvfLayoutCacheSetLayout(__KvfLayoutCache* cache, __KvfLayoutCacheEntry* entry, uint64_t layout)
+{
+	entry->layout = layout;
+	if(layout == 0)
+		return;
+	__KvfLayoutCacheHandle* handle = __kvfLayoutCacheFindHandle(cache, layout);
+	handle->layout = layout;
+	handle->key = entry->key;
+	handle->key_size = entry->key_size;
+	handle->hash = entry->hash;
+}
+
+// Returns the index of the layout's slot, or SIZE_MAX if the layout is not in the cache
+size_t __kvfLayoutCacheIndexOf(__KvfLayoutCache* cache, uint64_t layout)
+{
+	if(cache->capacity == 0 || layout == 0)
+		return SIZE_MAX;
+	const __KvfLayoutCacheHandle* handle = __kvfLayoutCacheFindHandle(cache, layout);
+	if(handle->layout == 0)
+		return SIZE_MAX;
+	return (size_t)(__kvfLayoutCacheFind(cache, handle->key, handle->key_size, handle->hash) - cache->entries);
+}
+
+void __kvfLayoutCacheRemoveAt(__KvfLayoutCache* cache, size_t index)
+{
+	size_t mask = cache->capacity - 1;
+
+	// Same backward shift as the entries below, homes come from the layouts' hashes
+	size_t gap = (size_t)(__kvfLayoutCacheFindHandle(cache, cache->entries[index].layout) - cache->handles);
+	for(size_t j = (gap + 1) & mask; cache->handles[j].layout != 0; j = (j + 1) & mask)
+	{
+		size_t home = __kvfHashBytes(&cache->handles[j].layout, sizeof(uint64_t), __KVF_FNV_OFFSET_BASIS) & mask;
+		bool stays = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+		if(stays)
+			continue;
+		cache->handles[gap] = cache->handles[j];
+		gap = j;
+	}
+	memset(&cache->handles[gap], 0, sizeof(__KvfLayoutCacheHandle));
+
+	KVF_FREE(cache->entries[index].key);
+	cache->size--;
+
+	// Shift back the following entries of the probe sequence to fill the gap
+	gap = index;
+	for(size_t j = (index + 1) & mask; cache->entries[j].layout != 0; j = (j + 1) & mask)
+	{
+		size_t home = cache->entries[j].hash & mask;
+		bool stays = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+		if(stays)
+			continue;
+		cache->entries[gap] = cache->entries[j];
+		gap = j;
+	}
+	memset(&cache->entries[gap], 0, sizeof(__KvfLayoutCacheEntry));
+}
+
+void __kvfDestroyLayoutCaches(__KvfDevice* kvf_device)
+{
+	// Pipeline layouts first as they may reference cached set layouts
+	__KvfLayoutCache* cache = &kvf_device->pipeline_layouts_cache;
+	for(size_t i = 0; i < cache->capacity; i++)
+	{
+		if(cache->entries[i].layout == 0)
+			continue;
+		KVF_GET_DEVICE_FUNCTION(vkDestroyPipelineLayout)(kvf_device->device, (VkPipelineLayout)cache->entries[i].layout, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+		KVF_FREE(cache->entries[i].key);
+	}
+	KVF_FREE(cache->entries);
+	KVF_FREE(cache->handles);
+	memset(cache, 0, sizeof(__KvfLayoutCache));
+
+	cache = &kvf_device->set_layouts_cache;
+	for(size_t i = 0; i < cache->capacity; i++)
+	{
+		if(cache->entries[i].layout == 0)
+			continue;
+		__kvfDestroyDescriptorSetLayout(kvf_device, (VkDescriptorSetLayout)cache->entries[i].layout);
+		KVF_FREE(cache->entries[i].key);
+	}
+	KVF_FREE(cache->entries);
+	KVF_FREE(cache->handles);
+	memset(cache, 0, sizeof(__KvfLayoutCache));
 }
 
 void __kvfDestroyDevice(VkDevice device)
@@ -793,9 +2445,15 @@ void __kvfDestroyDevice(VkDevice device)
 		{
 			__KvfDevice* kvf_device = &__kvf_internal_devices[i];
 			KVF_FREE(kvf_device->cmd_buffers);
-			KVF_GET_DEVICE_FUNCTION(vkDestroyCommandPool)(device, kvf_device->cmd_pool, NULL);
+			KVF_GET_DEVICE_FUNCTION(vkDestroyCommandPool)(device, kvf_device->cmd_pool, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_COMMAND_POOL));
+			__kvfDestroyLayoutCaches(kvf_device);
 			__kvfDestroyDescriptorPools(device);
-			KVF_GET_DEVICE_FUNCTION(vkDestroyDevice)(device, NULL);
+			__kvfDestroySamplerCache(kvf_device);
+			__kvfDestroyImageViewCache(kvf_device);
+			KVF_GET_DEVICE_FUNCTION(vkDestroyDevice)(device, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_DEVICE));
+			KVF_FREE(kvf_device->callbacks);
+			KVF_FREE(kvf_device->tracking_callbacks);
+			KVF_FREE(kvf_device->tracking_contexts);
 			// Shift the elements to fill the gap
 			for(size_t j = i; j < __kvf_internal_devices_size - 1; j++)
 				__kvf_internal_devices[j] = __kvf_internal_devices[j + 1];
@@ -842,7 +2500,7 @@ void __kvfDestroyDevice(VkDevice device)
 		{
 			if(__kvf_internal_swapchains[i].swapchain == swapchain)
 			{
-				KVF_GET_DEVICE_FUNCTION(vkDestroySwapchainKHR)(device, swapchain, kvf_device->callbacks);
+				KVF_GET_DEVICE_FUNCTION(vkDestroySwapchainKHR)(device, swapchain, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SWAPCHAIN_KHR));
 				// Shift the elements to fill the gap
 				for(size_t j = i; j < __kvf_internal_swapchains_size - 1; j++)
 					__kvf_internal_swapchains[j] = __kvf_internal_swapchains[j + 1];
@@ -897,7 +2555,7 @@ void __kvfDestroyFramebuffer(VkDevice device, VkFramebuffer framebuffer)
 	{
 		if(__kvf_internal_framebuffers[i].framebuffer == framebuffer)
 		{
-			KVF_GET_DEVICE_FUNCTION(vkDestroyFramebuffer)(device, framebuffer, kvf_device->callbacks);
+			KVF_GET_DEVICE_FUNCTION(vkDestroyFramebuffer)(device, framebuffer, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_FRAMEBUFFER));
 			// Shift the elements to fill the gap
 			for(size_t j = i; j < __kvf_internal_framebuffers_size - 1; j++)
 				__kvf_internal_framebuffers[j] = __kvf_internal_framebuffers[j + 1];
@@ -925,112 +2583,273 @@ __KvfFramebuffer* __kvfGetKvfFramebufferFromVkFramebuffer(VkFramebuffer framebuf
 	return NULL;
 }
 
-VkDescriptorPool __kvfDeviceCreateDescriptorPool(VkDevice device)
+__KvfTrackedImage* __kvfGetKvfTrackedImageFromVkImage(VkImage image)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	kvf_device->sets_pools_size++;
-	kvf_device->sets_pools = (__KvfDescriptorPool*)KVF_REALLOC(kvf_device->sets_pools, kvf_device->sets_pools_size * sizeof(__KvfDescriptorPool));
-	memset(&kvf_device->sets_pools[kvf_device->sets_pools_size - 1], 0, sizeof(__KvfDescriptorPool));
-
-	VkDescriptorPoolSize pool_sizes[] = {
-		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1024 },
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024 },
-		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1024 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1024 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1024 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1024 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1024 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1024 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1024 },
-		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1024 }
-	};
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	for(size_t i = 0; i < __kvf_internal_tracked_images_size; i++)
+	{
+		if(__kvf_internal_tracked_images[i].image == image)
+			return &__kvf_internal_tracked_images[i];
+	}
+	return NULL;
+}
+
+void __kvfCreateDescriptorPool(__KvfDevice* kvf_device, __KvfDescriptorPool* pool, size_t capacity, const uint32_t* required_counts, VkDescriptorPoolCreateFlags flags)
+{
+	memset(pool, 0, sizeof(__KvfDescriptorPool));
+
+	VkDescriptorPoolSize pool_sizes[__KVF_DESCRIPTOR_TYPE_COUNT];
+	uint32_t pool_sizes_count = 0;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+	{
+		uint32_t count = (uint32_t)(kvf_device->descriptor_ratios[i] * (float)capacity + 0.5f);
+		if(required_counts != NULL && count < required_counts[i])
+			count = required_counts[i];
+		pool->descriptors_capacity[i] = count;
+		if(count == 0)
+			continue;
+		pool_sizes[pool_sizes_count].type = (VkDescriptorType)i;
+		pool_sizes[pool_sizes_count].descriptorCount = count;
+		pool_sizes_count++;
+	}
+	KVF_ASSERT(pool_sizes_count != 0 && "descriptor pool ratios are all zero");
 
 	VkDescriptorPoolCreateInfo pool_info = {};
 	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	pool_info.poolSizeCount = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize);
+	pool_info.poolSizeCount = pool_sizes_count;
 	pool_info.pPoolSizes = pool_sizes;
-	pool_info.maxSets = KVF_DESCRIPTOR_POOL_CAPACITY;
-	pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	pool_info.maxSets = (uint32_t)capacity;
+	pool_info.flags = flags;
 
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorPool)(device, &pool_info, NULL, &kvf_device->sets_pools[kvf_device->sets_pools_size - 1].pool));
-	kvf_device->sets_pools[kvf_device->sets_pools_size - 1].capacity = KVF_DESCRIPTOR_POOL_CAPACITY;
-	return kvf_device->sets_pools[kvf_device->sets_pools_size - 1].pool;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorPool)(kvf_device->device, &pool_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_POOL), &pool->pool));
+	pool->capacity = capacity;
 }
 
-void __kvfDestroyDescriptorPools(VkDevice device)
+// The pool is big enough to hold at least one set of required_counts, that can be NULL
+__KvfDescriptorPool* __kvfDeviceCreateDescriptorPool(VkDevice device, const uint32_t* required_counts)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 
-	for(size_t i = 0; i < kvf_device->sets_pools_size; i++)
-		KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorPool)(device, kvf_device->sets_pools[i].pool, NULL);
-	KVF_FREE(kvf_device->sets_pools);
-	kvf_device->sets_pools_size = 0;
-}
+	// Each new pool doubles the capacity of the previous one
+	size_t capacity = KVF_DESCRIPTOR_POOL_CAPACITY;
+	if(kvf_device->sets_pools_size != 0)
+		capacity = kvf_device->sets_pools[kvf_device->sets_pools_size - 1].capacity * 2;
+	if(capacity > KVF_DESCRIPTOR_POOL_MAX_CAPACITY)
+		capacity = KVF_DESCRIPTOR_POOL_MAX_CAPACITY;
 
-void kvfSetErrorCallback(KvfErrorCallback callback)
-{
-	__kvf_error_callback = callback;
+	kvf_device->sets_pools_size++;
+	kvf_device->sets_pools = (__KvfDescriptorPool*)KVF_REALLOC(kvf_device->sets_pools, kvf_device->sets_pools_size * sizeof(__KvfDescriptorPool));
+	KVF_ASSERT(kvf_device->sets_pools != NULL && "allocation failed :(");
+	__KvfDescriptorPool* pool = &kvf_device->sets_pools[kvf_device->sets_pools_size - 1];
+	__kvfCreateDescriptorPool(kvf_device, pool, capacity, required_counts, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+	return pool;
 }
 
-void kvfSetWarningCallback(KvfErrorCallback callback)
+__KvfDescriptorSetLayoutInfo* __kvfGetDescriptorSetLayoutInfo(__KvfDevice* kvf_device, VkDescriptorSetLayout layout)
 {
-	__kvf_warning_callback = callback;
+	for(size_t i = 0; i < kvf_device->set_layouts_size; i++)
+	{
+		if(kvf_device->set_layouts[i].layout == layout)
+			return &kvf_device->set_layouts[i];
+	}
+	return NULL;
 }
 
-void kvfSetValidationErrorCallback(KvfErrorCallback callback)
+void __kvfFreeDescriptorSetToPool(__KvfDevice* kvf_device, size_t pool_index, const uint32_t* counts, VkDescriptorSet set)
 {
-	__kvf_validation_error_callback = callback;
+	KVF_ASSERT(pool_index < kvf_device->sets_pools_size);
+	__KvfDescriptorPool* pool = &kvf_device->sets_pools[pool_index];
+	KVF_GET_DEVICE_FUNCTION(vkFreeDescriptorSets)(kvf_device->device, pool->pool, 1, &set);
+	pool->size--;
+	pool->full = false;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+		pool->descriptors_size[i] -= counts[i];
 }
 
-void kvfSetValidationWarningCallback(KvfErrorCallback callback)
+// Returns the slot holding the key, or the empty slot where it should be inserted
+__KvfDescriptorSetCacheEntry* __kvfDescriptorSetCacheFind(__KvfDevice* kvf_device, VkDescriptorSetLayout layout, const void* data, size_t data_size, uint32_t hash)
 {
-	__kvf_validation_warning_callback = callback;
-}
-
-#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-	void kvfPassGlobalVulkanFunctionPointers(const KvfGlobalVulkanFunctions* fns)
+	size_t mask = kvf_device->descriptor_sets_capacity - 1;
+	for(size_t i = hash & mask;; i = (i + 1) & mask)
 	{
-		KVF_ASSERT(fns != NULL);
-		__kvf_g_fns = *fns;
+		__KvfDescriptorSetCacheEntry* entry = &kvf_device->descriptor_sets[i];
+		if(entry->set == VK_NULL_HANDLE)
+			return entry;
+		if(!entry->orphaned && entry->hash == hash && entry->layout == layout && entry->data_size == data_size && memcmp(entry->data, data, data_size) == 0)
+			return entry;
 	}
+}
 
-	void kvfPassInstanceVulkanFunctionPointers(const KvfInstanceVulkanFunctions* fns)
+void __kvfDescriptorSetCacheGrow(__KvfDevice* kvf_device)
+{
+	__KvfDescriptorSetCacheEntry* old_sets = kvf_device->descriptor_sets;
+	size_t old_capacity = kvf_device->descriptor_sets_capacity;
+	kvf_device->descriptor_sets_capacity = (old_capacity == 0 ? 64 : old_capacity * 2);
+	kvf_device->descriptor_sets = (__KvfDescriptorSetCacheEntry*)KVF_MALLOC(sizeof(__KvfDescriptorSetCacheEntry) * kvf_device->descriptor_sets_capacity);
+	KVF_ASSERT(kvf_device->descriptor_sets != NULL && "allocation failed :(");
+	memset(kvf_device->descriptor_sets, 0, sizeof(__KvfDescriptorSetCacheEntry) * kvf_device->descriptor_sets_capacity);
+	size_t mask = kvf_device->descriptor_sets_capacity - 1;
+	for(size_t i = 0; i < old_capacity; i++)
 	{
-		KVF_ASSERT(fns != NULL);
-		__kvf_i_fns = *fns;
+		if(old_sets[i].set == VK_NULL_HANDLE)
+			continue;
+		// An orphaned set may share its key with a live one, so the first empty slot is taken without comparing
+		size_t j = old_sets[i].hash & mask;
+		while(kvf_device->descriptor_sets[j].set != VK_NULL_HANDLE)
+			j = (j + 1) & mask;
+		kvf_device->descriptor_sets[j] = old_sets[i];
 	}
-#endif
+	KVF_FREE(old_sets);
+}
 
-bool kvfIsStencilFormat(VkFormat format)
+// Frees the set of slot i and shifts back the following entries of the probe sequence,
+// slot i must be checked again by callers iterating over the table
+void __kvfDescriptorSetCacheRemoveAt(__KvfDevice* kvf_device, size_t i)
 {
-	switch(format)
+	__KvfDescriptorSetCacheEntry* entry = &kvf_device->descriptor_sets[i];
+	__kvfFreeDescriptorSetToPool(kvf_device, entry->pool_index, entry->counts, entry->set);
+	KVF_FREE(entry->data);
+	kvf_device->descriptor_sets_size--;
+
+	size_t mask = kvf_device->descriptor_sets_capacity - 1;
+	size_t gap = i;
+	for(size_t j = (i + 1) & mask; kvf_device->descriptor_sets[j].set != VK_NULL_HANDLE; j = (j + 1) & mask)
 	{
-		case VK_FORMAT_D32_SFLOAT_S8_UINT:
-		case VK_FORMAT_D24_UNORM_S8_UINT:
-			return true;
-
-		default: return false;
+		size_t home = kvf_device->descriptor_sets[j].hash & mask;
+		bool stays = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+		if(stays)
+			continue;
+		kvf_device->descriptor_sets[gap] = kvf_device->descriptor_sets[j];
+		gap = j;
 	}
+	kvf_device->descriptor_sets[gap].set = VK_NULL_HANDLE;
+	kvf_device->descriptor_sets[gap].data = NULL;
 }
 
-bool kvfIsDepthFormat(VkFormat format)
+// The sets themselves are not freed, for when their pools are reset or destroyed
+void __kvfClearDescriptorSetCache(__KvfDevice* kvf_device)
 {
-	switch(format)
-	{
-		case VK_FORMAT_D16_UNORM:
-		case VK_FORMAT_D32_SFLOAT:
-		case VK_FORMAT_D32_SFLOAT_S8_UINT:
-		case VK_FORMAT_D24_UNORM_S8_UINT:
-		case VK_FORMAT_D16_UNORM_S8_UINT:
-			return true;
+	for(size_t i = 0; i < kvf_device->descriptor_sets_capacity; i++)
+		KVF_FREE(kvf_device->descriptor_sets[i].data);
+	KVF_FREE(kvf_device->descriptor_sets);
+	kvf_device->descriptor_sets = NULL;
+	kvf_device->descriptor_sets_size = 0;
+	kvf_device->descriptor_sets_capacity = 0;
+	KVF_FREE(kvf_device->descriptor_sets_invalidations);
+	kvf_device->descriptor_sets_invalidations = NULL;
+	kvf_device->descriptor_sets_invalidations_size = 0;
+	kvf_device->descriptor_sets_invalidations_capacity = 0;
+}
+
+void __kvfReleaseDescriptorSetLayoutInfo(__KvfDevice* kvf_device, __KvfDescriptorSetLayoutInfo* info)
+{
+	if(info->update_template != VK_NULL_HANDLE)
+		KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorUpdateTemplate)(kvf_device->device, info->update_template, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE));
+	KVF_FREE(info->template_entries);
+	KVF_FREE(info->binding_offsets);
+	info->update_template = VK_NULL_HANDLE;
+	info->template_entries = NULL;
+	info->binding_offsets = NULL;
+}
+
+const __KvfDescriptorBufferFunctions* __kvfGetDescriptorBufferFunctions(__KvfDevice* kvf_device)
+{
+	__KvfDescriptorBufferFunctions* fns = &kvf_device->descriptor_buffer_fns;
+	if(fns->loaded)
+		return fns;
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		fns->vkCmdBindDescriptorBuffersEXT = kvf_device->fns.vkCmdBindDescriptorBuffersEXT;
+		fns->vkCmdSetDescriptorBufferOffsetsEXT = kvf_device->fns.vkCmdSetDescriptorBufferOffsetsEXT;
+		fns->vkGetBufferDeviceAddress = kvf_device->fns.vkGetBufferDeviceAddress;
+		fns->vkGetDescriptorEXT = kvf_device->fns.vkGetDescriptorEXT;
+		fns->vkGetDescriptorSetLayoutBindingOffsetEXT = kvf_device->fns.vkGetDescriptorSetLayoutBindingOffsetEXT;
+		fns->vkGetDescriptorSetLayoutSizeEXT = kvf_device->fns.vkGetDescriptorSetLayoutSizeEXT;
+	#else
+		// Extension functions are not exported by the loader
+		fns->vkCmdBindDescriptorBuffersEXT = (PFN_vkCmdBindDescriptorBuffersEXT)vkGetDeviceProcAddr(kvf_device->device, "vkCmdBindDescriptorBuffersEXT");
+		fns->vkCmdSetDescriptorBufferOffsetsEXT = (PFN_vkCmdSetDescriptorBufferOffsetsEXT)vkGetDeviceProcAddr(kvf_device->device, "vkCmdSetDescriptorBufferOffsetsEXT");
+		fns->vkGetBufferDeviceAddress = (PFN_vkGetBufferDeviceAddress)vkGetDeviceProcAddr(kvf_device->device, "vkGetBufferDeviceAddress");
+		if(fns->vkGetBufferDeviceAddress == NULL)
+			fns->vkGetBufferDeviceAddress = (PFN_vkGetBufferDeviceAddress)vkGetDeviceProcAddr(kvf_device->device, "vkGetBufferDeviceAddressKHR");
+		fns->vkGetDescriptorEXT = (PFN_vkGetDescriptorEXT)vkGetDeviceProcAddr(kvf_device->device, "vkGetDescriptorEXT");
+		fns->vkGetDescriptorSetLayoutBindingOffsetEXT = (PFN_vkGetDescriptorSetLayoutBindingOffsetEXT)vkGetDeviceProcAddr(kvf_device->device, "vkGetDescriptorSetLayoutBindingOffsetEXT");
+		fns->vkGetDescriptorSetLayoutSizeEXT = (PFN_vkGetDescriptorSetLayoutSizeEXT)vkGetDeviceProcAddr(kvf_device->device, "vkGetDescriptorSetLayoutSizeEXT");
+	#endif
+	KVF_ASSERT(fns->vkCmdBindDescriptorBuffersEXT != NULL && "VK_EXT_descriptor_buffer is not enabled on the device");
+	KVF_ASSERT(fns->vkCmdSetDescriptorBufferOffsetsEXT != NULL && "VK_EXT_descriptor_buffer is not enabled on the device");
+	KVF_ASSERT(fns->vkGetDescriptorEXT != NULL && "VK_EXT_descriptor_buffer is not enabled on the device");
+	KVF_ASSERT(fns->vkGetDescriptorSetLayoutBindingOffsetEXT != NULL && "VK_EXT_descriptor_buffer is not enabled on the device");
+	KVF_ASSERT(fns->vkGetDescriptorSetLayoutSizeEXT != NULL && "VK_EXT_descriptor_buffer is not enabled on the device");
+	KVF_ASSERT(fns->vkGetBufferDeviceAddress != NULL && "descriptor buffers need buffer device addresses");
+	fns->loaded = true;
+	return fns;
+}
+
+void __kvfDestroyDescriptorPools(VkDevice device)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	__kvfClearDescriptorSetCache(kvf_device);
+	for(size_t i = 0; i < kvf_device->sets_pools_size; i++)
+		KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorPool)(device, kvf_device->sets_pools[i].pool, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+	KVF_FREE(kvf_device->sets_pools);
+	kvf_device->sets_pools = NULL;
+	kvf_device->sets_pools_size = 0;
+	// The layouts themselves are owned by the user, only kvf's data is released
+	for(size_t i = 0; i < kvf_device->set_layouts_size; i++)
+		__kvfReleaseDescriptorSetLayoutInfo(kvf_device, &kvf_device->set_layouts[i]);
+	KVF_FREE(kvf_device->set_layouts);
+	kvf_device->set_layouts = NULL;
+	kvf_device->set_layouts_size = 0;
+	kvf_device->set_layouts_capacity = 0;
+}
+
+void kvfSetErrorCallback(KvfErrorCallback callback)
+{
+	__kvf_error_callback = callback;
+}
+
+void kvfSetWarningCallback(KvfErrorCallback callback)
+{
+	__kvf_warning_callback = callback;
+}
+
+void kvfSetValidationErrorCallback(KvfErrorCallback callback)
+{
+	__kvf_validation_error_callback = callback;
+}
+
+void kvfSetValidationWarningCallback(KvfErrorCallback callback)
+{
+	__kvf_validation_warning_callback = callback;
+}
+
+#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+	void kvfPassGlobalVulkanFunctionPointers(const KvfGlobalVulkanFunctions* fns)
+	{
+		KVF_ASSERT(fns != NULL);
+		__kvf_g_fns = *fns;
+	}
 
-		default: return false;
+	void kvfPassInstanceVulkanFunctionPointers(const KvfInstanceVulkanFunctions* fns)
+	{
+		KVF_ASSERT(fns != NULL);
+		__kvf_i_fns = *fns;
 	}
+#endif
+
+bool kvfIsStencilFormat(VkFormat format)
+{
+	return kvfGetFormatInfo(format).stencil;
+}
+
+bool kvfIsDepthFormat(VkFormat format)
+{
+	return kvfGetFormatInfo(format).depth;
 }
 
 VkPipelineStageFlags kvfLayoutToAccessMask(VkImageLayout layout, bool is_destination)
@@ -1126,135 +2945,71 @@ VkFormat kvfFindSupportFormatInCandidates(VkDevice device, VkFormat* candidates,
 
 uint32_t kvfFormatSize(VkFormat format)
 {
+	KvfFormatInfo info = kvfGetFormatInfo(format);
+	return info.compressed ? 0 : info.block_size;
+}
+
+KvfFormatInfo kvfGetFormatInfo(VkFormat format)
+{
+	KvfFormatInfo info;
+	memset(&info, 0, sizeof(KvfFormatInfo));
+	info.block_width = 1;
+	info.block_height = 1;
+	if((uint32_t)format >= sizeof(__kvf_format_table) / sizeof(__kvf_format_table[0]))
+	{
+		info.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		return info;
+	}
+	const __KvfFormatTableEntry* entry = &__kvf_format_table[format];
+	info.block_size = entry->block_size;
+	info.block_width = entry->block_width;
+	info.block_height = entry->block_height;
+	info.compressed = (entry->flags & __KVF_FORMAT_COMPRESSED) != 0;
+	info.depth = (entry->flags & __KVF_FORMAT_DEPTH) != 0;
+	info.stencil = (entry->flags & __KVF_FORMAT_STENCIL) != 0;
+	info.srgb = (entry->flags & __KVF_FORMAT_SRGB) != 0;
+	if(info.depth || info.stencil)
+		info.aspect = (info.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : 0) | (info.stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+	else
+		info.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	// Buffer copies of the depth aspect use 4 bytes for 24 bits depth, stencil copies always use 1 byte
 	switch(format)
 	{
-		case VK_FORMAT_UNDEFINED: return 0;
-		case VK_FORMAT_R4G4_UNORM_PACK8: return 1;
-		case VK_FORMAT_R4G4B4A4_UNORM_PACK16: return 2;
-		case VK_FORMAT_B4G4R4A4_UNORM_PACK16: return 2;
-		case VK_FORMAT_R5G6B5_UNORM_PACK16: return 2;
-		case VK_FORMAT_B5G6R5_UNORM_PACK16: return 2;
-		case VK_FORMAT_R5G5B5A1_UNORM_PACK16: return 2;
-		case VK_FORMAT_B5G5R5A1_UNORM_PACK16: return 2;
-		case VK_FORMAT_A1R5G5B5_UNORM_PACK16: return 2;
-		case VK_FORMAT_R8_UNORM: return 1;
-		case VK_FORMAT_R8_SNORM: return 1;
-		case VK_FORMAT_R8_USCALED: return 1;
-		case VK_FORMAT_R8_SSCALED: return 1;
-		case VK_FORMAT_R8_UINT: return 1;
-		case VK_FORMAT_R8_SINT: return 1;
-		case VK_FORMAT_R8_SRGB: return 1;
-		case VK_FORMAT_R8G8_UNORM: return 2;
-		case VK_FORMAT_R8G8_SNORM: return 2;
-		case VK_FORMAT_R8G8_USCALED: return 2;
-		case VK_FORMAT_R8G8_SSCALED: return 2;
-		case VK_FORMAT_R8G8_UINT: return 2;
-		case VK_FORMAT_R8G8_SINT: return 2;
-		case VK_FORMAT_R8G8_SRGB: return 2;
-		case VK_FORMAT_R8G8B8_UNORM: return 3;
-		case VK_FORMAT_R8G8B8_SNORM: return 3;
-		case VK_FORMAT_R8G8B8_USCALED: return 3;
-		case VK_FORMAT_R8G8B8_SSCALED: return 3;
-		case VK_FORMAT_R8G8B8_UINT: return 3;
-		case VK_FORMAT_R8G8B8_SINT: return 3;
-		case VK_FORMAT_R8G8B8_SRGB: return 3;
-		case VK_FORMAT_B8G8R8_UNORM: return 3;
-		case VK_FORMAT_B8G8R8_SNORM: return 3;
-		case VK_FORMAT_B8G8R8_USCALED: return 3;
-		case VK_FORMAT_B8G8R8_SSCALED: return 3;
-		case VK_FORMAT_B8G8R8_UINT: return 3;
-		case VK_FORMAT_B8G8R8_SINT: return 3;
-		case VK_FORMAT_B8G8R8_SRGB: return 3;
-		case VK_FORMAT_R8G8B8A8_UNORM: return 4;
-		case VK_FORMAT_R8G8B8A8_SNORM: return 4;
-		case VK_FORMAT_R8G8B8A8_USCALED: return 4;
-		case VK_FORMAT_R8G8B8A8_SSCALED: return 4;
-		case VK_FORMAT_R8G8B8A8_UINT: return 4;
-		case VK_FORMAT_R8G8B8A8_SINT: return 4;
-		case VK_FORMAT_R8G8B8A8_SRGB: return 4;
-		case VK_FORMAT_B8G8R8A8_UNORM: return 4;
-		case VK_FORMAT_B8G8R8A8_SNORM: return 4;
-		case VK_FORMAT_B8G8R8A8_USCALED: return 4;
-		case VK_FORMAT_B8G8R8A8_SSCALED: return 4;
-		case VK_FORMAT_B8G8R8A8_UINT: return 4;
-		case VK_FORMAT_B8G8R8A8_SINT: return 4;
-		case VK_FORMAT_B8G8R8A8_SRGB: return 4;
-		case VK_FORMAT_A8B8G8R8_UNORM_PACK32: return 4;
-		case VK_FORMAT_A8B8G8R8_SNORM_PACK32: return 4;
-		case VK_FORMAT_A8B8G8R8_USCALED_PACK32: return 4;
-		case VK_FORMAT_A8B8G8R8_SSCALED_PACK32: return 4;
-		case VK_FORMAT_A8B8G8R8_UINT_PACK32: return 4;
-		case VK_FORMAT_A8B8G8R8_SINT_PACK32: return 4;
-		case VK_FORMAT_A8B8G8R8_SRGB_PACK32: return 4;
-		case VK_FORMAT_A2R10G10B10_UNORM_PACK32: return 4;
-		case VK_FORMAT_A2R10G10B10_SNORM_PACK32: return 4;
-		case VK_FORMAT_A2R10G10B10_USCALED_PACK32: return 4;
-		case VK_FORMAT_A2R10G10B10_SSCALED_PACK32: return 4;
-		case VK_FORMAT_A2R10G10B10_UINT_PACK32: return 4;
-		case VK_FORMAT_A2R10G10B10_SINT_PACK32: return 4;
-		case VK_FORMAT_A2B10G10R10_UNORM_PACK32: return 4;
-		case VK_FORMAT_A2B10G10R10_SNORM_PACK32: return 4;
-		case VK_FORMAT_A2B10G10R10_USCALED_PACK32: return 4;
-		case VK_FORMAT_A2B10G10R10_SSCALED_PACK32: return 4;
-		case VK_FORMAT_A2B10G10R10_UINT_PACK32: return 4;
-		case VK_FORMAT_A2B10G10R10_SINT_PACK32: return 4;
-		case VK_FORMAT_R16_UNORM: return 2;
-		case VK_FORMAT_R16_SNORM: return 2;
-		case VK_FORMAT_R16_USCALED: return 2;
-		case VK_FORMAT_R16_SSCALED: return 2;
-		case VK_FORMAT_R16_UINT: return 2;
-		case VK_FORMAT_R16_SINT: return 2;
-		case VK_FORMAT_R16_SFLOAT: return 2;
-		case VK_FORMAT_R16G16_UNORM: return 4;
-		case VK_FORMAT_R16G16_SNORM: return 4;
-		case VK_FORMAT_R16G16_USCALED: return 4;
-		case VK_FORMAT_R16G16_SSCALED: return 4;
-		case VK_FORMAT_R16G16_UINT: return 4;
-		case VK_FORMAT_R16G16_SINT: return 4;
-		case VK_FORMAT_R16G16_SFLOAT: return 4;
-		case VK_FORMAT_R16G16B16_UNORM: return 6;
-		case VK_FORMAT_R16G16B16_SNORM: return 6;
-		case VK_FORMAT_R16G16B16_USCALED: return 6;
-		case VK_FORMAT_R16G16B16_SSCALED: return 6;
-		case VK_FORMAT_R16G16B16_UINT: return 6;
-		case VK_FORMAT_R16G16B16_SINT: return 6;
-		case VK_FORMAT_R16G16B16_SFLOAT: return 6;
-		case VK_FORMAT_R16G16B16A16_UNORM: return 8;
-		case VK_FORMAT_R16G16B16A16_SNORM: return 8;
-		case VK_FORMAT_R16G16B16A16_USCALED: return 8;
-		case VK_FORMAT_R16G16B16A16_SSCALED: return 8;
-		case VK_FORMAT_R16G16B16A16_UINT: return 8;
-		case VK_FORMAT_R16G16B16A16_SINT: return 8;
-		case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
-		case VK_FORMAT_R32_UINT: return 4;
-		case VK_FORMAT_R32_SINT: return 4;
-		case VK_FORMAT_R32_SFLOAT: return 4;
-		case VK_FORMAT_R32G32_UINT: return 8;
-		case VK_FORMAT_R32G32_SINT: return 8;
-		case VK_FORMAT_R32G32_SFLOAT: return 8;
-		case VK_FORMAT_R32G32B32_UINT: return 12;
-		case VK_FORMAT_R32G32B32_SINT: return 12;
-		case VK_FORMAT_R32G32B32_SFLOAT: return 12;
-		case VK_FORMAT_R32G32B32A32_UINT: return 16;
-		case VK_FORMAT_R32G32B32A32_SINT: return 16;
-		case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
-		case VK_FORMAT_R64_UINT: return 8;
-		case VK_FORMAT_R64_SINT: return 8;
-		case VK_FORMAT_R64_SFLOAT: return 8;
-		case VK_FORMAT_R64G64_UINT: return 16;
-		case VK_FORMAT_R64G64_SINT: return 16;
-		case VK_FORMAT_R64G64_SFLOAT: return 16;
-		case VK_FORMAT_R64G64B64_UINT: return 24;
-		case VK_FORMAT_R64G64B64_SINT: return 24;
-		case VK_FORMAT_R64G64B64_SFLOAT: return 24;
-		case VK_FORMAT_R64G64B64A64_UINT: return 32;
-		case VK_FORMAT_R64G64B64A64_SINT: return 32;
-		case VK_FORMAT_R64G64B64A64_SFLOAT: return 32;
-		case VK_FORMAT_B10G11R11_UFLOAT_PACK32: return 4;
-		case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32: return 4;
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_D16_UNORM_S8_UINT: info.depth_size = 2; break;
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT: info.depth_size = 4; break;
 
-		default: return 0;
+		default: break;
 	}
+	info.stencil_size = (info.stencil ? 1 : 0);
+	return info;
+}
+
+VkDeviceSize kvfFormatImageSize(VkFormat format, VkExtent3D extent)
+{
+	KvfFormatInfo info = kvfGetFormatInfo(format);
+	VkDeviceSize blocks_x = (extent.width + info.block_width - 1) / info.block_width;
+	VkDeviceSize blocks_y = (extent.height + info.block_height - 1) / info.block_height;
+	return blocks_x * blocks_y * extent.depth * info.block_size;
+}
+
+// Tightly packed size of one layer of a single aspect as laid out by buffer copies
+VkDeviceSize __kvfFormatAspectImageSize(VkFormat format, VkImageAspectFlags aspect, VkExtent3D extent)
+{
+	KvfFormatInfo info = kvfGetFormatInfo(format);
+	VkDeviceSize texel_size;
+	if(aspect == VK_IMAGE_ASPECT_DEPTH_BIT)
+		texel_size = info.depth_size;
+	else if(aspect == VK_IMAGE_ASPECT_STENCIL_BIT)
+		texel_size = info.stencil_size;
+	else if(aspect == VK_IMAGE_ASPECT_COLOR_BIT)
+		return kvfFormatImageSize(format, extent);
+	else
+		return 0;
+	return (VkDeviceSize)extent.width * extent.height * extent.depth * texel_size;
 }
 
 const char* kvfVerbaliseVkResult(VkResult result)
@@ -1295,8 +3050,8 @@ const char* kvfVerbaliseVkResult(VkResult result)
 	{
 		uint32_t layer_count;
 		KVF_GET_GLOBAL_FUNCTION(vkEnumerateInstanceLayerProperties)(&layer_count, NULL);
-		VkLayerProperties* available_layers = (VkLayerProperties*)KVF_MALLOC(sizeof(VkLayerProperties) * layer_count);
-		KVF_ASSERT(available_layers != NULL && "allocation failed :(");
+		__KvfScratchMarker marker = __kvfScratchMark();
+		VkLayerProperties* available_layers = (VkLayerProperties*)__kvfScratchPush(sizeof(VkLayerProperties) * layer_count);
 		KVF_GET_GLOBAL_FUNCTION(vkEnumerateInstanceLayerProperties)(&layer_count, available_layers);
 		for(size_t i = 0; i < __kvf_extra_layers_count; i++)
 		{
@@ -1311,11 +3066,11 @@ const char* kvfVerbaliseVkResult(VkResult result)
 			}
 			if(!found)
 			{
-				KVF_FREE(available_layers);
+				__kvfScratchRewind(marker);
 				return false;
 			}
 		}
-		KVF_FREE(available_layers);
+		__kvfScratchRewind(marker);
 		return true;
 	}
 
@@ -1359,15 +3114,15 @@ const char* kvfVerbaliseVkResult(VkResult result)
 	VkResult __kvfCreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* create_info, VkDebugUtilsMessengerEXT* messenger)
 	{
 		PFN_vkCreateDebugUtilsMessengerEXT func = (PFN_vkCreateDebugUtilsMessengerEXT)KVF_GET_GLOBAL_FUNCTION(vkGetInstanceProcAddr)(instance, "vkCreateDebugUtilsMessengerEXT");
-		return func ? func(instance, create_info, NULL, messenger) : VK_ERROR_EXTENSION_NOT_PRESENT;
+		return func ? func(instance, create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT), messenger) : VK_ERROR_EXTENSION_NOT_PRESENT;
 	}
 
 	void __kvfInitValidationLayers(VkInstance instance)
 	{
 		uint32_t extension_count;
 		KVF_GET_GLOBAL_FUNCTION(vkEnumerateInstanceExtensionProperties)(NULL, &extension_count, NULL);
-		VkExtensionProperties* extensions = (VkExtensionProperties*)KVF_MALLOC(extension_count * sizeof(VkExtensionProperties));
-		KVF_ASSERT(extensions != NULL && "allocation failed :(");
+		__KvfScratchMarker marker = __kvfScratchMark();
+		VkExtensionProperties* extensions = (VkExtensionProperties*)__kvfScratchPush(extension_count * sizeof(VkExtensionProperties));
 		KVF_GET_GLOBAL_FUNCTION(vkEnumerateInstanceExtensionProperties)(NULL, &extension_count, extensions);
 		bool extension_found = false;
 		for(uint32_t i = 0; i < extension_count; i++)
@@ -1378,6 +3133,7 @@ const char* kvfVerbaliseVkResult(VkResult result)
 				break;
 			}
 		}
+		__kvfScratchRewind(marker);
 		if(!extension_found)
 		{
 			if(__kvf_validation_warning_callback != NULL)
@@ -1388,7 +3144,6 @@ const char* kvfVerbaliseVkResult(VkResult result)
 				return;
 			}
 			printf("KVF Vulkan warning: %s is not present; cannot enable validation layers", VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-			KVF_FREE(extensions);
 			return;
 		}
 		VkDebugUtilsMessengerCreateInfoEXT create_info = {};
@@ -1400,7 +3155,7 @@ const char* kvfVerbaliseVkResult(VkResult result)
 	{
 		PFN_vkDestroyDebugUtilsMessengerEXT func = (PFN_vkDestroyDebugUtilsMessengerEXT)KVF_GET_GLOBAL_FUNCTION(vkGetInstanceProcAddr)(instance, "vkDestroyDebugUtilsMessengerEXT");
 		if(func)
-			func(instance, __kvf_debug_messenger, NULL);
+			func(instance, __kvf_debug_messenger, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT));
 	}
 #endif // KVF_ENABLE_VALIDATION_LAYERS
 
@@ -1438,6 +3193,13 @@ VkInstance kvfCreateInstanceNext(const char** extensions_enabled, uint32_t exten
 	VkInstanceCreateInfo create_info = {};
 	create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	create_info.pApplicationInfo = NULL;
+	VkApplicationInfo app_info = {};
+	if(__kvf_internal_instance_api_version != 0)
+	{
+		app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		app_info.apiVersion = __kvf_internal_instance_api_version;
+		create_info.pApplicationInfo = &app_info;
+	}
 	create_info.enabledExtensionCount = extensions_count;
 	create_info.ppEnabledExtensionNames = extensions_enabled;
 	create_info.enabledLayerCount = 0;
@@ -1451,13 +3213,13 @@ VkInstance kvfCreateInstanceNext(const char** extensions_enabled, uint32_t exten
 
 #ifdef KVF_ENABLE_VALIDATION_LAYERS
 	kvfAddLayer("VK_LAYER_KHRONOS_validation");
+	__KvfScratchMarker marker = __kvfScratchMark();
 	const char** new_extension_set = NULL;
 	VkDebugUtilsMessengerCreateInfoEXT debug_create_info = {};
 	if(__kvfCheckValidationLayerSupport())
 	{
 		__kvfPopulateDebugMessengerCreateInfo(&debug_create_info);
-		new_extension_set = (const char**)KVF_MALLOC(sizeof(char*) * (extensions_count + 1));
-		KVF_ASSERT(new_extension_set != NULL && "allocation failed :(");
+		new_extension_set = (const char**)__kvfScratchPush(sizeof(char*) * (extensions_count + 1));
 		memcpy(new_extension_set, extensions_enabled, sizeof(char*) * extensions_count);
 		new_extension_set[extensions_count] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
 
@@ -1471,14 +3233,21 @@ VkInstance kvfCreateInstanceNext(const char** extensions_enabled, uint32_t exten
 	}
 #endif
 
-	__kvfCheckVk(KVF_GET_GLOBAL_FUNCTION(vkCreateInstance)(&create_info, NULL, &instance));
+	__kvfCheckVk(KVF_GET_GLOBAL_FUNCTION(vkCreateInstance)(&create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_INSTANCE), &instance));
+	if(instance != VK_NULL_HANDLE)
+		__kvf_internal_instances_count++;
 #ifdef KVF_ENABLE_VALIDATION_LAYERS
-	KVF_FREE(new_extension_set);
+	__kvfScratchRewind(marker);
 	__kvfInitValidationLayers(instance);
 #endif
 	return instance;
 }
 
+void kvfSetInstanceAPIVersion(uint32_t api_version)
+{
+	__kvf_internal_instance_api_version = api_version;
+}
+
 void kvfDestroyInstance(VkInstance instance)
 {
 	if(instance == VK_NULL_HANDLE)
@@ -1490,7 +3259,9 @@ void kvfDestroyInstance(VkInstance instance)
 	KVF_FREE(__kvf_extra_layers);
 	__kvf_extra_layers_count = 0;
 #endif
-	KVF_GET_INSTANCE_FUNCTION(vkDestroyInstance)(instance, NULL);
+	KVF_GET_INSTANCE_FUNCTION(vkDestroyInstance)(instance, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_INSTANCE));
+	if(__kvf_internal_instances_count != 0)
+		__kvf_internal_instances_count--;
 }
 
 __KvfQueueFamilies __kvfFindQueueFamilies(VkPhysicalDevice physical, VkSurfaceKHR surface)
@@ -1498,8 +3269,8 @@ __KvfQueueFamilies __kvfFindQueueFamilies(VkPhysicalDevice physical, VkSurfaceKH
 	__KvfQueueFamilies queues = { -1, -1, -1 };
 	uint32_t queue_family_count;
 	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, NULL);
-	VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)KVF_MALLOC(sizeof(VkQueueFamilyProperties) * queue_family_count);
-	KVF_ASSERT(queue_families != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)__kvfScratchPush(sizeof(VkQueueFamilyProperties) * queue_family_count);
 	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, queue_families);
 
 	for(uint32_t i = 0; i < queue_family_count; i++)
@@ -1528,7 +3299,7 @@ __KvfQueueFamilies __kvfFindQueueFamilies(VkPhysicalDevice physical, VkSurfaceKH
 				break;
 		#endif
 	}
-	KVF_FREE(queue_families);
+	__kvfScratchRewind(marker);
 	return queues;
 }
 
@@ -1541,11 +3312,11 @@ VkPhysicalDevice kvfPickFirstPhysicalDevice(VkInstance instance, VkSurfaceKHR su
 	KVF_ASSERT(instance != VK_NULL_HANDLE);
 
 	KVF_GET_INSTANCE_FUNCTION(vkEnumeratePhysicalDevices)(instance, &device_count, NULL);
-	devices = (VkPhysicalDevice*)KVF_MALLOC(sizeof(VkPhysicalDevice) * device_count + 1);
-	KVF_ASSERT(devices != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	devices = (VkPhysicalDevice*)__kvfScratchPush(sizeof(VkPhysicalDevice) * device_count);
 	KVF_GET_INSTANCE_FUNCTION(vkEnumeratePhysicalDevices)(instance, &device_count, devices);
 	chosen_one = devices[0];
-	KVF_FREE(devices);
+	__kvfScratchRewind(marker);
 	__KvfQueueFamilies queues = __kvfFindQueueFamilies(chosen_one, surface);
 	__kvfAddDeviceToArray(chosen_one, queues.graphics, queues.present, queues.present);
 	return chosen_one;
@@ -1562,8 +3333,8 @@ int32_t __kvfScorePhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface,
 	/* Check extensions support */
 	uint32_t extension_count;
 	KVF_GET_INSTANCE_FUNCTION(vkEnumerateDeviceExtensionProperties)(device, NULL, &extension_count, NULL);
-	VkExtensionProperties* props = (VkExtensionProperties*)KVF_MALLOC(sizeof(VkExtensionProperties) * extension_count + 1);
-	KVF_ASSERT(props != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	VkExtensionProperties* props = (VkExtensionProperties*)__kvfScratchPush(sizeof(VkExtensionProperties) * extension_count);
 	KVF_GET_INSTANCE_FUNCTION(vkEnumerateDeviceExtensionProperties)(device, NULL, &extension_count, props);
 
 	bool are_there_required_device_extensions = true;
@@ -1584,7 +3355,7 @@ int32_t __kvfScorePhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface,
 			break;
 		}
 	}
-	KVF_FREE(props);
+	__kvfScratchRewind(marker);
 	if(are_there_required_device_extensions == false)
 		return -1;
 
@@ -1630,8 +3401,8 @@ VkPhysicalDevice kvfPickGoodPhysicalDevice(VkInstance instance, VkSurfaceKHR sur
 	KVF_ASSERT(instance != VK_NULL_HANDLE);
 
 	KVF_GET_INSTANCE_FUNCTION(vkEnumeratePhysicalDevices)(instance, &device_count, NULL);
-	devices = (VkPhysicalDevice*)KVF_MALLOC(sizeof(VkPhysicalDevice) * device_count + 1);
-	KVF_ASSERT(devices != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	devices = (VkPhysicalDevice*)__kvfScratchPush(sizeof(VkPhysicalDevice) * device_count);
 	KVF_GET_INSTANCE_FUNCTION(vkEnumeratePhysicalDevices)(instance, &device_count, devices);
 
 	for(uint32_t i = 0; i < device_count; i++)
@@ -1643,7 +3414,7 @@ VkPhysicalDevice kvfPickGoodPhysicalDevice(VkInstance instance, VkSurfaceKHR sur
 			chosen_one = devices[i];
 		}
 	}
-	KVF_FREE(devices);
+	__kvfScratchRewind(marker);
 	if(chosen_one != VK_NULL_HANDLE)
 	{
 		__KvfQueueFamilies queues = __kvfFindQueueFamilies(chosen_one, surface);
@@ -1653,6 +3424,17 @@ VkPhysicalDevice kvfPickGoodPhysicalDevice(VkInstance instance, VkSurfaceKHR sur
 	return VK_NULL_HANDLE;
 }
 
+VkPhysicalDevice kvfPickGoodHeadlessPhysicalDevice(VkInstance instance)
+{
+	return kvfPickGoodPhysicalDevice(instance, VK_NULL_HANDLE, NULL, 0);
+}
+
+VkDevice kvfCreateHeadlessDevice(VkPhysicalDevice physical)
+{
+	VkPhysicalDeviceFeatures device_features = { VK_FALSE };
+	return kvfCreateDevice(physical, NULL, 0, &device_features);
+}
+
 VkDevice kvfCreateDefaultDevice(VkPhysicalDevice physical)
 {
 	const char* extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -1661,6 +3443,11 @@ VkDevice kvfCreateDefaultDevice(VkPhysicalDevice physical)
 }
 
 VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features)
+{
+	return kvfCreateDeviceNext(physical, extensions, extensions_count, features, NULL);
+}
+
+VkDevice kvfCreateDeviceNext(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, void* p_next)
 {
 	const float queue_priority = 1.0f;
 
@@ -1673,8 +3460,8 @@ VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uin
 	queue_count += (kvf_device->queues.present != -1);
 	queue_count += (kvf_device->queues.compute != -1);
 
-	VkDeviceQueueCreateInfo* queue_create_infos = (VkDeviceQueueCreateInfo*)KVF_MALLOC(queue_count * sizeof(VkDeviceQueueCreateInfo));
-	KVF_ASSERT(queue_create_infos != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	VkDeviceQueueCreateInfo* queue_create_infos = (VkDeviceQueueCreateInfo*)__kvfScratchPush(queue_count * sizeof(VkDeviceQueueCreateInfo));
 	size_t i = 0;
 	if(kvf_device->queues.graphics != -1)
 	{
@@ -1717,10 +3504,11 @@ VkDevice kvfCreateDevice(VkPhysicalDevice physical, const char** extensions, uin
 	createInfo.enabledLayerCount = 0;
 	createInfo.ppEnabledLayerNames = NULL;
 	createInfo.flags = 0;
-	createInfo.pNext = NULL;
+	createInfo.pNext = p_next;
 
 	VkDevice device;
-	__kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateDevice)(physical, &createInfo, NULL, &device));
+	__kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateDevice)(physical, &createInfo, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_DEVICE), &device));
+	__kvfScratchRewind(marker);
 	#ifndef KVF_IMPL_VK_NO_PROTOTYPES
 		__kvfCompleteDevice(physical, device);
 	#endif
@@ -1736,6 +3524,11 @@ VkDevice kvfCreateDefaultDevicePhysicalDeviceAndCustomQueues(VkPhysicalDevice ph
 }
 
 VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue)
+{
+	return kvfCreateDeviceCustomPhysicalDeviceAndQueuesNext(physical, extensions, extensions_count, features, graphics_queue, present_queue, compute_queue, NULL);
+}
+
+VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueuesNext(VkPhysicalDevice physical, const char** extensions, uint32_t extensions_count, VkPhysicalDeviceFeatures* features, int32_t graphics_queue, int32_t present_queue, int32_t compute_queue, void* p_next)
 {
 	const float queue_priority = 1.0f;
 
@@ -1744,8 +3537,8 @@ VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical,
 	queue_count += (present_queue != -1);
 	queue_count += (compute_queue != -1);
 
-	VkDeviceQueueCreateInfo* queue_create_infos = (VkDeviceQueueCreateInfo*)KVF_MALLOC(queue_count * sizeof(VkDeviceQueueCreateInfo));
-	KVF_ASSERT(queue_create_infos != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	VkDeviceQueueCreateInfo* queue_create_infos = (VkDeviceQueueCreateInfo*)__kvfScratchPush(queue_count * sizeof(VkDeviceQueueCreateInfo));
 	size_t i = 0;
 	if(graphics_queue != -1)
 	{
@@ -1788,10 +3581,11 @@ VkDevice kvfCreateDeviceCustomPhysicalDeviceAndQueues(VkPhysicalDevice physical,
 	createInfo.enabledLayerCount = 0;
 	createInfo.ppEnabledLayerNames = NULL;
 	createInfo.flags = 0;
-	createInfo.pNext = NULL;
+	createInfo.pNext = p_next;
 
 	VkDevice device;
-	__kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateDevice)(physical, &createInfo, NULL, &device));
+	__kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateDevice)(physical, &createInfo, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_DEVICE), &device));
+	__kvfScratchRewind(marker);
 	#ifndef KVF_IMPL_VK_NO_PROTOTYPES
 		__kvfCompleteDeviceCustomPhysicalDeviceAndQueues(physical, device, graphics_queue, present_queue, compute_queue);
 	#endif
@@ -1888,8 +3682,8 @@ int32_t kvfFindDeviceQueueFamily(VkPhysicalDevice physical, KvfQueueType type)
 
 	uint32_t queue_family_count;
 	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, NULL);
-	VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)KVF_MALLOC(sizeof(VkQueueFamilyProperties) * queue_family_count);
-	KVF_ASSERT(queue_families != NULL && "allocation failed :(");
+	__KvfScratchMarker marker = __kvfScratchMark();
+	VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)__kvfScratchPush(sizeof(VkQueueFamilyProperties) * queue_family_count);
 	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, queue_families);
 
 	int32_t queue = -1;
@@ -1912,7 +3706,7 @@ int32_t kvfFindDeviceQueueFamily(VkPhysicalDevice physical, KvfQueueType type)
 		if(queue != -1)
 			break;
 	}
-	KVF_FREE(queue_families);
+	__kvfScratchRewind(marker);
 	return queue;
 }
 
@@ -1927,8 +3721,8 @@ int32_t kvfFindDeviceQueueFamily(VkPhysicalDevice physical, KvfQueueType type)
 
 		uint32_t queue_family_count;
 		KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, NULL);
-		VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)KVF_MALLOC(sizeof(VkQueueFamilyProperties) * queue_family_count);
-		KVF_ASSERT(queue_families != NULL && "allocation failed :(");
+		__KvfScratchMarker marker = __kvfScratchMark();
+		VkQueueFamilyProperties* queue_families = (VkQueueFamilyProperties*)__kvfScratchPush(sizeof(VkQueueFamilyProperties) * queue_family_count);
 		KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)(physical, &queue_family_count, queue_families);
 
 		int32_t queue = -1;
@@ -1942,7 +3736,7 @@ int32_t kvfFindDeviceQueueFamily(VkPhysicalDevice physical, KvfQueueType type)
 			if(queue != -1)
 				break;
 		}
-		KVF_FREE(queue_families);
+		__kvfScratchRewind(marker);
 		return queue;
 	}
 #endif
@@ -1956,7 +3750,7 @@ VkFence kvfCreateFence(VkDevice device)
 	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 	VkFence fence;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateFence)(device, &fence_info, kvf_device->callbacks, &fence));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateFence)(device, &fence_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_FENCE), &fence));
 	return fence;
 }
 
@@ -1978,7 +3772,7 @@ void kvfDestroyFence(VkDevice device, VkFence fence)
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyFence)(device, fence, kvf_device->callbacks);
+	KVF_GET_DEVICE_FUNCTION(vkDestroyFence)(device, fence, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_FENCE));
 }
 
 VkSemaphore kvfCreateSemaphore(VkDevice device)
@@ -1989,7 +3783,7 @@ VkSemaphore kvfCreateSemaphore(VkDevice device)
 	VkSemaphoreCreateInfo semaphore_info = {};
 	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	VkSemaphore semaphore;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateSemaphore)(device, &semaphore_info, kvf_device->callbacks, &semaphore));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateSemaphore)(device, &semaphore_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SEMAPHORE), &semaphore));
 	return semaphore;
 }
 
@@ -2000,7 +3794,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroySemaphore)(device, semaphore, kvf_device->callbacks);
+	KVF_GET_DEVICE_FUNCTION(vkDestroySemaphore)(device, semaphore, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SEMAPHORE));
 }
 
 #include <stdio.h>
@@ -2159,7 +3953,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 		else
 			createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateSwapchainKHR)(device, &createInfo, kvf_device->callbacks, &swapchain));
+		__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateSwapchainKHR)(device, &createInfo, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SWAPCHAIN_KHR), &swapchain));
 
 		uint32_t images_count;
 		KVF_GET_DEVICE_FUNCTION(vkGetSwapchainImagesKHR)(device, swapchain, (uint32_t*)&images_count, NULL);
@@ -2222,7 +4016,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 					create_info.pNext = nullptr;
 					create_info.flags = 0;
 					create_info.window = (ANativeWindow*)window_handle;
-					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateAndroidSurfaceKHR)(instance, &create_info, NULL, &surface));
+					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateAndroidSurfaceKHR)(instance, &create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface));
 					break;
 				}
 			#endif
@@ -2236,7 +4030,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 					create_info.flags = 0;
 					create_info.dpy = (Display*)instance_handle;
 					create_info.window = *(Window*)window_handle;
-					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateXlibSurfaceKHR)(instance, &create_info, NULL, &surface));
+					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateXlibSurfaceKHR)(instance, &create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface));
 					break;
 				}
 			#endif
@@ -2250,7 +4044,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 					create_info.flags = 0;
 					create_info.connection = (xcb_connection_t*)instance_handle;
 					create_info.window = (*xcb_window_t*)window_handle;
-					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateXcbSurfaceKHR)(instance, &create_info, NULL, &surface));
+					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateXcbSurfaceKHR)(instance, &create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface));
 					break;
 				}
 			#endif
@@ -2264,7 +4058,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 					create_info.flags = 0;
 					create_info.display = (wl_display*)instance_handle;
 					create_info.surface = (wl_surface*)window_handle;
-					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateWaylandSurfaceKHR)(instance, &create_info, NULL, &surface));
+					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateWaylandSurfaceKHR)(instance, &create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface));
 					break;
 				}
 			#endif
@@ -2278,7 +4072,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 					create_info.flags = 0;
 					create_info.hinstance = (HINSTANCE)instance_handle;
 					create_info.hwnd = (HWND)window_handle;
-					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateWin32SurfaceKHR)(instance, &create_info, NULL, &surface));
+					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateWin32SurfaceKHR)(instance, &create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface));
 					break;
 				}
 			#endif
@@ -2291,7 +4085,7 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 					create_info.pNext = nullptr;
 					create_info.flags = 0;
 					create_info.pLayer = (CAMetalLayer*)window_handle;
-					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateMetalSurfaceEXT)(instance, &create_info, NULL, &surface));
+					kvfCheckVk(KVF_GET_INSTANCE_FUNCTION(vkCreateMetalSurfaceEXT)(instance, &create_info, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR), &surface));
 					break;
 				}
 			#endif
@@ -2300,40 +4094,220 @@ void kvfDestroySemaphore(VkDevice device, VkSemaphore semaphore)
 		}
 		return surface;
 	}
+
+	void kvfDestroySurfaceKHR(VkInstance instance, VkSurfaceKHR surface)
+	{
+		if(surface == VK_NULL_HANDLE)
+			return;
+		KVF_ASSERT(instance != VK_NULL_HANDLE);
+		KVF_GET_INSTANCE_FUNCTION(vkDestroySurfaceKHR)(instance, surface, __kvfGetInstanceAllocationCallbacks(VK_OBJECT_TYPE_SURFACE_KHR));
+	}
 #endif
 
 VkImage kvfCreateImage(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, KvfImageType type)
+{
+	VkExtent3D extent = { width, height, 1 };
+	switch(type)
+	{
+		case KVF_IMAGE_CUBE: return kvfCreateImageExtended(device, VK_IMAGE_TYPE_2D, extent, 1, 6, VK_SAMPLE_COUNT_1_BIT, format, tiling, usage, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
+		default: break;
+	}
+	return kvfCreateImageExtended(device, VK_IMAGE_TYPE_2D, extent, 1, 1, VK_SAMPLE_COUNT_1_BIT, format, tiling, usage, 0);
+}
+
+VkImage kvfCreateImageExtended(VkDevice device, VkImageType image_type, VkExtent3D extent, uint32_t mip_levels, uint32_t array_layers, VkSampleCountFlagBits samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(mip_levels >= 1 && mip_levels <= kvfGetMipLevelsCount(extent) && "invalid mip levels count");
+	KVF_ASSERT(array_layers >= 1 && "invalid array layers count");
+	KVF_ASSERT((samples == VK_SAMPLE_COUNT_1_BIT || mip_levels == 1) && "multisampled images cannot have mip levels");
+	KVF_ASSERT((image_type != VK_IMAGE_TYPE_3D || array_layers == 1) && "3D images cannot have array layers");
+	KVF_ASSERT((!(flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) || array_layers % 6 == 0) && "cube compatible images need a multiple of 6 layers");
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 	VkImageCreateInfo image_info = {};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	image_info.imageType = VK_IMAGE_TYPE_2D;
-	image_info.extent.width = width;
-	image_info.extent.height = height;
-	image_info.extent.depth = 1;
-	image_info.mipLevels = 1;
-	image_info.arrayLayers = 1;
+	image_info.flags = flags;
+	image_info.imageType = image_type;
+	image_info.extent = extent;
+	image_info.mipLevels = mip_levels;
+	image_info.arrayLayers = array_layers;
 	image_info.format = format;
 	image_info.tiling = tiling;
 	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	image_info.usage = usage;
-	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.samples = samples;
 	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	switch(type)
+	VkImage image;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateImage)(device, &image_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE), &image));
+	return image;
+}
+
+uint32_t kvfGetMipLevelsCount(VkExtent3D extent)
+{
+	uint32_t max_dimension = extent.width;
+	if(extent.height > max_dimension)
+		max_dimension = extent.height;
+	if(extent.depth > max_dimension)
+		max_dimension = extent.depth;
+	uint32_t levels = 1;
+	while(max_dimension > 1)
 	{
-		case KVF_IMAGE_CUBE: image_info.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT; image_info.arrayLayers = 6; break;
-		default: break;
+		max_dimension >>= 1;
+		levels++;
 	}
+	return levels;
+}
 
-	VkImage image;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateImage)(device, &image_info, kvf_device->callbacks, &image));
-	return image;
+VkExtent3D kvfGetMipLevelExtent(VkExtent3D extent, uint32_t mip_level)
+{
+	// Shifting a 32 bits extent by 32 or more is undefined, no image can have that many levels anyway
+	KVF_ASSERT(mip_level < 32 && "invalid mip level");
+	VkExtent3D mip_extent;
+	mip_extent.width = (extent.width >> mip_level) > 0 ? (extent.width >> mip_level) : 1;
+	mip_extent.height = (extent.height >> mip_level) > 0 ? (extent.height >> mip_level) : 1;
+	mip_extent.depth = (extent.depth >> mip_level) > 0 ? (extent.depth >> mip_level) : 1;
+	return mip_extent;
+}
+
+VkImageAspectFlags __kvfFormatAspect(VkFormat format)
+{
+	return kvfGetFormatInfo(format).aspect;
+}
+
+VkImageSubresourceRange kvfBuildImageSubresourceRange(VkFormat format, uint32_t base_mip_level, uint32_t mip_levels, uint32_t base_array_layer, uint32_t array_layers)
+{
+	VkImageSubresourceRange range = {};
+	range.aspectMask = __kvfFormatAspect(format);
+	range.baseMipLevel = base_mip_level;
+	range.levelCount = mip_levels;
+	range.baseArrayLayer = base_array_layer;
+	range.layerCount = array_layers;
+	return range;
+}
+
+VkImageSubresourceLayers kvfBuildImageSubresourceLayers(VkFormat format, uint32_t mip_level, uint32_t base_array_layer, uint32_t array_layers)
+{
+	VkImageSubresourceLayers layers = {};
+	layers.aspectMask = __kvfFormatAspect(format);
+	KVF_ASSERT((layers.aspectMask & (layers.aspectMask - 1)) == 0 && "format has several aspects, set the aspect of the copy explicitly");
+	layers.mipLevel = mip_level;
+	layers.baseArrayLayer = base_array_layer;
+	layers.layerCount = array_layers;
+	return layers;
+}
+
+bool kvfGenerateMipmaps(VkDevice device, VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent3D extent, uint32_t levels, uint32_t layers)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	KVF_ASSERT(levels >= 1 && layers >= 1);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	VkFormatProperties props;
+	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceFormatProperties)(kvf_device->physical, format, &props);
+	VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+	if((props.optimalTilingFeatures & blit_features) != blit_features)
+		return false;
+	VkFilter filter = (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkImageAspectFlags aspect = __kvfFormatAspect(format);
+	if(aspect != VK_IMAGE_ASPECT_COLOR_BIT)
+		filter = VK_FILTER_NEAREST; // Depth/stencil blits only allow nearest filtering
+	VkPipelineStageFlags shader_stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	VkImageMemoryBarrier barriers[2];
+	for(int i = 0; i < 2; i++)
+	{
+		memset(&barriers[i], 0, sizeof(VkImageMemoryBarrier));
+		barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].image = image;
+		barriers[i].subresourceRange.aspectMask = aspect;
+		barriers[i].subresourceRange.levelCount = 1;
+		barriers[i].subresourceRange.baseArrayLayer = 0;
+		barriers[i].subresourceRange.layerCount = layers;
+	}
+
+	// Level 0 becomes the first blit source, or is directly readable if there is no chain to build
+	barriers[0].subresourceRange.baseMipLevel = 0;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	if(levels == 1)
+	{
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, shader_stages, 0, 0, NULL, 0, NULL, 1, barriers);
+		return true;
+	}
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, barriers);
+
+	int32_t width = (int32_t)extent.width;
+	int32_t height = (int32_t)extent.height;
+	int32_t depth = (int32_t)extent.depth;
+	for(uint32_t i = 1; i < levels; i++)
+	{
+		VkImageBlit blit = {};
+		blit.srcOffsets[1].x = width;
+		blit.srcOffsets[1].y = height;
+		blit.srcOffsets[1].z = depth;
+		width = (width > 1 ? width / 2 : 1);
+		height = (height > 1 ? height / 2 : 1);
+		depth = (depth > 1 ? depth / 2 : 1);
+		blit.dstOffsets[1].x = width;
+		blit.dstOffsets[1].y = height;
+		blit.dstOffsets[1].z = depth;
+		blit.srcSubresource.aspectMask = aspect;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = layers;
+		blit.dstSubresource = blit.srcSubresource;
+		blit.dstSubresource.mipLevel = i;
+		KVF_GET_DEVICE_FUNCTION(vkCmdBlitImage)(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+		// The source level is done, the level just written becomes the next source (or is done if it is the last one)
+		barriers[0].subresourceRange.baseMipLevel = i - 1;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		barriers[1].subresourceRange.baseMipLevel = i;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		if(i == levels - 1)
+		{
+			barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		}
+		else
+		{
+			barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		}
+		KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | shader_stages, 0, 0, NULL, 0, NULL, 2, barriers);
+	}
+	return true;
 }
 
 void kvfCopyImageToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkImage src, size_t buffer_offset, VkImageAspectFlagBits aspect, VkExtent3D extent)
+{
+	VkOffset3D offset = { 0, 0, 0 };
+	VkImageSubresourceLayers subresource = {};
+	subresource.aspectMask = aspect;
+	subresource.mipLevel = 0;
+	subresource.baseArrayLayer = 0;
+	subresource.layerCount = 1;
+	kvfCopyImageSubresourceToBuffer(cmd, dst, src, buffer_offset, subresource, offset, extent);
+}
+
+void kvfCopyImageSubresourceToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkImage src, size_t buffer_offset, VkImageSubresourceLayers subresource, VkOffset3D offset, VkExtent3D extent)
 {
 	KVF_ASSERT(cmd != VK_NULL_HANDLE);
 	KVF_ASSERT(dst != VK_NULL_HANDLE);
@@ -2342,15 +4316,11 @@ void kvfCopyImageToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkImage src, size_t
 		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
 		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 	#endif
-	VkOffset3D offset = { 0, 0, 0 };
 	VkBufferImageCopy region = {};
 	region.bufferOffset = buffer_offset;
 	region.bufferRowLength = 0;
 	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = aspect;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
+	region.imageSubresource = subresource;
 	region.imageOffset = offset;
 	region.imageExtent = extent;
 	KVF_GET_DEVICE_FUNCTION(vkCmdCopyImageToBuffer)(cmd, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, 1, &region);
@@ -2375,370 +4345,1924 @@ void kvfDestroyImage(VkDevice device, VkImage image)
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyImage)(device, image, kvf_device->callbacks);
+	if(__kvfGetKvfTrackedImageFromVkImage(image) != NULL)
+		kvfUnregisterImage(image);
+	if(kvf_device->image_views_size != 0)
+		kvfInvalidateCachedImageViews(device, image);
+	KVF_GET_DEVICE_FUNCTION(vkDestroyImage)(device, image, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE));
 }
 
-VkImageView kvfCreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageAspectFlags aspect, int layer_count)
+VkImage kvfCreateTransientAttachment(VkDevice device, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits samples, VkDeviceMemory* memory)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(memory != NULL);
+	KVF_ASSERT((usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)) == 0 && "transient attachments can only have attachment usages");
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkImageViewCreateInfo create_info = {};
-	create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	create_info.image = image;
-	create_info.viewType = type;
-	create_info.format = format;
-	create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-	create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-	create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-	create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-	create_info.subresourceRange.aspectMask = aspect;
-	create_info.subresourceRange.baseMipLevel = 0;
-	create_info.subresourceRange.levelCount = 1;
-	create_info.subresourceRange.baseArrayLayer = 0;
-	create_info.subresourceRange.layerCount = layer_count;
-	VkImageView view;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateImageView)(device, &create_info, kvf_device->callbacks, &view));
-	return view;
+	VkImageCreateInfo image_info = {};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.extent.width = width;
+	image_info.extent.height = height;
+	image_info.extent.depth = 1;
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.format = format;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_info.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	image_info.samples = samples;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkImage image;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateImage)(device, &image_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE), &image));
+
+	VkMemoryRequirements requirements;
+	KVF_GET_DEVICE_FUNCTION(vkGetImageMemoryRequirements)(device, image, &requirements);
+
+	int32_t memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+	if(memory_type == -1)
+		memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	KVF_ASSERT(memory_type != -1 && "could not find a memory type for a transient attachment");
+
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateMemory)(device, &alloc_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY), memory));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBindImageMemory)(device, image, *memory, 0));
+	return image;
 }
 
-void kvfDestroyImageView(VkDevice device, VkImageView image_view)
+void kvfDestroyTransientAttachment(VkDevice device, VkImage image, VkDeviceMemory memory)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(image_view != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyImageView)(device, image_view, kvf_device->callbacks);
+	kvfDestroyImage(device, image);
+	if(memory != VK_NULL_HANDLE)
+		KVF_GET_DEVICE_FUNCTION(vkFreeMemory)(device, memory, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY));
 }
 
-void kvfTransitionImageLayout(VkDevice device, VkImage image, KvfImageType type, VkCommandBuffer cmd, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, bool is_single_time_cmd_buffer)
+KvfAliasingAllocator* kvfCreateAliasingAllocator(VkDevice device)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(cmd != VK_NULL_HANDLE);
-
-	if(new_layout == old_layout)
-		return;
+	KvfAliasingAllocator* allocator = (KvfAliasingAllocator*)KVF_MALLOC(sizeof(KvfAliasingAllocator));
+	KVF_ASSERT(allocator != NULL && "allocation failed :(");
+	memset(allocator, 0, sizeof(KvfAliasingAllocator));
+	allocator->device = device;
+	return allocator;
+}
 
+void kvfAliasingAllocatorAddImage(KvfAliasingAllocator* allocator, VkImage image, uint32_t first_use, uint32_t last_use)
+{
+	KVF_ASSERT(allocator != NULL);
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	KVF_ASSERT(first_use <= last_use && "invalid image lifetime");
+	KVF_ASSERT(!allocator->baked && "cannot add images to an aliasing allocator after baking it");
 	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(allocator->device);
 		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 	#endif
 
-	if(is_single_time_cmd_buffer)
-		kvfBeginCommandBuffer(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	if(allocator->images_size == allocator->images_capacity)
+	{
+		allocator->images_capacity += 16;
+		allocator->images = (__KvfAliasedImage*)KVF_REALLOC(allocator->images, sizeof(__KvfAliasedImage) * allocator->images_capacity);
+		KVF_ASSERT(allocator->images != NULL && "allocation failed :(");
+	}
+	__KvfAliasedImage* aliased = &allocator->images[allocator->images_size];
+	aliased->image = image;
+	aliased->first_use = first_use;
+	aliased->last_use = last_use;
+	aliased->offset = 0;
+	aliased->memory_type = -1;
+	KVF_GET_DEVICE_FUNCTION(vkGetImageMemoryRequirements)(allocator->device, image, &aliased->requirements);
+	allocator->unaliased_size += aliased->requirements.size;
+	allocator->images_size++;
+}
 
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = old_layout;
-	barrier.newLayout = new_layout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = image;
-	barrier.subresourceRange.aspectMask = kvfIsDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = (type == KVF_IMAGE_CUBE ? 6 : 1);
-	barrier.srcAccessMask = kvfLayoutToAccessMask(old_layout, false);
-	barrier.dstAccessMask = kvfLayoutToAccessMask(new_layout, true);
-	if(kvfIsStencilFormat(format))
-		barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-
-	VkPipelineStageFlags source_stage = 0;
-	if(barrier.oldLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
-		source_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	else if(barrier.srcAccessMask != 0)
-		source_stage = kvfAccessFlagsToPipelineStage(barrier.srcAccessMask, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-	else
-		source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+// Greedy placement, biggest images first, each one at the lowest offset that does not overlap
+// an already placed image that is alive at the same time. Returns the size of the memory block
+VkDeviceSize __kvfAliasingAllocatorPlace(__KvfAliasedImage** images, size_t images_count)
+{
+	// Insertion sort by size, lists are small
+	for(size_t i = 1; i < images_count; i++)
+	{
+		__KvfAliasedImage* current = images[i];
+		size_t j = i;
+		for(; j > 0 && images[j - 1]->requirements.size < current->requirements.size; j--)
+			images[j] = images[j - 1];
+		images[j] = current;
+	}
 
-	VkPipelineStageFlags destination_stage = 0;
-	if(barrier.newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
-		destination_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	else if(barrier.dstAccessMask != 0)
-		destination_stage = kvfAccessFlagsToPipelineStage(barrier.dstAccessMask, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-	else
-		destination_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	VkDeviceSize block_size = 0;
+	for(size_t i = 0; i < images_count; i++)
+	{
+		__KvfAliasedImage* current = images[i];
+		VkDeviceSize alignment = current->requirements.alignment != 0 ? current->requirements.alignment : 1;
+		VkDeviceSize best = (VkDeviceSize)-1;
 
-	KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, source_stage, destination_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+		// Candidate offsets are the start of the block and the end of every conflicting image
+		for(size_t c = 0; c <= i; c++)
+		{
+			VkDeviceSize candidate = 0;
+			if(c < i)
+			{
+				if(images[c]->first_use > current->last_use || current->first_use > images[c]->last_use)
+					continue;
+				candidate = images[c]->offset + images[c]->requirements.size;
+			}
+			candidate = (candidate + alignment - 1) / alignment * alignment;
+			if(candidate >= best)
+				continue;
 
-	if(is_single_time_cmd_buffer)
-	{
-		kvfEndCommandBuffer(cmd);
-		VkFence fence = kvfCreateFence(device);
-		kvfSubmitSingleTimeCommandBuffer(device, cmd, KVF_GRAPHICS_QUEUE, fence);
-		kvfDestroyFence(device, fence);
+			bool fits = true;
+			for(size_t k = 0; k < i && fits; k++)
+			{
+				if(images[k]->first_use > current->last_use || current->first_use > images[k]->last_use)
+					continue;
+				if(candidate < images[k]->offset + images[k]->requirements.size && images[k]->offset < candidate + current->requirements.size)
+					fits = false;
+			}
+			if(fits)
+				best = candidate;
+		}
+		current->offset = best;
+		if(best + current->requirements.size > block_size)
+			block_size = best + current->requirements.size;
 	}
+	return block_size;
 }
 
-VkSampler kvfCreateSampler(VkDevice device, VkFilter filters, VkSamplerAddressMode address_modes, VkSamplerMipmapMode mipmap_mode)
+void kvfAliasingAllocatorBake(KvfAliasingAllocator* allocator, VkMemoryPropertyFlags properties)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(allocator != NULL);
+	KVF_ASSERT(!allocator->baked && "aliasing allocator has already been baked");
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(allocator->device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkSamplerCreateInfo info = {};
-	info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	info.magFilter = filters;
-	info.minFilter = filters;
-	info.mipmapMode = mipmap_mode;
-	info.addressModeU = address_modes;
-	info.addressModeV = address_modes;
-	info.addressModeW = address_modes;
-	info.minLod = -1000;
-	info.maxLod = 1000;
-	info.anisotropyEnable = VK_FALSE;
-	info.maxAnisotropy = 1.0f;
-	VkSampler sampler;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateSampler)(device, &info, kvf_device->callbacks, &sampler));
-	return sampler;
+	allocator->baked = true;
+	if(allocator->images_size == 0)
+		return;
+
+	for(size_t i = 0; i < allocator->images_size; i++)
+	{
+		allocator->images[i].memory_type = kvfFindMemoryType(kvf_device->physical, allocator->images[i].requirements.memoryTypeBits, properties);
+		KVF_ASSERT(allocator->images[i].memory_type != -1 && "could not find a suitable memory type for an aliased image");
+	}
+
+	__KvfScratchMarker marker = __kvfScratchMark();
+	__KvfAliasedImage** group = (__KvfAliasedImage**)__kvfScratchPush(sizeof(__KvfAliasedImage*) * allocator->images_size);
+	allocator->memories = (VkDeviceMemory*)KVF_MALLOC(sizeof(VkDeviceMemory) * allocator->images_size);
+	KVF_ASSERT(allocator->memories != NULL && "allocation failed :(");
+
+	// Images can only share memory with images using the same memory type, one block per type
+	for(size_t i = 0; i < allocator->images_size; i++)
+	{
+		int32_t memory_type = allocator->images[i].memory_type;
+		bool already_done = false;
+		for(size_t j = 0; j < i && !already_done; j++)
+			already_done = (allocator->images[j].memory_type == memory_type);
+		if(already_done)
+			continue;
+
+		size_t group_size = 0;
+		for(size_t j = i; j < allocator->images_size; j++)
+		{
+			if(allocator->images[j].memory_type == memory_type)
+				group[group_size++] = &allocator->images[j];
+		}
+		VkDeviceSize block_size = __kvfAliasingAllocatorPlace(group, group_size);
+
+		VkMemoryAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = block_size;
+		alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+		VkDeviceMemory memory;
+		__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateMemory)(allocator->device, &alloc_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY), &memory));
+		for(size_t j = 0; j < group_size; j++)
+			__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBindImageMemory)(allocator->device, group[j]->image, memory, group[j]->offset));
+		allocator->memories[allocator->memories_size] = memory;
+		allocator->memories_size++;
+		allocator->memory_size += block_size;
+	}
+	__kvfScratchRewind(marker);
 }
 
-void kvfDestroySampler(VkDevice device, VkSampler sampler)
+VkDeviceSize kvfAliasingAllocatorGetMemorySize(KvfAliasingAllocator* allocator)
 {
-	if(sampler == VK_NULL_HANDLE)
+	KVF_ASSERT(allocator != NULL);
+	return allocator->memory_size;
+}
+
+VkDeviceSize kvfAliasingAllocatorGetUnaliasedSize(KvfAliasingAllocator* allocator)
+{
+	KVF_ASSERT(allocator != NULL);
+	return allocator->unaliased_size;
+}
+
+void kvfDestroyAliasingAllocator(KvfAliasingAllocator* allocator)
+{
+	if(allocator == NULL)
 		return;
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(allocator->device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroySampler)(device, sampler, kvf_device->callbacks);
+	for(size_t i = 0; i < allocator->memories_size; i++)
+		KVF_GET_DEVICE_FUNCTION(vkFreeMemory)(allocator->device, allocator->memories[i], __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY));
+	KVF_FREE(allocator->memories);
+	KVF_FREE(allocator->images);
+	KVF_FREE(allocator);
 }
 
-VkBuffer kvfCreateBuffer(VkDevice device, VkBufferUsageFlags usage, VkDeviceSize size)
+VkImageView kvfCreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageAspectFlags aspect, int layer_count)
+{
+	VkImageSubresourceRange range = {};
+	range.aspectMask = aspect;
+	range.baseMipLevel = 0;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = layer_count;
+	return kvfCreateImageViewRange(device, image, format, type, range);
+}
+
+VkImageView kvfCreateImageViewRange(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageSubresourceRange range)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkBufferCreateInfo buffer_info = {};
-	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	buffer_info.size = size;
-	buffer_info.usage = usage;
-	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	VkBuffer buffer;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateBuffer)(device, &buffer_info, kvf_device->callbacks, &buffer));
-	return buffer;
+	VkImageViewCreateInfo create_info = {};
+	create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	create_info.image = image;
+	create_info.viewType = type;
+	create_info.format = format;
+	create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+	create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+	create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+	create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	create_info.subresourceRange = range;
+	VkImageView view;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateImageView)(device, &create_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE_VIEW), &view));
+	return view;
 }
 
-void kvfCopyBufferToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkBuffer src, size_t size, size_t src_offset, size_t dst_offset)
+void kvfDestroyImageView(VkDevice device, VkImageView image_view)
 {
-	KVF_ASSERT(cmd != VK_NULL_HANDLE);
-	KVF_ASSERT(dst != VK_NULL_HANDLE);
-	KVF_ASSERT(src != VK_NULL_HANDLE);
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkBufferCopy copy_region = {};
-	copy_region.size = size;
-	copy_region.srcOffset = src_offset;
-	copy_region.dstOffset = dst_offset;
-	KVF_GET_DEVICE_FUNCTION(vkCmdCopyBuffer)(cmd, src, dst, 1, &copy_region);
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(image_view != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	if(kvf_device->descriptor_sets_size != 0)
+		kvfInvalidateCachedDescriptorSets(device, VK_NULL_HANDLE, image_view);
+	KVF_GET_DEVICE_FUNCTION(vkDestroyImageView)(device, image_view, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE_VIEW));
 }
 
-void kvfCopyBufferToImage(VkCommandBuffer cmd, VkImage dst, VkBuffer src, size_t buffer_offset, VkImageAspectFlagBits aspect, VkExtent3D extent)
+// Returns the slot holding the key, or the empty slot where it should be inserted
+__KvfImageViewCacheEntry* __kvfImageViewCacheFind(__KvfDevice* kvf_device, const __KvfImageViewCacheKey* key, uint32_t hash)
 {
-	KVF_ASSERT(cmd != VK_NULL_HANDLE);
-	KVF_ASSERT(dst != VK_NULL_HANDLE);
-	KVF_ASSERT(src != VK_NULL_HANDLE);
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkOffset3D offset = { 0, 0, 0 };
-	VkBufferImageCopy region = {};
-	region.bufferOffset = buffer_offset;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = aspect;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = offset;
-	region.imageExtent = extent;
-	KVF_GET_DEVICE_FUNCTION(vkCmdCopyBufferToImage)(cmd, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	size_t mask = kvf_device->image_views_capacity - 1;
+	for(size_t i = hash & mask;; i = (i + 1) & mask)
+	{
+		__KvfImageViewCacheEntry* entry = &kvf_device->image_views[i];
+		if(entry->view == VK_NULL_HANDLE)
+			return entry;
+		if(entry->hash == hash && memcmp(&entry->key, key, sizeof(__KvfImageViewCacheKey)) == 0)
+			return entry;
+	}
 }
 
-void kvfDestroyBuffer(VkDevice device, VkBuffer buffer)
+void __kvfImageViewCacheGrow(__KvfDevice* kvf_device)
+{
+	__KvfImageViewCacheEntry* old_views = kvf_device->image_views;
+	size_t old_capacity = kvf_device->image_views_capacity;
+	kvf_device->image_views_capacity = (old_capacity == 0 ? 32 : old_capacity * 2);
+	kvf_device->image_views = (__KvfImageViewCacheEntry*)KVF_MALLOC(sizeof(__KvfImageViewCacheEntry) * kvf_device->image_views_capacity);
+	KVF_ASSERT(kvf_device->image_views != NULL && "allocation failed :(");
+	memset(kvf_device->image_views, 0, sizeof(__KvfImageViewCacheEntry) * kvf_device->image_views_capacity);
+	for(size_t i = 0; i < old_capacity; i++)
+	{
+		if(old_views[i].view != VK_NULL_HANDLE)
+			*__kvfImageViewCacheFind(kvf_device, &old_views[i].key, old_views[i].hash) = old_views[i];
+	}
+	KVF_FREE(old_views);
+}
+
+VkImageView kvfGetCachedImageView(VkDevice device, VkImage image, VkFormat format, VkImageViewType type, VkImageSubresourceRange range)
 {
-	if(buffer == VK_NULL_HANDLE)
-		return;
 	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(image != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyBuffer)(device, buffer, kvf_device->callbacks);
+
+	if(range.aspectMask == 0)
+		range.aspectMask = __kvfFormatAspect(format);
+
+	// Zeroed so that the padding bytes do not change the hash
+	__KvfImageViewCacheKey key;
+	memset(&key, 0, sizeof(__KvfImageViewCacheKey));
+	key.image = image;
+	key.format = format;
+	key.type = type;
+	key.range = range;
+	uint32_t hash = __kvfHashBytes(&key, sizeof(__KvfImageViewCacheKey), __KVF_FNV_OFFSET_BASIS);
+
+	// Keeps the load factor under 3/4
+	if((kvf_device->image_views_size + 1) * 4 > kvf_device->image_views_capacity * 3)
+		__kvfImageViewCacheGrow(kvf_device);
+
+	__KvfImageViewCacheEntry* entry = __kvfImageViewCacheFind(kvf_device, &key, hash);
+	if(entry->view != VK_NULL_HANDLE)
+		return entry->view;
+	entry->key = key;
+	entry->view = kvfCreateImageViewRange(device, image, format, type, range);
+	entry->hash = hash;
+	kvf_device->image_views_size++;
+	return entry->view;
 }
 
-VkFramebuffer kvfCreateFramebuffer(VkDevice device, VkRenderPass render_pass, VkImageView* image_views, size_t image_views_count, VkExtent2D extent)
+void kvfInvalidateCachedImageViews(VkDevice device, VkImage image)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(image_views != NULL);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkFramebufferCreateInfo framebuffer_info = {};
-	framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-	framebuffer_info.renderPass = render_pass;
-	framebuffer_info.attachmentCount = image_views_count;
-	framebuffer_info.pAttachments = image_views;
-	framebuffer_info.width = extent.width;
-	framebuffer_info.height = extent.height;
-	framebuffer_info.layers = 1;
-	VkFramebuffer framebuffer = VK_NULL_HANDLE;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateFramebuffer)(device, &framebuffer_info, kvf_device->callbacks, &framebuffer));
-	__kvfAddFramebufferToArray(framebuffer, extent);
-	return framebuffer;
+
+	size_t mask = kvf_device->image_views_capacity - 1;
+	size_t i = 0;
+	while(i < kvf_device->image_views_capacity)
+	{
+		if(kvf_device->image_views[i].view == VK_NULL_HANDLE || kvf_device->image_views[i].key.image != image)
+		{
+			i++;
+			continue;
+		}
+		if(kvf_device->descriptor_sets_size != 0)
+			kvfInvalidateCachedDescriptorSets(device, VK_NULL_HANDLE, kvf_device->image_views[i].view);
+		KVF_GET_DEVICE_FUNCTION(vkDestroyImageView)(device, kvf_device->image_views[i].view, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_IMAGE_VIEW));
+		kvf_device->image_views_size--;
+
+		// Shift back the following entries of the probe sequence to fill the gap,
+		// slot i is checked again as it may have received another view of the image
+		size_t gap = i;
+		for(size_t j = (i + 1) & mask; kvf_device->image_views[j].view != VK_NULL_HANDLE; j = (j + 1) & mask)
+		{
+			size_t home = kvf_device->image_views[j].hash & mask;
+			bool stays = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+			if(stays)
+				continue;
+			kvf_device->image_views[gap] = kvf_device->image_views[j];
+			gap = j;
+		}
+		kvf_device->image_views[gap].view = VK_NULL_HANDLE;
+	}
 }
 
-VkExtent2D kvfGetFramebufferSize(VkFramebuffer buffer)
+void __kvfFillImageTransitionBarrier(VkImageMemoryBarrier* barrier, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, VkImageSubresourceRange range)
 {
-	__KvfFramebuffer* kvf_framebuffer = __kvfGetKvfFramebufferFromVkFramebuffer(buffer);
-	KVF_ASSERT(kvf_framebuffer != NULL);
-	return kvf_framebuffer->extent;
+	memset(barrier, 0, sizeof(VkImageMemoryBarrier));
+	barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier->oldLayout = old_layout;
+	barrier->newLayout = new_layout;
+	barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier->image = image;
+	barrier->subresourceRange = range;
+	barrier->srcAccessMask = kvfLayoutToAccessMask(old_layout, false);
+	barrier->dstAccessMask = kvfLayoutToAccessMask(new_layout, true);
+	if(barrier->subresourceRange.aspectMask == 0)
+		barrier->subresourceRange.aspectMask = __kvfFormatAspect(format);
 }
 
-void kvfDestroyFramebuffer(VkDevice device, VkFramebuffer framebuffer)
+void __kvfComputeImageBarrierStages(const VkImageMemoryBarrier* barrier, VkPipelineStageFlags* source_stage, VkPipelineStageFlags* destination_stage)
 {
-	if(framebuffer == VK_NULL_HANDLE)
-		return;
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__kvfDestroyFramebuffer(device, framebuffer);
+	if(barrier->oldLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+		*source_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	else if(barrier->srcAccessMask != 0)
+		*source_stage = kvfAccessFlagsToPipelineStage(barrier->srcAccessMask, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	else
+		*source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+	if(barrier->newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+		*destination_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	else if(barrier->dstAccessMask != 0)
+		*destination_stage = kvfAccessFlagsToPipelineStage(barrier->dstAccessMask, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	else
+		*destination_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 }
 
-VkCommandBuffer kvfCreateCommandBuffer(VkDevice device)
+void kvfTransitionImageLayout(VkDevice device, VkImage image, KvfImageType type, VkCommandBuffer cmd, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, bool is_single_time_cmd_buffer)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	return kvfCreateCommandBufferLeveled(device, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	VkImageSubresourceRange range = {};
+	range.aspectMask = 0;
+	range.baseMipLevel = 0;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = (type == KVF_IMAGE_CUBE ? 6 : 1);
+	kvfTransitionImageLayoutRange(device, image, cmd, format, old_layout, new_layout, range, is_single_time_cmd_buffer);
 }
 
-VkCommandBuffer kvfCreateCommandBufferLeveled(VkDevice device, VkCommandBufferLevel level)
+void kvfTransitionImageLayoutRange(VkDevice device, VkImage image, VkCommandBuffer cmd, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, VkImageSubresourceRange range, bool is_single_time_cmd_buffer)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
 
-	VkCommandPool pool = kvf_device->cmd_pool;
-	VkCommandBuffer buffer;
-	VkCommandBufferAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	alloc_info.commandPool = pool;
-	alloc_info.level = level;
-	alloc_info.commandBufferCount = 1;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateCommandBuffers)(device, &alloc_info, &buffer));
+	if(new_layout == old_layout)
+		return;
 
-	if(kvf_device->cmd_buffers_size >= kvf_device->cmd_buffers_capacity)
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+
+	if(is_single_time_cmd_buffer)
+		kvfBeginCommandBuffer(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	VkImageMemoryBarrier barrier;
+	__kvfFillImageTransitionBarrier(&barrier, image, format, old_layout, new_layout, range);
+
+	VkPipelineStageFlags source_stage;
+	VkPipelineStageFlags destination_stage;
+	__kvfComputeImageBarrierStages(&barrier, &source_stage, &destination_stage);
+
+	KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, source_stage, destination_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+	if(is_single_time_cmd_buffer)
 	{
-		// Resize the dynamic array if necessary
-		kvf_device->cmd_buffers_capacity += KVF_COMMAND_POOL_CAPACITY;
-		kvf_device->cmd_buffers = (VkCommandBuffer*)KVF_REALLOC(kvf_device->cmd_buffers, kvf_device->cmd_buffers_capacity * sizeof(VkCommandBuffer));
-		KVF_ASSERT(kvf_device->cmd_buffers != NULL && "allocation failed :(");
+		kvfEndCommandBuffer(cmd);
+		VkFence fence = kvfCreateFence(device);
+		kvfSubmitSingleTimeCommandBuffer(device, cmd, KVF_GRAPHICS_QUEUE, fence);
+		kvfDestroyFence(device, fence);
 	}
-	kvf_device->cmd_buffers[kvf_device->cmd_buffers_size] = buffer;
-	kvf_device->cmd_buffers_size++;
-	return buffer;
 }
 
-void kvfBeginCommandBuffer(VkCommandBuffer buffer, VkCommandBufferUsageFlags usage)
+KvfBarrierBatch* kvfCreateBarrierBatch()
 {
-	KVF_ASSERT(buffer != VK_NULL_HANDLE);
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(buffer);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkCommandBufferBeginInfo begin_info = {};
-	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	begin_info.flags = usage;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBeginCommandBuffer)(buffer, &begin_info));
+	KvfBarrierBatch* batch = (KvfBarrierBatch*)KVF_MALLOC(sizeof(KvfBarrierBatch));
+	KVF_ASSERT(batch != NULL && "allocation failed :(");
+	memset(batch, 0, sizeof(KvfBarrierBatch));
+	return batch;
 }
 
-void kvfEndCommandBuffer(VkCommandBuffer buffer)
+void kvfDestroyBarrierBatch(KvfBarrierBatch* batch)
 {
-	KVF_ASSERT(buffer != VK_NULL_HANDLE);
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(buffer);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkEndCommandBuffer)(buffer));
+	if(batch == NULL)
+		return;
+	KVF_FREE(batch->image_barriers);
+	KVF_FREE(batch->buffer_barriers);
+	KVF_FREE(batch);
 }
 
-void kvfSubmitCommandBuffer(VkDevice device, VkCommandBuffer buffer, KvfQueueType queue, VkSemaphore signal, VkSemaphore wait, VkFence fence, VkPipelineStageFlags* stages)
+void kvfBarrierBatchAddImageTransition(KvfBarrierBatch* batch, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, VkImageSubresourceRange range)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(batch != NULL);
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	// Same layout transitions are not dropped, e.g. GENERAL to GENERAL orders storage writes before later accesses
+	VkImageMemoryBarrier barrier;
+	__kvfFillImageTransitionBarrier(&barrier, image, format, old_layout, new_layout, range);
+	VkPipelineStageFlags source_stage;
+	VkPipelineStageFlags destination_stage;
+	__kvfComputeImageBarrierStages(&barrier, &source_stage, &destination_stage);
+	kvfBarrierBatchAddImageBarrier(batch, &barrier, source_stage, destination_stage);
+}
 
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkSemaphore signal_semaphores[1];
-	VkSemaphore wait_semaphores[1];
-	signal_semaphores[0] = signal;
-	wait_semaphores[0] = wait;
+void kvfBarrierBatchAddImageBarrier(KvfBarrierBatch* batch, const VkImageMemoryBarrier* barrier, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+{
+	KVF_ASSERT(batch != NULL);
+	KVF_ASSERT(barrier != NULL);
+	if(batch->image_barriers_size == batch->image_barriers_capacity)
+	{
+		batch->image_barriers_capacity += 8;
+		batch->image_barriers = (VkImageMemoryBarrier*)KVF_REALLOC(batch->image_barriers, sizeof(VkImageMemoryBarrier) * batch->image_barriers_capacity);
+		KVF_ASSERT(batch->image_barriers != NULL && "allocation failed :(");
+	}
+	batch->image_barriers[batch->image_barriers_size] = *barrier;
+	batch->image_barriers_size++;
+	batch->src_stages |= src_stage;
+	batch->dst_stages |= dst_stage;
+}
 
-	if(fence != VK_NULL_HANDLE)
-		KVF_GET_DEVICE_FUNCTION(vkResetFences)(device, 1, &fence);
+void kvfBarrierBatchAddBufferBarrier(KvfBarrierBatch* batch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+{
+	KVF_ASSERT(batch != NULL);
+	KVF_ASSERT(buffer != VK_NULL_HANDLE);
+	if(batch->buffer_barriers_size == batch->buffer_barriers_capacity)
+	{
+		batch->buffer_barriers_capacity += 8;
+		batch->buffer_barriers = (VkBufferMemoryBarrier*)KVF_REALLOC(batch->buffer_barriers, sizeof(VkBufferMemoryBarrier) * batch->buffer_barriers_capacity);
+		KVF_ASSERT(batch->buffer_barriers != NULL && "allocation failed :(");
+	}
+	VkBufferMemoryBarrier* barrier = &batch->buffer_barriers[batch->buffer_barriers_size];
+	memset(barrier, 0, sizeof(VkBufferMemoryBarrier));
+	barrier->sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier->srcAccessMask = src_access;
+	barrier->dstAccessMask = dst_access;
+	barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier->buffer = buffer;
+	barrier->offset = offset;
+	barrier->size = size;
+	batch->buffer_barriers_size++;
+	batch->src_stages |= src_stage;
+	batch->dst_stages |= dst_stage;
+}
 
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = (wait == VK_NULL_HANDLE ? 0 : 1);
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &buffer;
-	submit_info.signalSemaphoreCount = (signal == VK_NULL_HANDLE ? 0 : 1);
-	submit_info.pSignalSemaphores = signal_semaphores;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkQueueSubmit)(kvfGetDeviceQueue(device, queue), 1, &submit_info, fence));
+size_t kvfBarrierBatchGetSize(KvfBarrierBatch* batch)
+{
+	KVF_ASSERT(batch != NULL);
+	return batch->image_barriers_size + batch->buffer_barriers_size;
 }
 
-void kvfSubmitSingleTimeCommandBuffer(VkDevice device, VkCommandBuffer buffer, KvfQueueType queue, VkFence fence)
+void kvfBarrierBatchFlush(VkCommandBuffer cmd, KvfBarrierBatch* batch)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(batch != NULL);
+	if(batch->image_barriers_size == 0 && batch->buffer_barriers_size == 0)
+		return;
 	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
 		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 	#endif
+	KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, batch->src_stages, batch->dst_stages, 0, 0, NULL, (uint32_t)batch->buffer_barriers_size, batch->buffer_barriers, (uint32_t)batch->image_barriers_size, batch->image_barriers);
+	kvfBarrierBatchReset(batch);
+}
 
-	if(fence != VK_NULL_HANDLE)
-		KVF_GET_DEVICE_FUNCTION(vkResetFences)(device, 1, &fence);
-
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &buffer;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkQueueSubmit)(kvfGetDeviceQueue(device, queue), 1, &submit_info, fence));
-	if(fence != VK_NULL_HANDLE)
-		kvfWaitForFence(device, fence);	
+void kvfBarrierBatchReset(KvfBarrierBatch* batch)
+{
+	KVF_ASSERT(batch != NULL);
+	batch->image_barriers_size = 0;
+	batch->buffer_barriers_size = 0;
+	batch->src_stages = 0;
+	batch->dst_stages = 0;
 }
 
-void kvfDestroyCommandBuffer(VkDevice device, VkCommandBuffer buffer)
+void kvfRegisterImage(VkImage image, VkFormat format, uint32_t mip_levels, uint32_t array_layers, VkImageLayout current_layout)
 {
-	if(buffer == VK_NULL_HANDLE)
-		return;
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	KVF_ASSERT(mip_levels >= 1 && array_layers >= 1);
+	KVF_ASSERT(__kvfGetKvfTrackedImageFromVkImage(image) == NULL && "image is already registered");
+	if(__kvf_internal_tracked_images_size == __kvf_internal_tracked_images_capacity)
+	{
+		// Resize the dynamic array if necessary
+		__kvf_internal_tracked_images_capacity += 16;
+		__kvf_internal_tracked_images = (__KvfTrackedImage*)KVF_REALLOC(__kvf_internal_tracked_images, __kvf_internal_tracked_images_capacity * sizeof(__KvfTrackedImage));
+		KVF_ASSERT(__kvf_internal_tracked_images != NULL && "allocation failed :(");
+	}
 
-	for(size_t i = 0; i < kvf_device->cmd_buffers_size; i++)
+	__KvfTrackedImage* tracked = &__kvf_internal_tracked_images[__kvf_internal_tracked_images_size];
+	tracked->image = image;
+	tracked->format = format;
+	tracked->mip_levels = mip_levels;
+	tracked->array_layers = array_layers;
+	tracked->states = (__KvfImageState*)KVF_MALLOC(sizeof(__KvfImageState) * mip_levels * array_layers);
+	KVF_ASSERT(tracked->states != NULL && "allocation failed :(");
+	for(uint32_t i = 0; i < mip_levels * array_layers; i++)
 	{
-		if(kvf_device->cmd_buffers[i] == buffer)
+		tracked->states[i].layout = current_layout;
+		tracked->states[i].access = 0;
+		tracked->states[i].stage = 0;
+		tracked->states[i].write_access = 0;
+		tracked->states[i].write_stage = 0;
+	}
+	__kvf_internal_tracked_images_size++;
+}
+
+void kvfUnregisterImage(VkImage image)
+{
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	for(size_t i = 0; i < __kvf_internal_tracked_images_size; i++)
+	{
+		if(__kvf_internal_tracked_images[i].image == image)
 		{
-			KVF_GET_DEVICE_FUNCTION(vkFreeCommandBuffers)(kvf_device->device, kvf_device->cmd_pool, 1, &buffer);
+			KVF_FREE(__kvf_internal_tracked_images[i].states);
 			// Shift the elements to fill the gap
-			for(size_t j = i; j < kvf_device->cmd_buffers_size - 1; j++)
-				kvf_device->cmd_buffers[j] = kvf_device->cmd_buffers[j + 1];
-			kvf_device->cmd_buffers_size--;
+			for(size_t j = i; j < __kvf_internal_tracked_images_size - 1; j++)
+				__kvf_internal_tracked_images[j] = __kvf_internal_tracked_images[j + 1];
+			__kvf_internal_tracked_images_size--;
+			if(__kvf_internal_tracked_images_size == 0)
+			{
+				KVF_FREE(__kvf_internal_tracked_images);
+				__kvf_internal_tracked_images = NULL;
+				__kvf_internal_tracked_images_capacity = 0;
+			}
 			return;
 		}
-    }
-	KVF_ASSERT(false && "could not find command buffer in internal device");
+	}
+	KVF_ASSERT(false && "could not find image in registered images");
 }
 
-VkAttachmentDescription kvfBuildAttachmentDescription(KvfImageType type, VkFormat format, VkImageLayout initial, VkImageLayout final, bool clear, VkSampleCountFlagBits samples)
+#define KVF_WRITE_ACCESS_MASK (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+
+void __kvfResolveTrackedImageRange(__KvfTrackedImage* tracked, VkImageSubresourceRange* range)
 {
-	VkAttachmentDescription attachment = {};
+	KVF_ASSERT(range->baseMipLevel < tracked->mip_levels && range->baseArrayLayer < tracked->array_layers && "subresource range out of image bounds");
+	if(range->levelCount == VK_REMAINING_MIP_LEVELS)
+		range->levelCount = tracked->mip_levels - range->baseMipLevel;
+	if(range->layerCount == VK_REMAINING_ARRAY_LAYERS)
+		range->layerCount = tracked->array_layers - range->baseArrayLayer;
+	KVF_ASSERT(range->baseMipLevel + range->levelCount <= tracked->mip_levels && range->baseArrayLayer + range->layerCount <= tracked->array_layers && "subresource range out of image bounds");
+	if(range->aspectMask == 0)
+		range->aspectMask = __kvfFormatAspect(tracked->format);
+}
 
-	switch(type)
+void kvfRequireImageState(VkCommandBuffer cmd, VkImage image, VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stage)
+{
+	VkImageSubresourceRange range = {};
+	range.aspectMask = 0;
+	range.baseMipLevel = 0;
+	range.levelCount = VK_REMAINING_MIP_LEVELS;
+	range.baseArrayLayer = 0;
+	range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	kvfRequireImageSubresourceState(cmd, image, range, layout, access, stage);
+}
+
+void kvfRequireImageSubresourceState(VkCommandBuffer cmd, VkImage image, VkImageSubresourceRange range, VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stage)
+{
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(stage != 0);
+	__KvfTrackedImage* tracked = __kvfGetKvfTrackedImageFromVkImage(image);
+	KVF_ASSERT(tracked != NULL && "could not find image in registered images");
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	__kvfResolveTrackedImageRange(tracked, &range);
+
+	__KvfScratchMarker marker = __kvfScratchMark();
+	// At worst one barrier per subresource
+	VkImageMemoryBarrier* barriers = (VkImageMemoryBarrier*)__kvfScratchPush(sizeof(VkImageMemoryBarrier) * range.levelCount * range.layerCount);
+	uint32_t barriers_count = 0;
+	VkPipelineStageFlags source_stages = 0;
+
+	for(uint32_t mip = range.baseMipLevel; mip < range.baseMipLevel + range.levelCount; mip++)
 	{
-		case KVF_IMAGE_CUBE:
-		case KVF_IMAGE_DEPTH_ARRAY:
-		case KVF_IMAGE_COLOR:
-		case KVF_IMAGE_DEPTH:
+		__KvfImageState previous_old_state;
+		bool extend_previous = false;
+		for(uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + range.layerCount; layer++)
+		{
+			__KvfImageState* state = &tracked->states[mip * tracked->array_layers + layer];
+			// Readers are accumulated so that the next write waits for all of them
+			bool add_readers = (state->layout == layout && ((state->access | access) & KVF_WRITE_ACCESS_MASK) == 0);
+			// Read after read needs no synchronization when the readers' stages and accesses were already made to wait for the last write
+			if(add_readers && (((stage & ~state->stage) == 0 && (access & ~state->access) == 0) || state->write_stage == 0))
+			{
+				state->access |= access;
+				state->stage |= stage;
+				extend_previous = false;
+				continue;
+			}
+
+			// Consecutive layers coming from the same state share a barrier
+			if(extend_previous && memcmp(&previous_old_state, state, sizeof(__KvfImageState)) == 0)
+				barriers[barriers_count - 1].subresourceRange.layerCount++;
+			else
+			{
+				VkImageMemoryBarrier* barrier = &barriers[barriers_count++];
+				memset(barrier, 0, sizeof(VkImageMemoryBarrier));
+				barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier->oldLayout = state->layout;
+				barrier->newLayout = layout;
+				barrier->srcAccessMask = (add_readers ? state->write_access : state->access & KVF_WRITE_ACCESS_MASK); // Only writes need to be made available
+				barrier->dstAccessMask = access;
+				barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier->image = image;
+				barrier->subresourceRange.aspectMask = range.aspectMask;
+				barrier->subresourceRange.baseMipLevel = mip;
+				barrier->subresourceRange.levelCount = 1;
+				barrier->subresourceRange.baseArrayLayer = layer;
+				barrier->subresourceRange.layerCount = 1;
+				source_stages |= (add_readers ? state->write_stage : state->stage);
+			}
+			previous_old_state = *state;
+			extend_previous = true;
+			if(add_readers)
+			{
+				state->access |= access;
+				state->stage |= stage;
+				continue;
+			}
+			// Later readers in the same layout wait for the last write and for the layout transition, that completes before stage
+			if(access & KVF_WRITE_ACCESS_MASK)
+			{
+				state->write_access = access & KVF_WRITE_ACCESS_MASK;
+				state->write_stage = stage;
+			}
+			else if(state->layout != layout)
+			{
+				if(state->access & KVF_WRITE_ACCESS_MASK)
+				{
+					state->write_access = state->access & KVF_WRITE_ACCESS_MASK;
+					state->write_stage = state->stage;
+				}
+				state->write_stage |= stage;
+			}
+			state->layout = layout;
+			state->access = access;
+			state->stage = stage;
+		}
+	}
+
+	if(barriers_count == 0)
+		__kvf_image_state_stats.skipped_barriers++;
+	else
+	{
+		KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, source_stages != 0 ? source_stages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, stage, 0, 0, NULL, 0, NULL, barriers_count, barriers);
+		__kvf_image_state_stats.emitted_barriers++;
+	}
+	__kvfScratchRewind(marker);
+}
+
+void kvfSetImageState(VkImage image, VkImageSubresourceRange range, VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stage)
+{
+	__KvfTrackedImage* tracked = __kvfGetKvfTrackedImageFromVkImage(image);
+	KVF_ASSERT(tracked != NULL && "could not find image in registered images");
+	__kvfResolveTrackedImageRange(tracked, &range);
+	for(uint32_t mip = range.baseMipLevel; mip < range.baseMipLevel + range.levelCount; mip++)
+	{
+		for(uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + range.layerCount; layer++)
+		{
+			__KvfImageState* state = &tracked->states[mip * tracked->array_layers + layer];
+			state->layout = layout;
+			state->access = access;
+			state->stage = stage;
+			// The reported state may come from a write or a transition, later readers wait for it
+			state->write_access = access & KVF_WRITE_ACCESS_MASK;
+			state->write_stage = stage;
+		}
+	}
+}
+
+VkImageLayout kvfGetImageLayout(VkImage image, uint32_t mip_level, uint32_t array_layer)
+{
+	__KvfTrackedImage* tracked = __kvfGetKvfTrackedImageFromVkImage(image);
+	KVF_ASSERT(tracked != NULL && "could not find image in registered images");
+	KVF_ASSERT(mip_level < tracked->mip_levels && array_layer < tracked->array_layers && "subresource out of image bounds");
+	return tracked->states[mip_level * tracked->array_layers + array_layer].layout;
+}
+
+KvfImageStateStats kvfGetImageStateStats()
+{
+	return __kvf_image_state_stats;
+}
+
+void kvfResetImageStateStats()
+{
+	__kvf_image_state_stats.emitted_barriers = 0;
+	__kvf_image_state_stats.skipped_barriers = 0;
+}
+
+KvfSamplerDescription kvfGetDefaultSamplerDescription(VkFilter filters, VkSamplerAddressMode address_modes, VkSamplerMipmapMode mipmap_mode)
+{
+	KvfSamplerDescription description;
+	memset(&description, 0, sizeof(KvfSamplerDescription));
+	description.mag_filter = filters;
+	description.min_filter = filters;
+	description.mipmap_mode = mipmap_mode;
+	description.address_mode_u = address_modes;
+	description.address_mode_v = address_modes;
+	description.address_mode_w = address_modes;
+	description.max_anisotropy = 1.0f;
+	description.compare_op = VK_COMPARE_OP_NEVER;
+	description.min_lod = -1000;
+	description.max_lod = 1000;
+	description.border_color = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+	return description;
+}
+
+// Clamps the anisotropy and clears the fields that have no effect so that equivalent descriptions hash the same
+KvfSamplerDescription __kvfNormalizeSamplerDescription(__KvfDevice* kvf_device, const KvfSamplerDescription* description)
+{
+	KvfSamplerDescription normalized = *description;
+	if(normalized.max_anisotropy > 1.0f)
+	{
+		if(kvf_device->max_sampler_anisotropy == 0.0f)
+		{
+			VkPhysicalDeviceProperties properties;
+			KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceProperties)(kvf_device->physical, &properties);
+			kvf_device->max_sampler_anisotropy = properties.limits.maxSamplerAnisotropy < 1.0f ? 1.0f : properties.limits.maxSamplerAnisotropy;
+		}
+		if(normalized.max_anisotropy > kvf_device->max_sampler_anisotropy)
+			normalized.max_anisotropy = kvf_device->max_sampler_anisotropy;
+	}
+	if(normalized.max_anisotropy <= 1.0f)
+		normalized.max_anisotropy = 1.0f;
+	if(normalized.compare_enable == VK_FALSE)
+		normalized.compare_op = VK_COMPARE_OP_NEVER;
+	return normalized;
+}
+
+VkSampler __kvfCreateSamplerFromNormalizedDescription(__KvfDevice* kvf_device, const KvfSamplerDescription* description)
+{
+	VkSamplerCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	info.magFilter = description->mag_filter;
+	info.minFilter = description->min_filter;
+	info.mipmapMode = description->mipmap_mode;
+	info.addressModeU = description->address_mode_u;
+	info.addressModeV = description->address_mode_v;
+	info.addressModeW = description->address_mode_w;
+	info.mipLodBias = description->mip_lod_bias;
+	info.anisotropyEnable = description->max_anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+	info.maxAnisotropy = description->max_anisotropy;
+	info.compareEnable = description->compare_enable;
+	info.compareOp = description->compare_op;
+	info.minLod = description->min_lod;
+	info.maxLod = description->max_lod;
+	info.borderColor = description->border_color;
+	info.unnormalizedCoordinates = description->unnormalized_coordinates;
+	VkSampler sampler;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateSampler)(kvf_device->device, &info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SAMPLER), &sampler));
+	return sampler;
+}
+
+VkSampler kvfCreateSampler(VkDevice device, VkFilter filters, VkSamplerAddressMode address_modes, VkSamplerMipmapMode mipmap_mode)
+{
+	KvfSamplerDescription description = kvfGetDefaultSamplerDescription(filters, address_modes, mipmap_mode);
+	return kvfCreateSamplerFromDescription(device, &description);
+}
+
+VkSampler kvfCreateSamplerFromDescription(VkDevice device, const KvfSamplerDescription* description)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(description != NULL);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KvfSamplerDescription normalized = __kvfNormalizeSamplerDescription(kvf_device, description);
+	return __kvfCreateSamplerFromNormalizedDescription(kvf_device, &normalized);
+}
+
+void kvfDestroySampler(VkDevice device, VkSampler sampler)
+{
+	if(sampler == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_GET_DEVICE_FUNCTION(vkDestroySampler)(device, sampler, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SAMPLER));
+}
+
+// Returns the slot holding the description, or the empty slot where it should be inserted
+__KvfSamplerCacheEntry* __kvfSamplerCacheFind(__KvfDevice* kvf_device, const KvfSamplerDescription* description, uint32_t hash)
+{
+	size_t mask = kvf_device->samplers_capacity - 1;
+	for(size_t i = hash & mask;; i = (i + 1) & mask)
+	{
+		__KvfSamplerCacheEntry* entry = &kvf_device->samplers[i];
+		if(entry->sampler == VK_NULL_HANDLE)
+			return entry;
+		if(entry->hash == hash && memcmp(&entry->description, description, sizeof(KvfSamplerDescription)) == 0)
+			return entry;
+	}
+}
+
+void __kvfSamplerCacheGrow(__KvfDevice* kvf_device)
+{
+	__KvfSamplerCacheEntry* old_samplers = kvf_device->samplers;
+	size_t old_capacity = kvf_device->samplers_capacity;
+	kvf_device->samplers_capacity = (old_capacity == 0 ? 16 : old_capacity * 2);
+	kvf_device->samplers = (__KvfSamplerCacheEntry*)KVF_MALLOC(sizeof(__KvfSamplerCacheEntry) * kvf_device->samplers_capacity);
+	KVF_ASSERT(kvf_device->samplers != NULL && "allocation failed :(");
+	memset(kvf_device->samplers, 0, sizeof(__KvfSamplerCacheEntry) * kvf_device->samplers_capacity);
+	for(size_t i = 0; i < old_capacity; i++)
+	{
+		if(old_samplers[i].sampler != VK_NULL_HANDLE)
+			*__kvfSamplerCacheFind(kvf_device, &old_samplers[i].description, old_samplers[i].hash) = old_samplers[i];
+	}
+	KVF_FREE(old_samplers);
+}
+
+VkSampler kvfAcquireSampler(VkDevice device, const KvfSamplerDescription* description)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(description != NULL);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	KvfSamplerDescription normalized = __kvfNormalizeSamplerDescription(kvf_device, description);
+	uint32_t hash = __kvfHashBytes(&normalized, sizeof(KvfSamplerDescription), __KVF_FNV_OFFSET_BASIS);
+
+	// Keeps the load factor under 3/4
+	if((kvf_device->samplers_size + 1) * 4 > kvf_device->samplers_capacity * 3)
+		__kvfSamplerCacheGrow(kvf_device);
+
+	__KvfSamplerCacheEntry* entry = __kvfSamplerCacheFind(kvf_device, &normalized, hash);
+	if(entry->sampler != VK_NULL_HANDLE)
+	{
+		entry->references++;
+		return entry->sampler;
+	}
+	entry->description = normalized;
+	entry->sampler = __kvfCreateSamplerFromNormalizedDescription(kvf_device, &normalized);
+	entry->hash = hash;
+	entry->references = 1;
+	kvf_device->samplers_size++;
+	return entry->sampler;
+}
+
+void kvfReleaseSampler(VkDevice device, VkSampler sampler)
+{
+	if(sampler == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	size_t mask = kvf_device->samplers_capacity - 1;
+	for(size_t i = 0; i < kvf_device->samplers_capacity; i++)
+	{
+		if(kvf_device->samplers[i].sampler != sampler)
+			continue;
+		kvf_device->samplers[i].references--;
+		if(kvf_device->samplers[i].references > 0)
+			return;
+		KVF_GET_DEVICE_FUNCTION(vkDestroySampler)(device, sampler, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SAMPLER));
+		kvf_device->samplers_size--;
+
+		// Shift back the following entries of the probe sequence to fill the gap
+		size_t gap = i;
+		for(size_t j = (i + 1) & mask; kvf_device->samplers[j].sampler != VK_NULL_HANDLE; j = (j + 1) & mask)
+		{
+			size_t home = kvf_device->samplers[j].hash & mask;
+			bool stays = (gap <= j) ? (gap < home && home <= j) : (gap < home || home <= j);
+			if(stays)
+				continue;
+			kvf_device->samplers[gap] = kvf_device->samplers[j];
+			gap = j;
+		}
+		kvf_device->samplers[gap].sampler = VK_NULL_HANDLE;
+		return;
+	}
+	KVF_ASSERT(false && "sampler was not acquired from the cache");
+}
+
+size_t kvfGetCachedSamplersCount(VkDevice device)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	return kvf_device->samplers_size;
+}
+
+VkBuffer kvfCreateBuffer(VkDevice device, VkBufferUsageFlags usage, VkDeviceSize size)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = size;
+	buffer_info.usage = usage;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer buffer;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateBuffer)(device, &buffer_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_BUFFER), &buffer));
+	return buffer;
+}
+
+void kvfCopyBufferToBuffer(VkCommandBuffer cmd, VkBuffer dst, VkBuffer src, size_t size, size_t src_offset, size_t dst_offset)
+{
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(dst != VK_NULL_HANDLE);
+	KVF_ASSERT(src != VK_NULL_HANDLE);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkBufferCopy copy_region = {};
+	copy_region.size = size;
+	copy_region.srcOffset = src_offset;
+	copy_region.dstOffset = dst_offset;
+	KVF_GET_DEVICE_FUNCTION(vkCmdCopyBuffer)(cmd, src, dst, 1, &copy_region);
+}
+
+void kvfCopyBufferToImage(VkCommandBuffer cmd, VkImage dst, VkBuffer src, size_t buffer_offset, VkImageAspectFlagBits aspect, VkExtent3D extent)
+{
+	VkOffset3D offset = { 0, 0, 0 };
+	VkImageSubresourceLayers subresource = {};
+	subresource.aspectMask = aspect;
+	subresource.mipLevel = 0;
+	subresource.baseArrayLayer = 0;
+	subresource.layerCount = 1;
+	kvfCopyBufferToImageSubresource(cmd, dst, src, buffer_offset, subresource, offset, extent);
+}
+
+void kvfCopyBufferToImageSubresource(VkCommandBuffer cmd, VkImage dst, VkBuffer src, size_t buffer_offset, VkImageSubresourceLayers subresource, VkOffset3D offset, VkExtent3D extent)
+{
+	VkBufferImageCopy region = {};
+	region.bufferOffset = buffer_offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource = subresource;
+	region.imageOffset = offset;
+	region.imageExtent = extent;
+	kvfCopyBufferToImageRegions(cmd, dst, src, 1, &region);
+}
+
+void kvfCopyBufferToImageRegions(VkCommandBuffer cmd, VkImage dst, VkBuffer src, uint32_t count, const VkBufferImageCopy* regions)
+{
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(dst != VK_NULL_HANDLE);
+	KVF_ASSERT(src != VK_NULL_HANDLE);
+	KVF_ASSERT(count == 0 || regions != NULL);
+	if(count == 0)
+		return;
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	KVF_GET_DEVICE_FUNCTION(vkCmdCopyBufferToImage)(cmd, src, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, count, regions);
+}
+
+void kvfDestroyBuffer(VkDevice device, VkBuffer buffer)
+{
+	if(buffer == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	if(kvf_device->descriptor_sets_size != 0)
+		kvfInvalidateCachedDescriptorSets(device, buffer, VK_NULL_HANDLE);
+	KVF_GET_DEVICE_FUNCTION(vkDestroyBuffer)(device, buffer, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_BUFFER));
+}
+
+KvfTextureUploader* kvfCreateTextureUploader(VkDevice device, VkDeviceSize bytes_per_frame, uint32_t frames_in_flight)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(bytes_per_frame > 0 && frames_in_flight > 0);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	KvfTextureUploader* uploader = (KvfTextureUploader*)KVF_MALLOC(sizeof(KvfTextureUploader));
+	KVF_ASSERT(uploader != NULL && "allocation failed :(");
+	memset(uploader, 0, sizeof(KvfTextureUploader));
+	uploader->device = device;
+	uploader->bytes_per_frame = bytes_per_frame;
+	uploader->frames_in_flight = frames_in_flight;
+	uploader->pre_barriers = kvfCreateBarrierBatch();
+	uploader->post_barriers = kvfCreateBarrierBatch();
+
+	uploader->staging = kvfCreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, bytes_per_frame * frames_in_flight);
+	VkMemoryRequirements requirements;
+	KVF_GET_DEVICE_FUNCTION(vkGetBufferMemoryRequirements)(device, uploader->staging, &requirements);
+	int32_t memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	KVF_ASSERT(memory_type != -1 && "could not find a host visible and coherent memory type for staging");
+
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateMemory)(device, &alloc_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY), &uploader->memory));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBindBufferMemory)(device, uploader->staging, uploader->memory, 0));
+	void* mapped = NULL;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkMapMemory)(device, uploader->memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+	uploader->mapped = (uint8_t*)mapped;
+	return uploader;
+}
+
+void kvfDestroyTextureUploader(KvfTextureUploader* uploader)
+{
+	if(uploader == NULL)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(uploader->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_GET_DEVICE_FUNCTION(vkUnmapMemory)(uploader->device, uploader->memory);
+	kvfDestroyBuffer(uploader->device, uploader->staging);
+	KVF_GET_DEVICE_FUNCTION(vkFreeMemory)(uploader->device, uploader->memory, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY));
+	kvfDestroyBarrierBatch(uploader->pre_barriers);
+	kvfDestroyBarrierBatch(uploader->post_barriers);
+	KVF_FREE(uploader->uploads);
+	KVF_FREE(uploader->regions);
+	KVF_FREE(uploader->regions_images);
+	KVF_FREE(uploader);
+}
+
+void kvfTextureUploaderAddImage(KvfTextureUploader* uploader, VkImage image, VkFormat format, VkExtent3D extent, uint32_t mip_levels, uint32_t array_layers, const void* data)
+{
+	KVF_ASSERT(uploader != NULL);
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	KVF_ASSERT(data != NULL);
+	KVF_ASSERT(mip_levels >= 1 && array_layers >= 1);
+	KvfFormatInfo info = kvfGetFormatInfo(format);
+	// Buffer to image copies take a single aspect, and each aspect of a depth stencil image has its own packing
+	KVF_ASSERT((info.aspect & (info.aspect - 1)) == 0 && "combined depth stencil formats are not supported for texture uploads");
+	KVF_ASSERT(info.block_size != 0 && "unsupported format for texture uploads");
+	VkDeviceSize row_size = (VkDeviceSize)(extent.width + info.block_width - 1) / info.block_width * info.block_size;
+	KVF_ASSERT(row_size + info.block_size * 4 <= uploader->bytes_per_frame && "a single row of blocks of the image does not fit in the uploader frame budget");
+
+	if(uploader->uploads_size == uploader->uploads_capacity)
+	{
+		uploader->uploads_capacity += 16;
+		uploader->uploads = (__KvfTextureUpload*)KVF_REALLOC(uploader->uploads, sizeof(__KvfTextureUpload) * uploader->uploads_capacity);
+		KVF_ASSERT(uploader->uploads != NULL && "allocation failed :(");
+	}
+	__KvfTextureUpload* upload = &uploader->uploads[uploader->uploads_size];
+	memset(upload, 0, sizeof(__KvfTextureUpload));
+	upload->image = image;
+	upload->format = format;
+	upload->extent = extent;
+	upload->data = (const uint8_t*)data;
+	upload->block_size = info.block_size;
+	upload->block_width = info.block_width;
+	upload->block_height = info.block_height;
+	upload->mip_levels = mip_levels;
+	upload->array_layers = array_layers;
+	upload->mip = mip_levels - 1;
+	uploader->uploads_size++;
+}
+
+VkDeviceSize __kvfTextureUploadLayerSize(__KvfTextureUpload* upload, uint32_t mip)
+{
+	return kvfFormatImageSize(upload->format, kvfGetMipLevelExtent(upload->extent, mip));
+}
+
+VkDeviceSize __kvfTextureUploadMipOffset(__KvfTextureUpload* upload, uint32_t mip)
+{
+	VkDeviceSize offset = 0;
+	for(uint32_t i = 0; i < mip; i++)
+		offset += __kvfTextureUploadLayerSize(upload, i) * upload->array_layers;
+	return offset;
+}
+
+void __kvfTextureUploaderPushRegion(KvfTextureUploader* uploader, VkImage image, const VkBufferImageCopy* region)
+{
+	if(uploader->regions_size == uploader->regions_capacity)
+	{
+		uploader->regions_capacity += 32;
+		uploader->regions = (VkBufferImageCopy*)KVF_REALLOC(uploader->regions, sizeof(VkBufferImageCopy) * uploader->regions_capacity);
+		KVF_ASSERT(uploader->regions != NULL && "allocation failed :(");
+		uploader->regions_images = (VkImage*)KVF_REALLOC(uploader->regions_images, sizeof(VkImage) * uploader->regions_capacity);
+		KVF_ASSERT(uploader->regions_images != NULL && "allocation failed :(");
+	}
+	uploader->regions[uploader->regions_size] = *region;
+	uploader->regions_images[uploader->regions_size] = image;
+	uploader->regions_size++;
+}
+
+VkDeviceSize kvfTextureUploaderRecord(KvfTextureUploader* uploader, VkCommandBuffer cmd)
+{
+	KVF_ASSERT(uploader != NULL);
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	if(uploader->uploads_size == 0)
+		return 0;
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(uploader->device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+
+	VkDeviceSize segment = (uploader->frame % uploader->frames_in_flight) * uploader->bytes_per_frame;
+	uploader->frame++;
+	VkDeviceSize used = 0;
+	uploader->regions_size = 0;
+
+	for(;;)
+	{
+		// Coarse mips first, whatever image they belong to
+		__KvfTextureUpload* upload = NULL;
+		VkDeviceSize smallest = 0;
+		for(size_t i = 0; i < uploader->uploads_size; i++)
+		{
+			if(uploader->uploads[i].completed)
+				continue;
+			VkDeviceSize size = __kvfTextureUploadLayerSize(&uploader->uploads[i], uploader->uploads[i].mip) * uploader->uploads[i].array_layers;
+			if(upload == NULL || size < smallest)
+			{
+				upload = &uploader->uploads[i];
+				smallest = size;
+			}
+		}
+		if(upload == NULL)
+			break;
+
+		VkDeviceSize alignment = (VkDeviceSize)upload->block_size * 4; // Multiple of both 4 and the block size
+		VkDeviceSize offset = (used + alignment - 1) / alignment * alignment;
+		if(offset >= uploader->bytes_per_frame)
+			break;
+		VkDeviceSize budget = uploader->bytes_per_frame - offset;
+
+		VkExtent3D extent = kvfGetMipLevelExtent(upload->extent, upload->mip);
+		// Rows are rows of texel blocks, a single texel high for uncompressed formats
+		uint32_t rows_count = (extent.height + upload->block_height - 1) / upload->block_height;
+		VkDeviceSize row_size = (VkDeviceSize)(extent.width + upload->block_width - 1) / upload->block_width * upload->block_size;
+		VkDeviceSize slice_size = row_size * rows_count;
+		VkDeviceSize layer_size = slice_size * extent.depth;
+		if(budget < row_size)
+			break;
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = segment + offset;
+		region.imageSubresource.aspectMask = __kvfFormatAspect(upload->format);
+		region.imageSubresource.mipLevel = upload->mip;
+		region.imageSubresource.baseArrayLayer = upload->layer;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset.x = 0;
+		region.imageOffset.y = (int32_t)(upload->y * upload->block_height);
+		region.imageOffset.z = (int32_t)upload->z;
+		region.imageExtent = extent;
+		VkDeviceSize source = __kvfTextureUploadMipOffset(upload, upload->mip) + layer_size * upload->layer + slice_size * upload->z + row_size * upload->y;
+
+		// Biggest chunk that fits, whole layers, then depth slices, then rows
+		VkDeviceSize bytes;
+		if(upload->z == 0 && upload->y == 0 && budget >= layer_size)
+		{
+			uint32_t layers = (uint32_t)(budget / layer_size);
+			if(layers > upload->array_layers - upload->layer)
+				layers = upload->array_layers - upload->layer;
+			region.imageSubresource.layerCount = layers;
+			bytes = layer_size * layers;
+			upload->layer += layers;
+		}
+		else if(upload->y == 0 && budget >= slice_size)
+		{
+			uint32_t slices = (uint32_t)(budget / slice_size);
+			if(slices > extent.depth - upload->z)
+				slices = extent.depth - upload->z;
+			region.imageExtent.depth = slices;
+			bytes = slice_size * slices;
+			upload->z += slices;
+			if(upload->z == extent.depth)
+			{
+				upload->z = 0;
+				upload->layer++;
+			}
+		}
+		else
+		{
+			uint32_t rows = (uint32_t)(budget / row_size);
+			if(rows > rows_count - upload->y)
+				rows = rows_count - upload->y;
+			region.imageExtent.depth = 1;
+			// The last block row may be partially outside of the image
+			region.imageExtent.height = rows * upload->block_height;
+			if(region.imageExtent.height > extent.height - (uint32_t)region.imageOffset.y)
+				region.imageExtent.height = extent.height - (uint32_t)region.imageOffset.y;
+			bytes = row_size * rows;
+			upload->y += rows;
+			if(upload->y == rows_count)
+			{
+				upload->y = 0;
+				upload->z++;
+			}
+			if(upload->z == extent.depth)
+			{
+				upload->z = 0;
+				upload->layer++;
+			}
+		}
+
+		memcpy(uploader->mapped + segment + offset, upload->data + source, (size_t)bytes);
+		used = offset + bytes;
+
+		if(!upload->started)
+		{
+			kvfBarrierBatchAddImageTransition(uploader->pre_barriers, upload->image, upload->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, kvfBuildImageSubresourceRange(upload->format, 0, upload->mip_levels, 0, upload->array_layers));
+			upload->started = true;
+		}
+		__kvfTextureUploaderPushRegion(uploader, upload->image, &region);
+
+		if(upload->layer == upload->array_layers)
+		{
+			kvfBarrierBatchAddImageTransition(uploader->post_barriers, upload->image, upload->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, kvfBuildImageSubresourceRange(upload->format, upload->mip, 1, 0, upload->array_layers));
+			upload->layer = 0;
+			if(upload->mip == 0)
+				upload->completed = true;
+			else
+				upload->mip--;
+		}
+	}
+
+	kvfBarrierBatchFlush(cmd, uploader->pre_barriers);
+	// One copy per image with all of its regions
+	__KvfScratchMarker marker = __kvfScratchMark();
+	VkBufferImageCopy* image_regions = (VkBufferImageCopy*)__kvfScratchPush(sizeof(VkBufferImageCopy) * (uploader->regions_size + 1));
+	for(size_t i = 0; i < uploader->regions_size; i++)
+	{
+		VkImage image = uploader->regions_images[i];
+		if(image == VK_NULL_HANDLE)
+			continue;
+		uint32_t count = 0;
+		for(size_t j = i; j < uploader->regions_size; j++)
+		{
+			if(uploader->regions_images[j] != image)
+				continue;
+			image_regions[count++] = uploader->regions[j];
+			uploader->regions_images[j] = VK_NULL_HANDLE;
+		}
+		KVF_GET_DEVICE_FUNCTION(vkCmdCopyBufferToImage)(cmd, uploader->staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, count, image_regions);
+	}
+	__kvfScratchRewind(marker);
+	kvfBarrierBatchFlush(cmd, uploader->post_barriers);
+
+	// Forget completed images
+	size_t kept = 0;
+	for(size_t i = 0; i < uploader->uploads_size; i++)
+	{
+		if(!uploader->uploads[i].completed)
+			uploader->uploads[kept++] = uploader->uploads[i];
+	}
+	uploader->uploads_size = kept;
+	return used;
+}
+
+uint32_t kvfTextureUploaderGetFinestResidentMip(KvfTextureUploader* uploader, VkImage image)
+{
+	KVF_ASSERT(uploader != NULL);
+	for(size_t i = 0; i < uploader->uploads_size; i++)
+	{
+		if(uploader->uploads[i].image == image)
+			return uploader->uploads[i].mip + 1;
+	}
+	return 0;
+}
+
+bool kvfTextureUploaderIsIdle(KvfTextureUploader* uploader)
+{
+	KVF_ASSERT(uploader != NULL);
+	return uploader->uploads_size == 0;
+}
+
+KvfReadbackQueue* kvfCreateReadbackQueue(VkDevice device, uint32_t slots_count, VkDeviceSize slot_size)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(slots_count > 0 && slot_size > 0);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	KvfReadbackQueue* queue = (KvfReadbackQueue*)KVF_MALLOC(sizeof(KvfReadbackQueue));
+	KVF_ASSERT(queue != NULL && "allocation failed :(");
+	memset(queue, 0, sizeof(KvfReadbackQueue));
+	queue->device = device;
+	queue->slots_count = slots_count;
+
+	// Slots are aligned on the non coherent atom size so they can be invalidated independently
+	VkPhysicalDeviceProperties properties;
+	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceProperties)(kvf_device->physical, &properties);
+	VkDeviceSize alignment = properties.limits.nonCoherentAtomSize > 16 ? properties.limits.nonCoherentAtomSize : 16;
+	queue->slot_size = (slot_size + alignment - 1) / alignment * alignment;
+
+	queue->slots = (__KvfReadbackSlot*)KVF_MALLOC(sizeof(__KvfReadbackSlot) * slots_count);
+	KVF_ASSERT(queue->slots != NULL && "allocation failed :(");
+	queue->fences = (__KvfReadbackFence*)KVF_MALLOC(sizeof(__KvfReadbackFence) * slots_count);
+	KVF_ASSERT(queue->fences != NULL && "allocation failed :(");
+	for(uint32_t i = 0; i < slots_count; i++)
+	{
+		queue->slots[i].offset = queue->slot_size * i;
+		queue->slots[i].size = 0;
+		queue->slots[i].fence = -1;
+		queue->slots[i].generation = 1;
+		queue->slots[i].state = __KVF_READBACK_FREE;
+	}
+
+	queue->buffer = kvfCreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue->slot_size * slots_count);
+	VkMemoryRequirements requirements;
+	KVF_GET_DEVICE_FUNCTION(vkGetBufferMemoryRequirements)(device, queue->buffer, &requirements);
+	int32_t memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+	if(memory_type == -1)
+		memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	KVF_ASSERT(memory_type != -1 && "could not find a host visible memory type for readbacks");
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceMemoryProperties)(kvf_device->physical, &memory_properties);
+	queue->coherent = (memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateMemory)(device, &alloc_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY), &queue->memory));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBindBufferMemory)(device, queue->buffer, queue->memory, 0));
+	void* mapped = NULL;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkMapMemory)(device, queue->memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+	queue->mapped = (uint8_t*)mapped;
+	return queue;
+}
+
+void kvfDestroyReadbackQueue(KvfReadbackQueue* queue)
+{
+	if(queue == NULL)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(queue->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	for(uint32_t i = 0; i < queue->fences_count; i++)
+	{
+		if(queue->fences[i].users != 0)
+			kvfWaitForFence(queue->device, queue->fences[i].fence);
+		kvfDestroyFence(queue->device, queue->fences[i].fence);
+	}
+	KVF_GET_DEVICE_FUNCTION(vkUnmapMemory)(queue->device, queue->memory);
+	kvfDestroyBuffer(queue->device, queue->buffer);
+	KVF_GET_DEVICE_FUNCTION(vkFreeMemory)(queue->device, queue->memory, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY));
+	KVF_FREE(queue->slots);
+	KVF_FREE(queue->fences);
+	KVF_FREE(queue);
+}
+
+__KvfReadbackSlot* __kvfReadbackQueueGetSlot(KvfReadbackQueue* queue, KvfReadback readback)
+{
+	uint32_t index = (uint32_t)(readback & 0xFFFFFFFF);
+	KVF_ASSERT(index >= 1 && index <= queue->slots_count && "invalid readback");
+	__KvfReadbackSlot* slot = &queue->slots[index - 1];
+	KVF_ASSERT(slot->generation == (uint32_t)(readback >> 32) && slot->state != __KVF_READBACK_FREE && "readback has already been released");
+	return slot;
+}
+
+KvfReadback __kvfReadbackQueueAcquireSlot(KvfReadbackQueue* queue, VkDeviceSize size)
+{
+	if(size > queue->slot_size)
+		return 0;
+	for(uint32_t i = 0; i < queue->slots_count; i++)
+	{
+		uint32_t index = (queue->next_slot + i) % queue->slots_count;
+		__KvfReadbackSlot* slot = &queue->slots[index];
+		if(slot->state != __KVF_READBACK_FREE)
+			continue;
+		slot->state = __KVF_READBACK_RECORDED;
+		slot->size = size;
+		slot->fence = -1;
+		queue->next_slot = (index + 1) % queue->slots_count;
+		return ((KvfReadback)slot->generation << 32) | (KvfReadback)(index + 1);
+	}
+	return 0;
+}
+
+void __kvfReadbackQueueMakeHostVisible(KvfReadbackQueue* queue, VkCommandBuffer cmd, __KvfReadbackSlot* slot)
+{
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(queue->device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	// Fences alone do not make transfer writes visible to the host
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = queue->buffer;
+	barrier.offset = slot->offset;
+	barrier.size = slot->size;
+	KVF_GET_DEVICE_FUNCTION(vkCmdPipelineBarrier)(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+KvfReadback kvfReadbackQueueCopyImage(KvfReadbackQueue* queue, VkCommandBuffer cmd, VkImage image, VkFormat format, VkImageSubresourceLayers subresource, VkOffset3D offset, VkExtent3D extent)
+{
+	KVF_ASSERT(queue != NULL);
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(image != VK_NULL_HANDLE);
+	// The copy writes as many bytes as the region holds, a smaller slot would let it spill into the next one
+	VkDeviceSize size = __kvfFormatAspectImageSize(format, subresource.aspectMask, extent) * subresource.layerCount;
+	KVF_ASSERT(size != 0 && "unsupported format or aspect");
+	KvfReadback readback = __kvfReadbackQueueAcquireSlot(queue, size);
+	if(readback == 0)
+		return 0;
+	__KvfReadbackSlot* slot = __kvfReadbackQueueGetSlot(queue, readback);
+	kvfCopyImageSubresourceToBuffer(cmd, queue->buffer, image, (size_t)slot->offset, subresource, offset, extent);
+	__kvfReadbackQueueMakeHostVisible(queue, cmd, slot);
+	return readback;
+}
+
+KvfReadback kvfReadbackQueueCopyBuffer(KvfReadbackQueue* queue, VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	KVF_ASSERT(queue != NULL);
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(buffer != VK_NULL_HANDLE);
+	KvfReadback readback = __kvfReadbackQueueAcquireSlot(queue, size);
+	if(readback == 0)
+		return 0;
+	__KvfReadbackSlot* slot = __kvfReadbackQueueGetSlot(queue, readback);
+	kvfCopyBufferToBuffer(cmd, queue->buffer, buffer, (size_t)size, (size_t)offset, (size_t)slot->offset);
+	__kvfReadbackQueueMakeHostVisible(queue, cmd, slot);
+	return readback;
+}
+
+VkFence kvfReadbackQueueGetFence(KvfReadbackQueue* queue)
+{
+	KVF_ASSERT(queue != NULL);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(queue->device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	uint32_t users = 0;
+	for(uint32_t i = 0; i < queue->slots_count; i++)
+	{
+		if(queue->slots[i].state == __KVF_READBACK_RECORDED)
+			users++;
+	}
+	if(users == 0)
+		return VK_NULL_HANDLE;
+
+	// Recycle a fence no readback depends on anymore
+	int32_t index = -1;
+	for(uint32_t i = 0; i < queue->fences_count && index == -1; i++)
+	{
+		if(queue->fences[i].users == 0)
+			index = (int32_t)i;
+	}
+	if(index == -1)
+	{
+		KVF_ASSERT(queue->fences_count < queue->slots_count);
+		index = (int32_t)queue->fences_count;
+		queue->fences[index].fence = kvfCreateFence(queue->device);
+		queue->fences_count++;
+	}
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkResetFences)(queue->device, 1, &queue->fences[index].fence));
+	queue->fences[index].users = users;
+
+	for(uint32_t i = 0; i < queue->slots_count; i++)
+	{
+		if(queue->slots[i].state != __KVF_READBACK_RECORDED)
+			continue;
+		queue->slots[i].state = __KVF_READBACK_PENDING;
+		queue->slots[i].fence = index;
+	}
+	return queue->fences[index].fence;
+}
+
+bool kvfReadbackQueuePoll(KvfReadbackQueue* queue, KvfReadback readback)
+{
+	KVF_ASSERT(queue != NULL);
+	__KvfReadbackSlot* slot = __kvfReadbackQueueGetSlot(queue, readback);
+	if(slot->state == __KVF_READBACK_READY)
+		return true;
+	if(slot->state != __KVF_READBACK_PENDING)
+		return false;
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(queue->device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkResult result = KVF_GET_DEVICE_FUNCTION(vkGetFenceStatus)(queue->device, queue->fences[slot->fence].fence);
+	if(result == VK_NOT_READY)
+		return false;
+	__kvfCheckVk(result);
+	if(!queue->coherent)
+	{
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = queue->memory;
+		range.offset = slot->offset;
+		range.size = queue->slot_size;
+		__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkInvalidateMappedMemoryRanges)(queue->device, 1, &range));
+	}
+	slot->state = __KVF_READBACK_READY;
+	return true;
+}
+
+const void* kvfReadbackQueueGetData(KvfReadbackQueue* queue, KvfReadback readback, VkDeviceSize* size)
+{
+	KVF_ASSERT(queue != NULL);
+	if(!kvfReadbackQueuePoll(queue, readback))
+		return NULL;
+	__KvfReadbackSlot* slot = __kvfReadbackQueueGetSlot(queue, readback);
+	if(size != NULL)
+		*size = slot->size;
+	return queue->mapped + slot->offset;
+}
+
+void kvfReadbackQueueRelease(KvfReadbackQueue* queue, KvfReadback readback)
+{
+	KVF_ASSERT(queue != NULL);
+	__KvfReadbackSlot* slot = __kvfReadbackQueueGetSlot(queue, readback);
+	// The copy is still in an unsubmitted command buffer, reusing the slot would let a new copy overwrite it
+	KVF_ASSERT(slot->state != __KVF_READBACK_RECORDED && "cannot release a readback before it has been submitted with kvfReadbackQueueGetFence's fence");
+	if(slot->state == __KVF_READBACK_PENDING)
+	{
+		bool done = kvfReadbackQueuePoll(queue, readback);
+		KVF_ASSERT(done && "cannot release a readback the GPU is still writing");
+		(void)done;
+	}
+	if(slot->fence != -1)
+		queue->fences[slot->fence].users--;
+	slot->state = __KVF_READBACK_FREE;
+	slot->fence = -1;
+	slot->generation++;
+}
+
+KvfOffscreenTarget* kvfCreateOffscreenTarget(VkDevice device, VkExtent2D extent, VkFormat color_format, VkFormat depth_format, uint32_t frames_count)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(frames_count != 0);
+	KVF_ASSERT(extent.width != 0 && extent.height != 0);
+	KVF_ASSERT(!kvfIsDepthFormat(color_format) && "invalid color format");
+	KVF_ASSERT((depth_format == VK_FORMAT_UNDEFINED || kvfIsDepthFormat(depth_format)) && "invalid depth format");
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	KvfOffscreenTarget* target = (KvfOffscreenTarget*)KVF_MALLOC(sizeof(KvfOffscreenTarget));
+	KVF_ASSERT(target != NULL && "allocation failed :(");
+	memset(target, 0, sizeof(KvfOffscreenTarget));
+	target->device = device;
+	target->extent = extent;
+	target->color_format = color_format;
+	target->depth_format = depth_format;
+	target->frames_count = frames_count;
+
+	VkAttachmentDescription attachments[2];
+	attachments[0] = kvfBuildAttachmentDescription(KVF_IMAGE_COLOR, color_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, VK_SAMPLE_COUNT_1_BIT);
+	if(depth_format != VK_FORMAT_UNDEFINED)
+	{
+		attachments[1] = kvfBuildAttachmentDescription(KVF_IMAGE_DEPTH, depth_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true, VK_SAMPLE_COUNT_1_BIT);
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	}
+
+	// The previous readback of a frame must be done before it is rendered to again,
+	// and the color writes must be visible to the readback recorded after the render pass
+	VkSubpassDependency dependencies[2];
+	memset(dependencies, 0, sizeof(dependencies));
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	target->render_pass = kvfCreateRenderPassWithSubpassDependencies(device, attachments, (depth_format != VK_FORMAT_UNDEFINED ? 2 : 1), VK_PIPELINE_BIND_POINT_GRAPHICS, dependencies, 2);
+
+	target->frames = (__KvfOffscreenFrame*)KVF_MALLOC(sizeof(__KvfOffscreenFrame) * frames_count);
+	KVF_ASSERT(target->frames != NULL && "allocation failed :(");
+	memset(target->frames, 0, sizeof(__KvfOffscreenFrame) * frames_count);
+	VkExtent3D extent3d = { extent.width, extent.height, 1 };
+	for(uint32_t i = 0; i < frames_count; i++)
+	{
+		__KvfOffscreenFrame* frame = &target->frames[i];
+		frame->color = kvfCreateImageExtended(device, VK_IMAGE_TYPE_2D, extent3d, 1, 1, VK_SAMPLE_COUNT_1_BIT, color_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 0);
+
+		VkMemoryRequirements requirements;
+		KVF_GET_DEVICE_FUNCTION(vkGetImageMemoryRequirements)(device, frame->color, &requirements);
+		int32_t memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		KVF_ASSERT(memory_type != -1 && "could not find a memory type for an offscreen target");
+		VkMemoryAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = requirements.size;
+		alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+		__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateMemory)(device, &alloc_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY), &frame->color_memory));
+		__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBindImageMemory)(device, frame->color, frame->color_memory, 0));
+		frame->color_view = kvfCreateImageViewRange(device, frame->color, color_format, VK_IMAGE_VIEW_TYPE_2D, kvfBuildImageSubresourceRange(color_format, 0, 1, 0, 1));
+
+		VkImageView views[2] = { frame->color_view, VK_NULL_HANDLE };
+		if(depth_format != VK_FORMAT_UNDEFINED)
+		{
+			frame->depth = kvfCreateTransientAttachment(device, extent.width, extent.height, depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_SAMPLE_COUNT_1_BIT, &frame->depth_memory);
+			frame->depth_view = kvfCreateImageViewRange(device, frame->depth, depth_format, VK_IMAGE_VIEW_TYPE_2D, kvfBuildImageSubresourceRange(depth_format, 0, 1, 0, 1));
+			views[1] = frame->depth_view;
+		}
+		frame->framebuffer = kvfCreateFramebuffer(device, target->render_pass, views, (depth_format != VK_FORMAT_UNDEFINED ? 2 : 1), extent);
+	}
+
+	target->readbacks = kvfCreateReadbackQueue(device, frames_count, kvfFormatImageSize(color_format, extent3d));
+	return target;
+}
+
+void kvfDestroyOffscreenTarget(KvfOffscreenTarget* target)
+{
+	if(target == NULL)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(target->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	kvfDestroyReadbackQueue(target->readbacks);
+	for(uint32_t i = 0; i < target->frames_count; i++)
+	{
+		__KvfOffscreenFrame* frame = &target->frames[i];
+		kvfDestroyFramebuffer(target->device, frame->framebuffer);
+		kvfDestroyImageView(target->device, frame->color_view);
+		kvfDestroyImage(target->device, frame->color);
+		KVF_GET_DEVICE_FUNCTION(vkFreeMemory)(target->device, frame->color_memory, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY));
+		if(frame->depth != VK_NULL_HANDLE)
+		{
+			kvfDestroyImageView(target->device, frame->depth_view);
+			kvfDestroyTransientAttachment(target->device, frame->depth, frame->depth_memory);
+		}
+	}
+	kvfDestroyRenderPass(target->device, target->render_pass);
+	KVF_FREE(target->frames);
+	KVF_FREE(target);
+}
+
+VkRenderPass kvfOffscreenTargetGetRenderPass(KvfOffscreenTarget* target)
+{
+	KVF_ASSERT(target != NULL);
+	return target->render_pass;
+}
+
+VkFramebuffer kvfOffscreenTargetGetFramebuffer(KvfOffscreenTarget* target, uint32_t frame)
+{
+	KVF_ASSERT(target != NULL);
+	KVF_ASSERT(frame < target->frames_count);
+	return target->frames[frame].framebuffer;
+}
+
+VkImage kvfOffscreenTargetGetColorImage(KvfOffscreenTarget* target, uint32_t frame)
+{
+	KVF_ASSERT(target != NULL);
+	KVF_ASSERT(frame < target->frames_count);
+	return target->frames[frame].color;
+}
+
+VkImageView kvfOffscreenTargetGetColorImageView(KvfOffscreenTarget* target, uint32_t frame)
+{
+	KVF_ASSERT(target != NULL);
+	KVF_ASSERT(frame < target->frames_count);
+	return target->frames[frame].color_view;
+}
+
+VkExtent2D kvfOffscreenTargetGetExtent(KvfOffscreenTarget* target)
+{
+	KVF_ASSERT(target != NULL);
+	return target->extent;
+}
+
+uint32_t kvfOffscreenTargetGetFramesCount(KvfOffscreenTarget* target)
+{
+	KVF_ASSERT(target != NULL);
+	return target->frames_count;
+}
+
+KvfReadbackQueue* kvfOffscreenTargetGetReadbackQueue(KvfOffscreenTarget* target)
+{
+	KVF_ASSERT(target != NULL);
+	return target->readbacks;
+}
+
+KvfReadback kvfOffscreenTargetReadback(KvfOffscreenTarget* target, VkCommandBuffer cmd, uint32_t frame)
+{
+	KVF_ASSERT(target != NULL);
+	KVF_ASSERT(frame < target->frames_count);
+	VkExtent3D extent = { target->extent.width, target->extent.height, 1 };
+	VkOffset3D offset = { 0, 0, 0 };
+	return kvfReadbackQueueCopyImage(target->readbacks, cmd, target->frames[frame].color, target->color_format, kvfBuildImageSubresourceLayers(target->color_format, 0, 0, 1), offset, extent);
+}
+
+VkFramebuffer kvfCreateFramebuffer(VkDevice device, VkRenderPass render_pass, VkImageView* image_views, size_t image_views_count, VkExtent2D extent)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(image_views != NULL);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	VkFramebufferCreateInfo framebuffer_info = {};
+	framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebuffer_info.renderPass = render_pass;
+	framebuffer_info.attachmentCount = image_views_count;
+	framebuffer_info.pAttachments = image_views;
+	framebuffer_info.width = extent.width;
+	framebuffer_info.height = extent.height;
+	framebuffer_info.layers = 1;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateFramebuffer)(device, &framebuffer_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_FRAMEBUFFER), &framebuffer));
+	__kvfAddFramebufferToArray(framebuffer, extent);
+	return framebuffer;
+}
+
+VkExtent2D kvfGetFramebufferSize(VkFramebuffer buffer)
+{
+	__KvfFramebuffer* kvf_framebuffer = __kvfGetKvfFramebufferFromVkFramebuffer(buffer);
+	KVF_ASSERT(kvf_framebuffer != NULL);
+	return kvf_framebuffer->extent;
+}
+
+void kvfDestroyFramebuffer(VkDevice device, VkFramebuffer framebuffer)
+{
+	if(framebuffer == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__kvfDestroyFramebuffer(device, framebuffer);
+}
+
+VkCommandBuffer kvfCreateCommandBuffer(VkDevice device)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	return kvfCreateCommandBufferLeveled(device, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+VkCommandBuffer kvfCreateCommandBufferLeveled(VkDevice device, VkCommandBufferLevel level)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	VkCommandPool pool = kvf_device->cmd_pool;
+	VkCommandBuffer buffer;
+	VkCommandBufferAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_info.commandPool = pool;
+	alloc_info.level = level;
+	alloc_info.commandBufferCount = 1;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateCommandBuffers)(device, &alloc_info, &buffer));
+
+	if(kvf_device->cmd_buffers_size >= kvf_device->cmd_buffers_capacity)
+	{
+		// Resize the dynamic array if necessary
+		kvf_device->cmd_buffers_capacity += KVF_COMMAND_POOL_CAPACITY;
+		kvf_device->cmd_buffers = (VkCommandBuffer*)KVF_REALLOC(kvf_device->cmd_buffers, kvf_device->cmd_buffers_capacity * sizeof(VkCommandBuffer));
+		KVF_ASSERT(kvf_device->cmd_buffers != NULL && "allocation failed :(");
+	}
+	kvf_device->cmd_buffers[kvf_device->cmd_buffers_size] = buffer;
+	kvf_device->cmd_buffers_size++;
+	return buffer;
+}
+
+void kvfBeginCommandBuffer(VkCommandBuffer buffer, VkCommandBufferUsageFlags usage)
+{
+	KVF_ASSERT(buffer != VK_NULL_HANDLE);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(buffer);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = usage;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBeginCommandBuffer)(buffer, &begin_info));
+}
+
+void kvfEndCommandBuffer(VkCommandBuffer buffer)
+{
+	KVF_ASSERT(buffer != VK_NULL_HANDLE);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(buffer);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkEndCommandBuffer)(buffer));
+}
+
+void kvfSubmitCommandBuffer(VkDevice device, VkCommandBuffer buffer, KvfQueueType queue, VkSemaphore signal, VkSemaphore wait, VkFence fence, VkPipelineStageFlags* stages)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkSemaphore signal_semaphores[1];
+	VkSemaphore wait_semaphores[1];
+	signal_semaphores[0] = signal;
+	wait_semaphores[0] = wait;
+
+	if(fence != VK_NULL_HANDLE)
+		KVF_GET_DEVICE_FUNCTION(vkResetFences)(device, 1, &fence);
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.waitSemaphoreCount = (wait == VK_NULL_HANDLE ? 0 : 1);
+	submit_info.pWaitSemaphores = wait_semaphores;
+	submit_info.pWaitDstStageMask = stages;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &buffer;
+	submit_info.signalSemaphoreCount = (signal == VK_NULL_HANDLE ? 0 : 1);
+	submit_info.pSignalSemaphores = signal_semaphores;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkQueueSubmit)(kvfGetDeviceQueue(device, queue), 1, &submit_info, fence));
+}
+
+void kvfSubmitSingleTimeCommandBuffer(VkDevice device, VkCommandBuffer buffer, KvfQueueType queue, VkFence fence)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+
+	if(fence != VK_NULL_HANDLE)
+		KVF_GET_DEVICE_FUNCTION(vkResetFences)(device, 1, &fence);
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &buffer;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkQueueSubmit)(kvfGetDeviceQueue(device, queue), 1, &submit_info, fence));
+	if(fence != VK_NULL_HANDLE)
+		kvfWaitForFence(device, fence);	
+}
+
+void kvfDestroyCommandBuffer(VkDevice device, VkCommandBuffer buffer)
+{
+	if(buffer == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	for(size_t i = 0; i < kvf_device->cmd_buffers_size; i++)
+	{
+		if(kvf_device->cmd_buffers[i] == buffer)
+		{
+			KVF_GET_DEVICE_FUNCTION(vkFreeCommandBuffers)(kvf_device->device, kvf_device->cmd_pool, 1, &buffer);
+			// Shift the elements to fill the gap
+			for(size_t j = i; j < kvf_device->cmd_buffers_size - 1; j++)
+				kvf_device->cmd_buffers[j] = kvf_device->cmd_buffers[j + 1];
+			kvf_device->cmd_buffers_size--;
+			return;
+		}
+    }
+	KVF_ASSERT(false && "could not find command buffer in internal device");
+}
+
+VkAttachmentDescription kvfBuildAttachmentDescription(KvfImageType type, VkFormat format, VkImageLayout initial, VkImageLayout final, bool clear, VkSampleCountFlagBits samples)
+{
+	VkAttachmentDescription attachment = {};
+
+	switch(type)
+	{
+		case KVF_IMAGE_CUBE:
+		case KVF_IMAGE_DEPTH_ARRAY:
+		case KVF_IMAGE_COLOR:
+		case KVF_IMAGE_DEPTH:
 		{
 			attachment.format = format;
 			attachment.initialLayout = initial;
@@ -2746,346 +6270,1884 @@ VkAttachmentDescription kvfBuildAttachmentDescription(KvfImageType type, VkForma
 			break;
 		}
 
-		default: KVF_ASSERT(false && "KVF Attachment Description builder : unsupported image type"); break;
-	}
+		default: KVF_ASSERT(false && "KVF Attachment Description builder : unsupported image type"); break;
+	}
+
+	if(clear)
+	{
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+	else
+	{
+		if(samples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+		else
+		{
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+	}
+
+	attachment.samples = samples;
+	if(samples != VK_SAMPLE_COUNT_1_BIT)
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	else
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachment.flags = 0;
+
+	return attachment;
+}
+
+#ifndef KVF_NO_KHR
+	VkAttachmentDescription kvfBuildSwapchainAttachmentDescription(VkSwapchainKHR swapchain, bool clear)
+	{
+		__KvfSwapchain* kvf_swapchain = __kvfGetKvfSwapchainFromVkSwapchainKHR(swapchain);
+		KVF_ASSERT(kvf_swapchain != NULL);
+		KVF_ASSERT(kvf_swapchain->images_count != 0);
+		return kvfBuildAttachmentDescription(KVF_IMAGE_COLOR, kvf_swapchain->images_format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, clear, VK_SAMPLE_COUNT_1_BIT);
+	}
+#endif
+
+VkRenderPass kvfCreateRenderPass(VkDevice device, VkAttachmentDescription* attachments, size_t attachments_count, VkPipelineBindPoint bind_point)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	return kvfCreateRenderPassWithSubpassDependencies(device, attachments, attachments_count, bind_point, NULL, 0);
+}
+
+VkRenderPass kvfCreateRenderPassWithSubpassDependencies(VkDevice device, VkAttachmentDescription* attachments, size_t attachments_count, VkPipelineBindPoint bind_point, VkSubpassDependency* dependencies, size_t dependencies_count)
+{
+	size_t color_attachment_count = 0;
+	size_t depth_attachment_count = 0;
+
+	for(size_t i = 0; i < attachments_count; i++)
+	{
+		if(kvfIsDepthFormat(attachments[i].format))
+			depth_attachment_count++;
+		else
+			color_attachment_count++;
+	}
+
+	VkAttachmentReference* color_references = NULL;
+	VkAttachmentReference* depth_references = NULL;
+
+	__KvfScratchMarker marker = __kvfScratchMark();
+	if(color_attachment_count != 0)
+		color_references = (VkAttachmentReference*)__kvfScratchPush(color_attachment_count * sizeof(VkAttachmentReference));
+	if(depth_attachment_count != 0)
+		depth_references = (VkAttachmentReference*)__kvfScratchPush(depth_attachment_count * sizeof(VkAttachmentReference));
+
+	for(size_t i = 0, c = 0, d = 0; i < attachments_count; i++)
+	{
+		if(!kvfIsDepthFormat(attachments[i].format))
+		{
+			VkImageLayout layout = attachments[i].finalLayout;
+			color_references[c].attachment = i;
+			if(layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR || layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL || layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+				layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			color_references[c].layout = layout;
+			c++;
+		}
+		else
+		{
+			depth_references[d].attachment = i;
+			depth_references[d].layout = attachments[i].finalLayout;
+			d++;
+		}
+	}
+
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = bind_point;
+	subpass.colorAttachmentCount = color_attachment_count;
+	subpass.pColorAttachments = color_references;
+	subpass.pDepthStencilAttachment = depth_references;
+
+	VkRenderPassCreateInfo renderpass_create_info = {};
+	renderpass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderpass_create_info.attachmentCount = attachments_count;
+	renderpass_create_info.pAttachments = attachments;
+	renderpass_create_info.subpassCount = 1;
+	renderpass_create_info.pSubpasses = &subpass;
+	renderpass_create_info.dependencyCount = dependencies_count;
+	renderpass_create_info.pDependencies = dependencies;
+
+	VkRenderPass render_pass = VK_NULL_HANDLE;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateRenderPass)(device, &renderpass_create_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_RENDER_PASS), &render_pass));
+	__kvfScratchRewind(marker);
+	return render_pass;
+}
+
+void kvfDestroyRenderPass(VkDevice device, VkRenderPass renderPass)
+{
+	if(renderPass == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_GET_DEVICE_FUNCTION(vkDestroyRenderPass)(device, renderPass, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_RENDER_PASS));
+}
+
+void kvfBeginRenderPass(VkRenderPass pass, VkCommandBuffer cmd, VkFramebuffer framebuffer, VkExtent2D framebuffer_extent, VkClearValue* clears, size_t clears_count)
+{
+	KVF_ASSERT(pass != VK_NULL_HANDLE);
+	KVF_ASSERT(framebuffer != VK_NULL_HANDLE);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+
+	VkOffset2D offset = { 0, 0 };
+	VkRenderPassBeginInfo renderpass_info = {};
+	renderpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderpass_info.renderPass = pass;
+	renderpass_info.framebuffer = framebuffer;
+	renderpass_info.renderArea.offset = offset;
+	renderpass_info.renderArea.extent = framebuffer_extent;
+	renderpass_info.clearValueCount = clears_count;
+	renderpass_info.pClearValues = clears;
+	KVF_GET_DEVICE_FUNCTION(vkCmdBeginRenderPass)(cmd, &renderpass_info, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+VkShaderModule kvfCreateShaderModule(VkDevice device, uint32_t* code, size_t size)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = size * sizeof(uint32_t);
+	createInfo.pCode = code;
+	VkShaderModule shader = VK_NULL_HANDLE;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateShaderModule)(device, &createInfo, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SHADER_MODULE), &shader));
+	return shader;
+}
+
+void kvfDestroyShaderModule(VkDevice device, VkShaderModule shader)
+{
+	if(shader == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_GET_DEVICE_FUNCTION(vkDestroyShaderModule)(device, shader, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_SHADER_MODULE));
+}
+
+// Size of the info a descriptor of this type reads in update templates, 0 for non core types
+size_t __kvfDescriptorInfoSize(VkDescriptorType type)
+{
+	switch(type)
+	{
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: return sizeof(VkDescriptorBufferInfo);
+
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: return sizeof(VkBufferView);
+
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: return sizeof(VkDescriptorImageInfo);
+
+		default: return 0;
+	}
+}
+
+VkDescriptorSetLayout kvfCreateDescriptorSetLayout(VkDevice device, VkDescriptorSetLayoutBinding* bindings, size_t bindings_count)
+{
+	return kvfCreateDescriptorSetLayoutWithFlags(device, bindings, bindings_count, 0);
+}
+
+VkDescriptorSetLayout kvfCreateDescriptorSetLayoutWithFlags(VkDevice device, VkDescriptorSetLayoutBinding* bindings, size_t bindings_count, VkDescriptorSetLayoutCreateFlags flags)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	VkDescriptorSetLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.flags = flags;
+	layout_info.bindingCount = bindings_count;
+	layout_info.pBindings = bindings;
+
+	VkDescriptorSetLayout layout;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorSetLayout)(device, &layout_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &layout));
+
+	// Descriptors counts are kept for the pools accounting
+	if(kvf_device->set_layouts_size == kvf_device->set_layouts_capacity)
+	{
+		kvf_device->set_layouts_capacity += 16;
+		kvf_device->set_layouts = (__KvfDescriptorSetLayoutInfo*)KVF_REALLOC(kvf_device->set_layouts, sizeof(__KvfDescriptorSetLayoutInfo) * kvf_device->set_layouts_capacity);
+		KVF_ASSERT(kvf_device->set_layouts != NULL && "allocation failed :(");
+	}
+	__KvfDescriptorSetLayoutInfo* info = &kvf_device->set_layouts[kvf_device->set_layouts_size];
+	memset(info, 0, sizeof(__KvfDescriptorSetLayoutInfo));
+	info->layout = layout;
+	info->flags = flags;
+	for(size_t i = 0; i < bindings_count; i++)
+	{
+		if((uint32_t)bindings[i].descriptorType < __KVF_DESCRIPTOR_TYPE_COUNT)
+			info->counts[bindings[i].descriptorType] += bindings[i].descriptorCount;
+	}
+
+	// Update template entries, the template itself is only created if used
+	if(bindings_count != 0)
+	{
+		info->template_entries = (VkDescriptorUpdateTemplateEntry*)KVF_MALLOC(sizeof(VkDescriptorUpdateTemplateEntry) * bindings_count);
+		KVF_ASSERT(info->template_entries != NULL && "allocation failed :(");
+	}
+	for(size_t i = 0; i < bindings_count; i++)
+	{
+		if(bindings[i].descriptorCount == 0 || (bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && bindings[i].pImmutableSamplers != NULL))
+			continue;
+		size_t stride = __kvfDescriptorInfoSize(bindings[i].descriptorType);
+		if(stride == 0)
+			continue;
+		VkDescriptorUpdateTemplateEntry* entry = &info->template_entries[info->template_entries_count];
+		entry->dstBinding = bindings[i].binding;
+		entry->dstArrayElement = 0;
+		entry->descriptorCount = bindings[i].descriptorCount;
+		entry->descriptorType = bindings[i].descriptorType;
+		entry->offset = info->template_data_size;
+		entry->stride = stride;
+		info->template_data_size += stride * bindings[i].descriptorCount;
+		info->template_entries_count++;
+	}
+
+	// Descriptor buffer layouts have a fixed size and fixed binding offsets
+	if(flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT)
+	{
+		const __KvfDescriptorBufferFunctions* fns = __kvfGetDescriptorBufferFunctions(kvf_device);
+		fns->vkGetDescriptorSetLayoutSizeEXT(device, layout, &info->descriptor_buffer_size);
+		for(size_t i = 0; i < bindings_count; i++)
+		{
+			if(bindings[i].binding >= info->binding_offsets_count)
+				info->binding_offsets_count = bindings[i].binding + 1;
+		}
+		if(info->binding_offsets_count != 0)
+		{
+			info->binding_offsets = (VkDeviceSize*)KVF_MALLOC(sizeof(VkDeviceSize) * info->binding_offsets_count);
+			KVF_ASSERT(info->binding_offsets != NULL && "allocation failed :(");
+			for(uint32_t i = 0; i < info->binding_offsets_count; i++)
+				info->binding_offsets[i] = __KVF_NO_BINDING_OFFSET;
+		}
+		for(size_t i = 0; i < bindings_count; i++)
+			fns->vkGetDescriptorSetLayoutBindingOffsetEXT(device, layout, bindings[i].binding, &info->binding_offsets[bindings[i].binding]);
+	}
+	kvf_device->set_layouts_size++;
+	return layout;
+}
+
+void __kvfDestroyDescriptorSetLayout(__KvfDevice* kvf_device, VkDescriptorSetLayout layout)
+{
+	KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorSetLayout)(kvf_device->device, layout, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+	// Cached sets of the layout may still be in flight, they are left to age out in kvfDescriptorSetCacheNextFrame
+	// and flagged so that a layout reusing the handle never gets them
+	for(size_t j = 0; j < kvf_device->descriptor_sets_capacity; j++)
+	{
+		if(kvf_device->descriptor_sets[j].set != VK_NULL_HANDLE && kvf_device->descriptor_sets[j].layout == layout)
+			kvf_device->descriptor_sets[j].orphaned = true;
+	}
+	for(size_t i = 0; i < kvf_device->set_layouts_size; i++)
+	{
+		if(kvf_device->set_layouts[i].layout != layout)
+			continue;
+		__kvfReleaseDescriptorSetLayoutInfo(kvf_device, &kvf_device->set_layouts[i]);
+		// Shift the elements to fill the gap
+		for(size_t j = i; j < kvf_device->set_layouts_size - 1; j++)
+			kvf_device->set_layouts[j] = kvf_device->set_layouts[j + 1];
+		kvf_device->set_layouts_size--;
+		break;
+	}
+}
+
+void kvfDestroyDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout layout)
+{
+	if(layout == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	// The cache entry would outlive the handle, which may then be reused by an unrelated layout
+	KVF_ASSERT(__kvfLayoutCacheIndexOf(&kvf_device->set_layouts_cache, (uint64_t)layout) == SIZE_MAX && "cached descriptor set layouts must be released, not destroyed");
+	__kvfDestroyDescriptorSetLayout(kvf_device, layout);
+}
+
+VkDescriptorUpdateTemplate kvfGetDescriptorSetLayoutUpdateTemplate(VkDevice device, VkDescriptorSetLayout layout)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(layout != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layout);
+	KVF_ASSERT(info != NULL && "layout was not created with kvfCreateDescriptorSetLayout");
+	if(info->update_template != VK_NULL_HANDLE)
+		return info->update_template;
+	KVF_ASSERT(info->template_entries_count != 0 && "layout has no descriptor to update");
+	KVF_ASSERT(!(info->flags & __KVF_SETLESS_LAYOUT_FLAGS) && "push descriptor and descriptor buffer layouts have no set to update");
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		KVF_ASSERT(kvf_device->fns.vkCreateDescriptorUpdateTemplate != NULL && "descriptor update templates need Vulkan 1.1");
+	#endif
+
+	VkDescriptorUpdateTemplateCreateInfo template_info = {};
+	template_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	template_info.descriptorUpdateEntryCount = info->template_entries_count;
+	template_info.pDescriptorUpdateEntries = info->template_entries;
+	template_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	template_info.descriptorSetLayout = layout;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorUpdateTemplate)(device, &template_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE), &info->update_template));
+	return info->update_template;
+}
+
+size_t kvfGetDescriptorSetLayoutUpdateDataSize(VkDevice device, VkDescriptorSetLayout layout)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layout);
+	KVF_ASSERT(info != NULL && "layout was not created with kvfCreateDescriptorSetLayout");
+	return info->template_data_size;
+}
+
+void kvfUpdateDescriptorSetWithTemplate(VkDevice device, VkDescriptorSet set, VkDescriptorSetLayout layout, const void* data)
+{
+	KVF_ASSERT(set != VK_NULL_HANDLE);
+	KVF_ASSERT(data != NULL);
+	VkDescriptorUpdateTemplate update_template = kvfGetDescriptorSetLayoutUpdateTemplate(device, layout);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSetWithTemplate)(device, set, update_template, data);
+}
+
+bool __kvfDescriptorPoolFits(const __KvfDescriptorPool* pool, const uint32_t* counts)
+{
+	if(pool->full || pool->size >= pool->capacity)
+		return false;
+	if(counts == NULL)
+		return true;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+	{
+		if(pool->descriptors_size[i] + counts[i] > pool->descriptors_capacity[i])
+			return false;
+	}
+	return true;
+}
+
+// Returns false when the pool is out of memory, in which case no set is allocated, other errors are fatal
+bool __kvfTryAllocateDescriptorSetsFromPool(__KvfDevice* kvf_device, __KvfDescriptorPool* pool, const VkDescriptorSetLayout* layouts, const uint32_t* const* counts, uint32_t count, VkDescriptorSet* sets, size_t* failed_allocations)
+{
+	VkDescriptorSetAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_info.descriptorPool = pool->pool;
+	alloc_info.descriptorSetCount = count;
+	alloc_info.pSetLayouts = layouts;
+	VkResult result = KVF_GET_DEVICE_FUNCTION(vkAllocateDescriptorSets)(kvf_device->device, &alloc_info, sets);
+	if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		pool->full = true;
+		(*failed_allocations)++;
+		return false;
+	}
+	__kvfCheckVk(result);
+	pool->size += count;
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(counts[i] == NULL)
+			continue;
+		for(uint32_t j = 0; j < __KVF_DESCRIPTOR_TYPE_COUNT; j++)
+			pool->descriptors_size[j] += counts[i][j];
+	}
+	return true;
+}
+
+bool __kvfTryAllocateDescriptorSetFromPool(__KvfDevice* kvf_device, __KvfDescriptorPool* pool, VkDescriptorSetLayout layout, const uint32_t* counts, VkDescriptorSet* set, size_t* failed_allocations)
+{
+	return __kvfTryAllocateDescriptorSetsFromPool(kvf_device, pool, &layout, &counts, 1, set, failed_allocations);
+}
+
+// Number of sets from the start of counts that fit in the pool together
+uint32_t __kvfDescriptorPoolFittingRun(const __KvfDescriptorPool* pool, const uint32_t* const* counts, uint32_t count)
+{
+	if(pool->full || pool->size >= pool->capacity)
+		return 0;
+	size_t max_sets = pool->capacity - pool->size;
+	if(count > max_sets)
+		count = (uint32_t)max_sets;
+	uint32_t descriptors_size[__KVF_DESCRIPTOR_TYPE_COUNT];
+	memcpy(descriptors_size, pool->descriptors_size, sizeof(descriptors_size));
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(counts[i] == NULL)
+			continue;
+		for(uint32_t j = 0; j < __KVF_DESCRIPTOR_TYPE_COUNT; j++)
+		{
+			descriptors_size[j] += counts[i][j];
+			if(descriptors_size[j] > pool->descriptors_capacity[j])
+				return i;
+		}
+	}
+	return count;
+}
+
+VkDescriptorSet __kvfAllocateDescriptorSet(__KvfDevice* kvf_device, VkDescriptorSetLayout layout, size_t* pool_index)
+{
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layout);
+	KVF_ASSERT((info == NULL || !(info->flags & __KVF_SETLESS_LAYOUT_FLAGS)) && "push descriptor and descriptor buffer layouts cannot allocate sets");
+	const uint32_t* counts = (info != NULL ? info->counts : NULL);
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	// Most recent pools are the biggest ones
+	for(size_t i = kvf_device->sets_pools_size; i > 0; i--)
+	{
+		__KvfDescriptorPool* pool = &kvf_device->sets_pools[i - 1];
+		if(__kvfDescriptorPoolFits(pool, counts) && __kvfTryAllocateDescriptorSetFromPool(kvf_device, pool, layout, counts, &set, &kvf_device->sets_pools_failed_allocations))
+		{
+			*pool_index = i - 1;
+			return set;
+		}
+	}
+
+	__KvfDescriptorPool* pool = __kvfDeviceCreateDescriptorPool(kvf_device->device, counts);
+	bool allocated = __kvfTryAllocateDescriptorSetFromPool(kvf_device, pool, layout, counts, &set, &kvf_device->sets_pools_failed_allocations);
+	KVF_ASSERT(allocated && "could not allocate a descriptor set from a new pool");
+	(void)allocated;
+	KVF_ASSERT(set != VK_NULL_HANDLE);
+	*pool_index = kvf_device->sets_pools_size - 1;
+	return set;
+}
+
+VkDescriptorSet kvfAllocateDescriptorSet(VkDevice device, VkDescriptorSetLayout layout)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	size_t pool_index;
+	return __kvfAllocateDescriptorSet(kvf_device, layout, &pool_index);
+}
+
+void kvfAllocateDescriptorSets(VkDevice device, const VkDescriptorSetLayout* layouts, uint32_t count, VkDescriptorSet* sets)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(count == 0 || (layouts != NULL && sets != NULL));
+	if(count == 0)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	__KvfScratchMarker marker = __kvfScratchMark();
+	const uint32_t** counts = (const uint32_t**)__kvfScratchPush(sizeof(const uint32_t*) * count);
+	// Sets of a same layout usually follow each other, the layout is only looked up when it changes
+	__KvfDescriptorSetLayoutInfo* info = NULL;
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(i == 0 || layouts[i] != layouts[i - 1])
+		{
+			info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layouts[i]);
+			KVF_ASSERT((info == NULL || !(info->flags & __KVF_SETLESS_LAYOUT_FLAGS)) && "push descriptor and descriptor buffer layouts cannot allocate sets");
+		}
+		counts[i] = (info != NULL ? info->counts : NULL);
+	}
+
+	// Walks the pools once from the most recent, the biggest ones, then creates new pools for what is left
+	uint32_t allocated = 0;
+	size_t pool_index = kvf_device->sets_pools_size;
+	while(allocated < count)
+	{
+		bool new_pool = (pool_index == 0);
+		__KvfDescriptorPool* pool;
+		if(new_pool)
+			pool = __kvfDeviceCreateDescriptorPool(device, counts[allocated]);
+		else
+			pool = &kvf_device->sets_pools[--pool_index];
+
+		uint32_t run = __kvfDescriptorPoolFittingRun(pool, counts + allocated, count - allocated);
+		if(run != 0 && __kvfTryAllocateDescriptorSetsFromPool(kvf_device, pool, layouts + allocated, counts + allocated, run, sets + allocated, &kvf_device->sets_pools_failed_allocations))
+		{
+			allocated += run;
+			continue;
+		}
+		KVF_ASSERT(!new_pool && "could not allocate a descriptor set from a new pool");
+		if(new_pool)
+		{
+			memset(sets + allocated, 0, sizeof(VkDescriptorSet) * (count - allocated));
+			break;
+		}
+	}
+	__kvfScratchRewind(marker);
+}
+
+// Copies the descriptors infos field by field so that the padding of the caller's data does not change the key
+void __kvfNormalizeDescriptorData(const __KvfDescriptorSetLayoutInfo* info, const void* data, uint8_t* normalized)
+{
+	memset(normalized, 0, info->template_data_size);
+	for(uint32_t i = 0; i < info->template_entries_count; i++)
+	{
+		const VkDescriptorUpdateTemplateEntry* entry = &info->template_entries[i];
+		for(uint32_t j = 0; j < entry->descriptorCount; j++)
+		{
+			size_t offset = entry->offset + j * entry->stride;
+			const uint8_t* src = (const uint8_t*)data + offset;
+			switch(entry->descriptorType)
+			{
+				case VK_DESCRIPTOR_TYPE_SAMPLER:
+				case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+				case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+				case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+				case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+				{
+					const VkDescriptorImageInfo* src_info = (const VkDescriptorImageInfo*)src;
+					VkDescriptorImageInfo* dst_info = (VkDescriptorImageInfo*)(normalized + offset);
+					dst_info->sampler = src_info->sampler;
+					dst_info->imageView = src_info->imageView;
+					dst_info->imageLayout = src_info->imageLayout;
+					break;
+				}
+				default: memcpy(normalized + offset, src, entry->stride); break; // Buffer infos and buffer views have no padding
+			}
+		}
+	}
+}
+
+VkDescriptorSet kvfGetCachedDescriptorSet(VkDevice device, VkDescriptorSetLayout layout, const void* data)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(data != NULL);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layout);
+	KVF_ASSERT(info != NULL && "layout was not created with kvfCreateDescriptorSetLayout");
+	// A pending set may reference a destroyed resource whose handle was reused
+	__kvfFlushDescriptorSetCacheInvalidations(kvf_device);
+
+	__KvfScratchMarker marker = __kvfScratchMark();
+	uint8_t* normalized = (uint8_t*)__kvfScratchPush(info->template_data_size + 1);
+	__kvfNormalizeDescriptorData(info, data, normalized);
+	uint32_t hash = __kvfHashBytes(&layout, sizeof(VkDescriptorSetLayout), __KVF_FNV_OFFSET_BASIS);
+	hash = __kvfHashBytes(normalized, info->template_data_size, hash);
+
+	// Keeps the load factor under 3/4
+	if((kvf_device->descriptor_sets_size + 1) * 4 > kvf_device->descriptor_sets_capacity * 3)
+		__kvfDescriptorSetCacheGrow(kvf_device);
+
+	__KvfDescriptorSetCacheEntry* entry = __kvfDescriptorSetCacheFind(kvf_device, layout, normalized, info->template_data_size, hash);
+	if(entry->set != VK_NULL_HANDLE)
+	{
+		entry->last_used_frame = kvf_device->descriptor_sets_frame;
+		__kvfScratchRewind(marker);
+		return entry->set;
+	}
+
+	entry->layout = layout;
+	entry->hash = hash;
+	entry->orphaned = false;
+	memcpy(entry->counts, info->counts, sizeof(entry->counts));
+	entry->data_size = info->template_data_size;
+	entry->data = KVF_MALLOC(info->template_data_size + 1);
+	KVF_ASSERT(entry->data != NULL && "allocation failed :(");
+	memcpy(entry->data, normalized, info->template_data_size);
+	entry->last_used_frame = kvf_device->descriptor_sets_frame;
+	__kvfScratchRewind(marker);
+	entry->set = __kvfAllocateDescriptorSet(kvf_device, layout, &entry->pool_index);
+	kvf_device->descriptor_sets_size++;
+
+	if(info->template_entries_count != 0)
+	{
+		marker = __kvfScratchMark();
+		VkWriteDescriptorSet* writes = (VkWriteDescriptorSet*)__kvfScratchPush(sizeof(VkWriteDescriptorSet) * info->template_entries_count);
+		for(uint32_t i = 0; i < info->template_entries_count; i++)
+		{
+			const VkDescriptorUpdateTemplateEntry* template_entry = &info->template_entries[i];
+			const void* infos = (const uint8_t*)entry->data + template_entry->offset;
+			memset(&writes[i], 0, sizeof(VkWriteDescriptorSet));
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = entry->set;
+			writes[i].dstBinding = template_entry->dstBinding;
+			writes[i].dstArrayElement = template_entry->dstArrayElement;
+			writes[i].descriptorCount = template_entry->descriptorCount;
+			writes[i].descriptorType = template_entry->descriptorType;
+			switch(template_entry->descriptorType)
+			{
+				case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+				case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+				case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+				case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: writes[i].pBufferInfo = (const VkDescriptorBufferInfo*)infos; break;
+
+				case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+				case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: writes[i].pTexelBufferView = (const VkBufferView*)infos; break;
+
+				default: writes[i].pImageInfo = (const VkDescriptorImageInfo*)infos; break;
+			}
+		}
+		KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, info->template_entries_count, writes, 0, NULL);
+		__kvfScratchRewind(marker);
+	}
+	return entry->set;
+}
+
+void kvfDescriptorSetCacheNextFrame(VkDevice device, uint32_t max_unused_frames)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__kvfFlushDescriptorSetCacheInvalidations(kvf_device);
+	kvf_device->descriptor_sets_frame++;
+	size_t i = 0;
+	while(i < kvf_device->descriptor_sets_capacity && kvf_device->descriptor_sets_size != 0)
+	{
+		__KvfDescriptorSetCacheEntry* entry = &kvf_device->descriptor_sets[i];
+		if(entry->set != VK_NULL_HANDLE && kvf_device->descriptor_sets_frame - entry->last_used_frame > max_unused_frames)
+			__kvfDescriptorSetCacheRemoveAt(kvf_device, i);
+		else
+			i++;
+	}
+}
+
+uint32_t __kvfHashDescriptorSetCacheInvalidation(uint64_t handle, VkObjectType type)
+{
+	uint32_t hash = __kvfHashBytes(&handle, sizeof(uint64_t), __KVF_FNV_OFFSET_BASIS);
+	return __kvfHashBytes(&type, sizeof(VkObjectType), hash);
+}
+
+bool __kvfDescriptorSetCacheInvalidationsContain(const __KvfDescriptorSetCacheInvalidation* resources, size_t mask, uint64_t handle, VkObjectType type)
+{
+	if(handle == 0)
+		return false;
+	for(size_t i = __kvfHashDescriptorSetCacheInvalidation(handle, type) & mask;; i = (i + 1) & mask)
+	{
+		if(resources[i].handle == 0)
+			return false;
+		if(resources[i].handle == handle && resources[i].type == type)
+			return true;
+	}
+}
+
+bool __kvfDescriptorDataReferences(const __KvfDescriptorSetLayoutInfo* info, const uint8_t* data, const __KvfDescriptorSetCacheInvalidation* resources, size_t mask)
+{
+	for(uint32_t i = 0; i < info->template_entries_count; i++)
+	{
+		const VkDescriptorUpdateTemplateEntry* entry = &info->template_entries[i];
+		for(uint32_t j = 0; j < entry->descriptorCount; j++)
+		{
+			const uint8_t* descriptor = data + entry->offset + j * entry->stride;
+			uint64_t handle;
+			VkObjectType type;
+			switch(entry->descriptorType)
+			{
+				case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+				case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+				case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+				case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+					handle = (uint64_t)((const VkDescriptorBufferInfo*)descriptor)->buffer;
+					type = VK_OBJECT_TYPE_BUFFER;
+					break;
+				case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+				case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+					handle = (uint64_t)*(const VkBufferView*)descriptor;
+					type = VK_OBJECT_TYPE_BUFFER_VIEW;
+					break;
+				default:
+					handle = (uint64_t)((const VkDescriptorImageInfo*)descriptor)->imageView;
+					type = VK_OBJECT_TYPE_IMAGE_VIEW;
+					break;
+			}
+			if(__kvfDescriptorSetCacheInvalidationsContain(resources, mask, handle, type))
+				return true;
+		}
+	}
+	return false;
+}
+
+// Drops the cached sets referencing any of the pending destroyed resources, visiting each set once for the whole batch
+void __kvfFlushDescriptorSetCacheInvalidations(__KvfDevice* kvf_device)
+{
+	if(kvf_device->descriptor_sets_invalidations_size == 0)
+		return;
+	__KvfScratchMarker marker = __kvfScratchMark();
+
+	size_t resources_capacity = 16;
+	while(resources_capacity < kvf_device->descriptor_sets_invalidations_size * 2)
+		resources_capacity *= 2;
+	size_t resources_mask = resources_capacity - 1;
+	__KvfDescriptorSetCacheInvalidation* resources = (__KvfDescriptorSetCacheInvalidation*)__kvfScratchPush(sizeof(__KvfDescriptorSetCacheInvalidation) * resources_capacity);
+	memset(resources, 0, sizeof(__KvfDescriptorSetCacheInvalidation) * resources_capacity);
+	for(size_t i = 0; i < kvf_device->descriptor_sets_invalidations_size; i++)
+	{
+		const __KvfDescriptorSetCacheInvalidation* invalidation = &kvf_device->descriptor_sets_invalidations[i];
+		size_t j = __kvfHashDescriptorSetCacheInvalidation(invalidation->handle, invalidation->type) & resources_mask;
+		while(resources[j].handle != 0 && (resources[j].handle != invalidation->handle || resources[j].type != invalidation->type))
+			j = (j + 1) & resources_mask;
+		resources[j] = *invalidation;
+	}
+
+	// Layout informations by handle, saves a linear lookup per set
+	size_t layouts_capacity = 16;
+	while(layouts_capacity < kvf_device->set_layouts_size * 2)
+		layouts_capacity *= 2;
+	size_t layouts_mask = layouts_capacity - 1;
+	__KvfDescriptorSetLayoutInfo** layouts = (__KvfDescriptorSetLayoutInfo**)__kvfScratchPush(sizeof(__KvfDescriptorSetLayoutInfo*) * layouts_capacity);
+	memset(layouts, 0, sizeof(__KvfDescriptorSetLayoutInfo*) * layouts_capacity);
+	for(size_t i = 0; i < kvf_device->set_layouts_size; i++)
+	{
+		size_t j = __kvfHashBytes(&kvf_device->set_layouts[i].layout, sizeof(VkDescriptorSetLayout), __KVF_FNV_OFFSET_BASIS) & layouts_mask;
+		while(layouts[j] != NULL)
+			j = (j + 1) & layouts_mask;
+		layouts[j] = &kvf_device->set_layouts[i];
+	}
+
+	size_t i = 0;
+	while(i < kvf_device->descriptor_sets_capacity && kvf_device->descriptor_sets_size != 0)
+	{
+		__KvfDescriptorSetCacheEntry* entry = &kvf_device->descriptor_sets[i];
+		// Orphaned sets are never returned again, their data may not match a layout reusing the handle
+		if(entry->set == VK_NULL_HANDLE || entry->orphaned)
+		{
+			i++;
+			continue;
+		}
+		size_t j = __kvfHashBytes(&entry->layout, sizeof(VkDescriptorSetLayout), __KVF_FNV_OFFSET_BASIS) & layouts_mask;
+		while(layouts[j] != NULL && layouts[j]->layout != entry->layout)
+			j = (j + 1) & layouts_mask;
+		if(layouts[j] != NULL && __kvfDescriptorDataReferences(layouts[j], (const uint8_t*)entry->data, resources, resources_mask))
+			__kvfDescriptorSetCacheRemoveAt(kvf_device, i);
+		else
+			i++;
+	}
+
+	__kvfScratchRewind(marker);
+	kvf_device->descriptor_sets_invalidations_size = 0;
+}
+
+void __kvfInvalidateCachedDescriptorSets(__KvfDevice* kvf_device, uint64_t handle, VkObjectType type)
+{
+	if(kvf_device->descriptor_sets_size == 0)
+		return;
+	if(kvf_device->descriptor_sets_invalidations_size == kvf_device->descriptor_sets_invalidations_capacity)
+	{
+		kvf_device->descriptor_sets_invalidations_capacity = (kvf_device->descriptor_sets_invalidations_capacity == 0 ? 16 : kvf_device->descriptor_sets_invalidations_capacity * 2);
+		kvf_device->descriptor_sets_invalidations = (__KvfDescriptorSetCacheInvalidation*)KVF_REALLOC(kvf_device->descriptor_sets_invalidations, sizeof(__KvfDescriptorSetCacheInvalidation) * kvf_device->descriptor_sets_invalidations_capacity);
+		KVF_ASSERT(kvf_device->descriptor_sets_invalidations != NULL && "allocation failed :(");
+	}
+	__KvfDescriptorSetCacheInvalidation* invalidation = &kvf_device->descriptor_sets_invalidations[kvf_device->descriptor_sets_invalidations_size++];
+	invalidation->handle = handle;
+	invalidation->type = type;
+	// Bounds the batch so that a scan of the cache is shared by a number of destructions proportional to its capacity
+	if(kvf_device->descriptor_sets_invalidations_size * 4 >= kvf_device->descriptor_sets_capacity)
+		__kvfFlushDescriptorSetCacheInvalidations(kvf_device);
+}
+
+void kvfInvalidateCachedDescriptorSets(VkDevice device, VkBuffer buffer, VkImageView view)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	if(buffer != VK_NULL_HANDLE)
+		__kvfInvalidateCachedDescriptorSets(kvf_device, (uint64_t)buffer, VK_OBJECT_TYPE_BUFFER);
+	if(view != VK_NULL_HANDLE)
+		__kvfInvalidateCachedDescriptorSets(kvf_device, (uint64_t)view, VK_OBJECT_TYPE_IMAGE_VIEW);
+}
+
+void kvfInvalidateCachedDescriptorSetsForBufferView(VkDevice device, VkBufferView buffer_view)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	if(buffer_view == VK_NULL_HANDLE)
+		return;
+	__kvfInvalidateCachedDescriptorSets(kvf_device, (uint64_t)buffer_view, VK_OBJECT_TYPE_BUFFER_VIEW);
+}
+
+size_t kvfGetCachedDescriptorSetsCount(VkDevice device)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__kvfFlushDescriptorSetCacheInvalidations(kvf_device);
+	return kvf_device->descriptor_sets_size;
+}
+
+void kvfUpdateStorageBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+{
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkWriteDescriptorSet write = kvfWriteStorageBufferToDescriptorSet(device, set, info, binding);
+	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, 1, &write, 0, NULL);
+}
+
+void kvfUpdateUniformBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+{
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkWriteDescriptorSet write = kvfWriteUniformBufferToDescriptorSet(device, set, info, binding);
+	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, 1, &write, 0, NULL);
+}
+
+void kvfUpdateImageToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorImageInfo* info, uint32_t binding)
+{
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	VkWriteDescriptorSet write = kvfWriteImageToDescriptorSet(device, set, info, binding);
+	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, 1, &write, 0, NULL);
+}
+
+VkWriteDescriptorSet kvfWriteStorageBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(set != VK_NULL_HANDLE);
+	VkWriteDescriptorSet descriptor_write = {};
+	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_write.dstSet = set;
+	descriptor_write.dstBinding = binding;
+	descriptor_write.dstArrayElement = 0;
+	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptor_write.descriptorCount = 1;
+	descriptor_write.pBufferInfo = info;
+	descriptor_write.pNext = NULL;
+	return descriptor_write;
+}
+
+VkWriteDescriptorSet kvfWriteUniformBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(set != VK_NULL_HANDLE);
+	VkWriteDescriptorSet descriptor_write = {};
+	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_write.dstSet = set;
+	descriptor_write.dstBinding = binding;
+	descriptor_write.dstArrayElement = 0;
+	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptor_write.descriptorCount = 1;
+	descriptor_write.pBufferInfo = info;
+	descriptor_write.pNext = NULL;
+	return descriptor_write;
+}
+
+VkWriteDescriptorSet kvfWriteImageToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorImageInfo* info, uint32_t binding)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(set != VK_NULL_HANDLE);
+	VkWriteDescriptorSet descriptor_write = {};
+	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_write.dstSet = set;
+	descriptor_write.dstBinding = binding;
+	descriptor_write.dstArrayElement = 0;
+	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_write.descriptorCount = 1;
+	descriptor_write.pImageInfo = info;
+	descriptor_write.pNext = NULL;
+	return descriptor_write;
+}
 
-	if(clear)
-	{
-		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	}
-	else
+KvfDescriptorWriteBatch* kvfCreateDescriptorWriteBatch(VkDevice device)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KvfDescriptorWriteBatch* batch = (KvfDescriptorWriteBatch*)KVF_MALLOC(sizeof(KvfDescriptorWriteBatch));
+	KVF_ASSERT(batch != NULL && "allocation failed :(");
+	memset(batch, 0, sizeof(KvfDescriptorWriteBatch));
+	batch->device = device;
+	return batch;
+}
+
+void kvfDestroyDescriptorWriteBatch(KvfDescriptorWriteBatch* batch)
+{
+	if(batch == NULL)
+		return;
+	KVF_FREE(batch->writes);
+	KVF_FREE(batch->buffer_infos);
+	KVF_FREE(batch->image_infos);
+	KVF_FREE(batch->texel_views);
+	KVF_FREE(batch);
+}
+
+// Doubles the capacity of an array until it can hold required elements
+void* __kvfReserveArray(void* array, size_t* capacity, size_t required, size_t element_size)
+{
+	if(required <= *capacity)
+		return array;
+	size_t new_capacity = (*capacity == 0 ? 16 : *capacity);
+	while(new_capacity < required)
+		new_capacity *= 2;
+	array = KVF_REALLOC(array, new_capacity * element_size);
+	KVF_ASSERT(array != NULL && "allocation failed :(");
+	*capacity = new_capacity;
+	return array;
+}
+
+void __kvfDescriptorWriteBatchAddWrite(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, uint32_t count)
+{
+	if(batch->writes_size != 0)
 	{
-		if(samples != VK_SAMPLE_COUNT_1_BIT)
+		VkWriteDescriptorSet* last = &batch->writes[batch->writes_size - 1];
+		if(last->dstSet == set && last->dstBinding == binding && last->descriptorType == type && last->dstArrayElement + last->descriptorCount == array_element)
 		{
-			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			last->descriptorCount += count;
+			return;
 		}
-		else
+	}
+	batch->writes = (VkWriteDescriptorSet*)__kvfReserveArray(batch->writes, &batch->writes_capacity, batch->writes_size + 1, sizeof(VkWriteDescriptorSet));
+	VkWriteDescriptorSet* write = &batch->writes[batch->writes_size];
+	memset(write, 0, sizeof(VkWriteDescriptorSet));
+	write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write->dstSet = set;
+	write->dstBinding = binding;
+	write->dstArrayElement = array_element;
+	write->descriptorType = type;
+	write->descriptorCount = count;
+	batch->writes_size++;
+}
+
+void kvfDescriptorWriteBatchAddBuffers(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkDescriptorBufferInfo* infos, uint32_t count)
+{
+	KVF_ASSERT(batch != NULL);
+	KVF_ASSERT(infos != NULL && count != 0);
+	KVF_ASSERT((type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) && "not a buffer descriptor type");
+	batch->buffer_infos = (VkDescriptorBufferInfo*)__kvfReserveArray(batch->buffer_infos, &batch->buffer_infos_capacity, batch->buffer_infos_size + count, sizeof(VkDescriptorBufferInfo));
+	memcpy(batch->buffer_infos + batch->buffer_infos_size, infos, sizeof(VkDescriptorBufferInfo) * count);
+	batch->buffer_infos_size += count;
+	__kvfDescriptorWriteBatchAddWrite(batch, set, binding, array_element, type, count);
+}
+
+void kvfDescriptorWriteBatchAddImages(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkDescriptorImageInfo* infos, uint32_t count)
+{
+	KVF_ASSERT(batch != NULL);
+	KVF_ASSERT(infos != NULL && count != 0);
+	KVF_ASSERT((type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT) && "not an image descriptor type");
+	batch->image_infos = (VkDescriptorImageInfo*)__kvfReserveArray(batch->image_infos, &batch->image_infos_capacity, batch->image_infos_size + count, sizeof(VkDescriptorImageInfo));
+	memcpy(batch->image_infos + batch->image_infos_size, infos, sizeof(VkDescriptorImageInfo) * count);
+	batch->image_infos_size += count;
+	__kvfDescriptorWriteBatchAddWrite(batch, set, binding, array_element, type, count);
+}
+
+void kvfDescriptorWriteBatchAddTexelBuffers(KvfDescriptorWriteBatch* batch, VkDescriptorSet set, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkBufferView* views, uint32_t count)
+{
+	KVF_ASSERT(batch != NULL);
+	KVF_ASSERT(views != NULL && count != 0);
+	KVF_ASSERT((type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER) && "not a texel buffer descriptor type");
+	batch->texel_views = (VkBufferView*)__kvfReserveArray(batch->texel_views, &batch->texel_views_capacity, batch->texel_views_size + count, sizeof(VkBufferView));
+	memcpy(batch->texel_views + batch->texel_views_size, views, sizeof(VkBufferView) * count);
+	batch->texel_views_size += count;
+	__kvfDescriptorWriteBatchAddWrite(batch, set, binding, array_element, type, count);
+}
+
+size_t kvfDescriptorWriteBatchGetSize(KvfDescriptorWriteBatch* batch)
+{
+	KVF_ASSERT(batch != NULL);
+	return batch->writes_size;
+}
+
+void __kvfDescriptorWriteBatchResolveInfos(KvfDescriptorWriteBatch* batch)
+{
+	// Infos were pushed in the same order as the writes
+	size_t buffer_info = 0;
+	size_t image_info = 0;
+	size_t texel_view = 0;
+	for(size_t i = 0; i < batch->writes_size; i++)
+	{
+		VkWriteDescriptorSet* write = &batch->writes[i];
+		switch(write->descriptorType)
 		{
-			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+				write->pBufferInfo = batch->buffer_infos + buffer_info;
+				buffer_info += write->descriptorCount;
+				break;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+				write->pTexelBufferView = batch->texel_views + texel_view;
+				texel_view += write->descriptorCount;
+				break;
+			default:
+				write->pImageInfo = batch->image_infos + image_info;
+				image_info += write->descriptorCount;
+				break;
 		}
 	}
+}
 
-	attachment.samples = samples;
-	if(samples != VK_SAMPLE_COUNT_1_BIT)
-		attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	else
-		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachment.flags = 0;
+void kvfDescriptorWriteBatchFlush(KvfDescriptorWriteBatch* batch)
+{
+	KVF_ASSERT(batch != NULL);
+	if(batch->writes_size == 0)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(batch->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__kvfDescriptorWriteBatchResolveInfos(batch);
+	for(size_t i = 0; i < batch->writes_size; i++)
+		KVF_ASSERT(batch->writes[i].dstSet != VK_NULL_HANDLE && "writes without a set can only be pushed");
+	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(batch->device, (uint32_t)batch->writes_size, batch->writes, 0, NULL);
+	kvfDescriptorWriteBatchReset(batch);
+}
 
-	return attachment;
+void kvfDescriptorWriteBatchReset(KvfDescriptorWriteBatch* batch)
+{
+	KVF_ASSERT(batch != NULL);
+	batch->writes_size = 0;
+	batch->buffer_infos_size = 0;
+	batch->image_infos_size = 0;
+	batch->texel_views_size = 0;
 }
 
 #ifndef KVF_NO_KHR
-	VkAttachmentDescription kvfBuildSwapchainAttachmentDescription(VkSwapchainKHR swapchain, bool clear)
+	void kvfDescriptorWriteBatchPush(VkCommandBuffer cmd, KvfDescriptorWriteBatch* batch, VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t set)
 	{
-		__KvfSwapchain* kvf_swapchain = __kvfGetKvfSwapchainFromVkSwapchainKHR(swapchain);
-		KVF_ASSERT(kvf_swapchain != NULL);
-		KVF_ASSERT(kvf_swapchain->images_count != 0);
-		return kvfBuildAttachmentDescription(KVF_IMAGE_COLOR, kvf_swapchain->images_format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, clear, VK_SAMPLE_COUNT_1_BIT);
+		KVF_ASSERT(cmd != VK_NULL_HANDLE);
+		KVF_ASSERT(batch != NULL);
+		KVF_ASSERT(layout != VK_NULL_HANDLE);
+		if(batch->writes_size == 0)
+			return;
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(batch->device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+		#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+			PFN_vkCmdPushDescriptorSetKHR push_descriptor_set = kvf_device->fns.vkCmdPushDescriptorSetKHR;
+		#else
+			if(kvf_device->push_descriptor_set == NULL)
+				kvf_device->push_descriptor_set = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(batch->device, "vkCmdPushDescriptorSetKHR");
+			PFN_vkCmdPushDescriptorSetKHR push_descriptor_set = kvf_device->push_descriptor_set;
+		#endif
+		KVF_ASSERT(push_descriptor_set != NULL && "VK_KHR_push_descriptor is not enabled on the device");
+		__kvfDescriptorWriteBatchResolveInfos(batch);
+		push_descriptor_set(cmd, bind_point, layout, set, (uint32_t)batch->writes_size, batch->writes);
+		kvfDescriptorWriteBatchReset(batch);
 	}
 #endif
 
-VkRenderPass kvfCreateRenderPass(VkDevice device, VkAttachmentDescription* attachments, size_t attachments_count, VkPipelineBindPoint bind_point)
+void kvfFillBindlessFeatures(VkPhysicalDeviceDescriptorIndexingFeatures* features)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	return kvfCreateRenderPassWithSubpassDependencies(device, attachments, attachments_count, bind_point, NULL, 0);
+	KVF_ASSERT(features != NULL);
+	memset(features, 0, sizeof(VkPhysicalDeviceDescriptorIndexingFeatures));
+	features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	features->shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features->shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	features->descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features->descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features->descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	features->descriptorBindingPartiallyBound = VK_TRUE;
+	features->runtimeDescriptorArray = VK_TRUE;
 }
 
-VkRenderPass kvfCreateRenderPassWithSubpassDependencies(VkDevice device, VkAttachmentDescription* attachments, size_t attachments_count, VkPipelineBindPoint bind_point, VkSubpassDependency* dependencies, size_t dependencies_count)
+KvfBindlessTable* kvfCreateBindlessTable(VkDevice device, uint32_t sampled_images_capacity, uint32_t storage_buffers_capacity, uint32_t samplers_capacity, uint32_t frames_in_flight)
 {
-	size_t color_attachment_count = 0;
-	size_t depth_attachment_count = 0;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(sampled_images_capacity != 0 || storage_buffers_capacity != 0 || samplers_capacity != 0);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 
-	for(size_t i = 0; i < attachments_count; i++)
+	KvfBindlessTable* table = (KvfBindlessTable*)KVF_MALLOC(sizeof(KvfBindlessTable));
+	KVF_ASSERT(table != NULL && "allocation failed :(");
+	memset(table, 0, sizeof(KvfBindlessTable));
+	table->device = device;
+	table->frames_in_flight = frames_in_flight;
+	table->arrays[KVF_BINDLESS_SAMPLED_IMAGE].capacity = sampled_images_capacity;
+	table->arrays[KVF_BINDLESS_STORAGE_BUFFER].capacity = storage_buffers_capacity;
+	table->arrays[KVF_BINDLESS_SAMPLER].capacity = samplers_capacity;
+	for(uint32_t i = 0; i < __KVF_BINDLESS_RESOURCE_TYPE_COUNT; i++)
 	{
-		if(kvfIsDepthFormat(attachments[i].format))
-			depth_attachment_count++;
-		else
-			color_attachment_count++;
+		if(table->arrays[i].capacity == 0)
+			continue;
+		table->arrays[i].states = (uint8_t*)KVF_MALLOC(table->arrays[i].capacity);
+		KVF_ASSERT(table->arrays[i].states != NULL && "allocation failed :(");
+		memset(table->arrays[i].states, __KVF_BINDLESS_INDEX_FREE, table->arrays[i].capacity);
 	}
 
-	VkAttachmentReference* color_references = NULL;
-	VkAttachmentReference* depth_references = NULL;
+	const VkDescriptorType types[__KVF_BINDLESS_RESOURCE_TYPE_COUNT] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_SAMPLER };
+	VkDescriptorSetLayoutBinding bindings[__KVF_BINDLESS_RESOURCE_TYPE_COUNT];
+	VkDescriptorBindingFlags binding_flags[__KVF_BINDLESS_RESOURCE_TYPE_COUNT];
+	VkDescriptorPoolSize pool_sizes[__KVF_BINDLESS_RESOURCE_TYPE_COUNT];
+	uint32_t pool_sizes_count = 0;
+	for(uint32_t i = 0; i < __KVF_BINDLESS_RESOURCE_TYPE_COUNT; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = types[i];
+		bindings[i].descriptorCount = table->arrays[i].capacity;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+		bindings[i].pImmutableSamplers = NULL;
+		// Slots that are not registered are never written, slots that are released may still be read by pending frames
+		binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+		if(table->arrays[i].capacity == 0)
+			continue;
+		pool_sizes[pool_sizes_count].type = types[i];
+		pool_sizes[pool_sizes_count].descriptorCount = table->arrays[i].capacity;
+		pool_sizes_count++;
+	}
 
-	if(color_attachment_count != 0)
+	VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {};
+	binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	binding_flags_info.bindingCount = __KVF_BINDLESS_RESOURCE_TYPE_COUNT;
+	binding_flags_info.pBindingFlags = binding_flags;
+
+	VkDescriptorSetLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layout_info.pNext = &binding_flags_info;
+	layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layout_info.bindingCount = __KVF_BINDLESS_RESOURCE_TYPE_COUNT;
+	layout_info.pBindings = bindings;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorSetLayout)(device, &layout_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &table->layout));
+
+	VkDescriptorPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	pool_info.maxSets = 1;
+	pool_info.poolSizeCount = pool_sizes_count;
+	pool_info.pPoolSizes = pool_sizes;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorPool)(device, &pool_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_POOL), &table->pool));
+
+	VkDescriptorSetAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_info.descriptorPool = table->pool;
+	alloc_info.descriptorSetCount = 1;
+	alloc_info.pSetLayouts = &table->layout;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateDescriptorSets)(device, &alloc_info, &table->set));
+
+	table->writes = kvfCreateDescriptorWriteBatch(device);
+	return table;
+}
+
+void kvfDestroyBindlessTable(KvfBindlessTable* table)
+{
+	if(table == NULL)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(table->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	kvfDestroyDescriptorWriteBatch(table->writes);
+	KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorPool)(table->device, table->pool, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+	KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorSetLayout)(table->device, table->layout, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+	for(uint32_t i = 0; i < __KVF_BINDLESS_RESOURCE_TYPE_COUNT; i++)
 	{
-		color_references = (VkAttachmentReference*)KVF_MALLOC(color_attachment_count * sizeof(VkAttachmentReference));
-		KVF_ASSERT(color_references != NULL && "allocation failed :(");
+		KVF_FREE(table->arrays[i].free_indices);
+		KVF_FREE(table->arrays[i].releases);
+		KVF_FREE(table->arrays[i].states);
 	}
-	if(depth_attachment_count != 0)
+	KVF_FREE(table);
+}
+
+uint32_t __kvfBindlessTableAcquireIndex(KvfBindlessTable* table, KvfBindlessResourceType type)
+{
+	__KvfBindlessArray* array = &table->arrays[type];
+	uint32_t index;
+	if(array->free_indices_size != 0)
+		index = array->free_indices[--array->free_indices_size];
+	else
 	{
-		depth_references = (VkAttachmentReference*)KVF_MALLOC(depth_attachment_count * sizeof(VkAttachmentReference));
-		KVF_ASSERT(depth_references != NULL && "allocation failed :(");
+		KVF_ASSERT(array->next_index < array->capacity && "bindless table is full");
+		if(array->next_index >= array->capacity)
+			return UINT32_MAX;
+		index = array->next_index++;
 	}
+	KVF_ASSERT(array->states[index] == __KVF_BINDLESS_INDEX_FREE && "bindless index handed out twice");
+	array->states[index] = __KVF_BINDLESS_INDEX_LIVE;
+	return index;
+}
 
-	for(size_t i = 0, c = 0, d = 0; i < attachments_count; i++)
+uint32_t kvfBindlessTableRegisterSampledImage(KvfBindlessTable* table, VkImageView view, VkImageLayout layout)
+{
+	KVF_ASSERT(table != NULL);
+	KVF_ASSERT(view != VK_NULL_HANDLE);
+	uint32_t index = __kvfBindlessTableAcquireIndex(table, KVF_BINDLESS_SAMPLED_IMAGE);
+	if(index == UINT32_MAX)
+		return index;
+	VkDescriptorImageInfo info = {};
+	info.imageView = view;
+	info.imageLayout = layout;
+	kvfDescriptorWriteBatchAddImages(table->writes, table->set, KVF_BINDLESS_SAMPLED_IMAGE, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &info, 1);
+	return index;
+}
+
+uint32_t kvfBindlessTableRegisterStorageBuffer(KvfBindlessTable* table, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	KVF_ASSERT(table != NULL);
+	KVF_ASSERT(buffer != VK_NULL_HANDLE);
+	uint32_t index = __kvfBindlessTableAcquireIndex(table, KVF_BINDLESS_STORAGE_BUFFER);
+	if(index == UINT32_MAX)
+		return index;
+	VkDescriptorBufferInfo info = {};
+	info.buffer = buffer;
+	info.offset = offset;
+	info.range = range;
+	kvfDescriptorWriteBatchAddBuffers(table->writes, table->set, KVF_BINDLESS_STORAGE_BUFFER, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &info, 1);
+	return index;
+}
+
+uint32_t kvfBindlessTableRegisterSampler(KvfBindlessTable* table, VkSampler sampler)
+{
+	KVF_ASSERT(table != NULL);
+	KVF_ASSERT(sampler != VK_NULL_HANDLE);
+	uint32_t index = __kvfBindlessTableAcquireIndex(table, KVF_BINDLESS_SAMPLER);
+	if(index == UINT32_MAX)
+		return index;
+	VkDescriptorImageInfo info = {};
+	info.sampler = sampler;
+	kvfDescriptorWriteBatchAddImages(table->writes, table->set, KVF_BINDLESS_SAMPLER, index, VK_DESCRIPTOR_TYPE_SAMPLER, &info, 1);
+	return index;
+}
+
+void kvfBindlessTableRelease(KvfBindlessTable* table, KvfBindlessResourceType type, uint32_t index)
+{
+	KVF_ASSERT(table != NULL);
+	KVF_ASSERT((uint32_t)type < __KVF_BINDLESS_RESOURCE_TYPE_COUNT && "invalid bindless resource type");
+	__KvfBindlessArray* array = &table->arrays[type];
+	KVF_ASSERT(index < array->next_index && "index was never registered");
+	KVF_ASSERT(array->states[index] == __KVF_BINDLESS_INDEX_LIVE && "index has already been released");
+	// Queuing it twice would later give the same slot to two resources
+	if(index >= array->next_index || array->states[index] != __KVF_BINDLESS_INDEX_LIVE)
+		return;
+	array->states[index] = __KVF_BINDLESS_INDEX_PENDING;
+	array->releases = (__KvfBindlessRelease*)__kvfReserveArray(array->releases, &array->releases_capacity, array->releases_size + 1, sizeof(__KvfBindlessRelease));
+	array->releases[array->releases_size].frame = table->frame;
+	array->releases[array->releases_size].index = index;
+	array->releases_size++;
+}
+
+void kvfBindlessTableFlush(KvfBindlessTable* table)
+{
+	KVF_ASSERT(table != NULL);
+	kvfDescriptorWriteBatchFlush(table->writes);
+}
+
+void kvfBindlessTableNextFrame(KvfBindlessTable* table)
+{
+	KVF_ASSERT(table != NULL);
+	kvfDescriptorWriteBatchFlush(table->writes);
+	table->frame++;
+	for(uint32_t i = 0; i < __KVF_BINDLESS_RESOURCE_TYPE_COUNT; i++)
 	{
-		if(!kvfIsDepthFormat(attachments[i].format))
-		{
-			VkImageLayout layout = attachments[i].finalLayout;
-			color_references[c].attachment = i;
-			color_references[c].layout = layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : layout;
-			c++;
-		}
-		else
+		__KvfBindlessArray* array = &table->arrays[i];
+		// Releases are ordered by frame, the ones old enough are all at the front
+		size_t recycled = 0;
+		while(recycled < array->releases_size && array->releases[recycled].frame + table->frames_in_flight < table->frame)
+			recycled++;
+		if(recycled == 0)
+			continue;
+		array->free_indices = (uint32_t*)__kvfReserveArray(array->free_indices, &array->free_indices_capacity, array->free_indices_size + recycled, sizeof(uint32_t));
+		for(size_t j = 0; j < recycled; j++)
 		{
-			depth_references[d].attachment = i;
-			depth_references[d].layout = attachments[i].finalLayout;
-			d++;
+			array->states[array->releases[j].index] = __KVF_BINDLESS_INDEX_FREE;
+			array->free_indices[array->free_indices_size++] = array->releases[j].index;
 		}
+		array->releases_size -= recycled;
+		memmove(array->releases, array->releases + recycled, array->releases_size * sizeof(__KvfBindlessRelease));
 	}
+}
+
+VkDescriptorSetLayout kvfBindlessTableGetLayout(KvfBindlessTable* table)
+{
+	KVF_ASSERT(table != NULL);
+	return table->layout;
+}
+
+VkDescriptorSet kvfBindlessTableGetSet(KvfBindlessTable* table)
+{
+	KVF_ASSERT(table != NULL);
+	return table->set;
+}
+
+uint32_t kvfBindlessTableGetUsedCount(KvfBindlessTable* table, KvfBindlessResourceType type)
+{
+	KVF_ASSERT(table != NULL);
+	KVF_ASSERT((uint32_t)type < __KVF_BINDLESS_RESOURCE_TYPE_COUNT && "invalid bindless resource type");
+	return table->arrays[type].next_index - (uint32_t)table->arrays[type].free_indices_size;
+}
 
+void kvfFillDescriptorBufferFeatures(VkPhysicalDeviceDescriptorBufferFeaturesEXT* descriptor_buffer, VkPhysicalDeviceBufferDeviceAddressFeatures* device_address)
+{
+	KVF_ASSERT(descriptor_buffer != NULL);
+	KVF_ASSERT(device_address != NULL);
+	memset(descriptor_buffer, 0, sizeof(VkPhysicalDeviceDescriptorBufferFeaturesEXT));
+	memset(device_address, 0, sizeof(VkPhysicalDeviceBufferDeviceAddressFeatures));
+	descriptor_buffer->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+	descriptor_buffer->pNext = device_address;
+	descriptor_buffer->descriptorBuffer = VK_TRUE;
+	device_address->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+	device_address->bufferDeviceAddress = VK_TRUE;
+}
+
+KvfDescriptorBuffer* kvfCreateDescriptorBuffer(VkDevice device, VkDeviceSize size)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(size > 0);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	const __KvfDescriptorBufferFunctions* fns = __kvfGetDescriptorBufferFunctions(kvf_device);
+
+	KvfDescriptorBuffer* descriptor_buffer = (KvfDescriptorBuffer*)KVF_MALLOC(sizeof(KvfDescriptorBuffer));
+	KVF_ASSERT(descriptor_buffer != NULL && "allocation failed :(");
+	memset(descriptor_buffer, 0, sizeof(KvfDescriptorBuffer));
+	descriptor_buffer->device = device;
+	descriptor_buffer->size = size;
+
+	descriptor_buffer->properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &descriptor_buffer->properties;
+	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceProperties2)(kvf_device->physical, &properties);
+	descriptor_buffer->properties.pNext = NULL;
+
+	// Samplers and resources share the buffer
+	descriptor_buffer->buffer = kvfCreateBuffer(device, VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, size);
+	VkMemoryRequirements requirements;
+	KVF_GET_DEVICE_FUNCTION(vkGetBufferMemoryRequirements)(device, descriptor_buffer->buffer, &requirements);
+	int32_t memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if(memory_type == -1)
+		memory_type = kvfFindMemoryType(kvf_device->physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	KVF_ASSERT(memory_type != -1 && "could not find a host visible and coherent memory type for descriptors");
+
+	VkMemoryAllocateFlagsInfo flags_info = {};
+	flags_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	flags_info.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.pNext = &flags_info;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateMemory)(device, &alloc_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY), &descriptor_buffer->memory));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkBindBufferMemory)(device, descriptor_buffer->buffer, descriptor_buffer->memory, 0));
+	void* mapped = NULL;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkMapMemory)(device, descriptor_buffer->memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+	descriptor_buffer->mapped = (uint8_t*)mapped;
+
+	VkBufferDeviceAddressInfo address_info = {};
+	address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	address_info.buffer = descriptor_buffer->buffer;
+	descriptor_buffer->address = fns->vkGetBufferDeviceAddress(device, &address_info);
+	return descriptor_buffer;
+}
 
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = bind_point;
-	subpass.colorAttachmentCount = color_attachment_count;
-	subpass.pColorAttachments = color_references;
-	subpass.pDepthStencilAttachment = depth_references;
+void kvfDestroyDescriptorBuffer(KvfDescriptorBuffer* descriptor_buffer)
+{
+	if(descriptor_buffer == NULL)
+		return;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(descriptor_buffer->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_GET_DEVICE_FUNCTION(vkUnmapMemory)(descriptor_buffer->device, descriptor_buffer->memory);
+	kvfDestroyBuffer(descriptor_buffer->device, descriptor_buffer->buffer);
+	KVF_GET_DEVICE_FUNCTION(vkFreeMemory)(descriptor_buffer->device, descriptor_buffer->memory, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DEVICE_MEMORY));
+	KVF_FREE(descriptor_buffer);
+}
 
-	VkRenderPassCreateInfo renderpass_create_info = {};
-	renderpass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderpass_create_info.attachmentCount = attachments_count;
-	renderpass_create_info.pAttachments = attachments;
-	renderpass_create_info.subpassCount = 1;
-	renderpass_create_info.pSubpasses = &subpass;
-	renderpass_create_info.dependencyCount = dependencies_count;
-	renderpass_create_info.pDependencies = dependencies;
+__KvfDescriptorSetLayoutInfo* __kvfGetDescriptorBufferLayoutInfo(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout, __KvfDevice** kvf_device)
+{
+	*kvf_device = __kvfGetKvfDeviceFromVkDevice(descriptor_buffer->device);
+	KVF_ASSERT(*kvf_device != NULL && "could not find VkDevice in registered devices");
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(*kvf_device, layout);
+	KVF_ASSERT(info != NULL && "layout was not created with kvfCreateDescriptorSetLayoutWithFlags");
+	KVF_ASSERT((info->flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT) && "layout was not created for descriptor buffers");
+	return info;
+}
 
-	VkRenderPass render_pass = VK_NULL_HANDLE;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateRenderPass)(device, &renderpass_create_info, kvf_device->callbacks, &render_pass));
-	KVF_FREE(color_references);
-	KVF_FREE(depth_references);
-	return render_pass;
+VkDeviceSize kvfDescriptorBufferAllocate(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout)
+{
+	KVF_ASSERT(descriptor_buffer != NULL);
+	__KvfDevice* kvf_device;
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorBufferLayoutInfo(descriptor_buffer, layout, &kvf_device);
+	VkDeviceSize alignment = descriptor_buffer->properties.descriptorBufferOffsetAlignment;
+	VkDeviceSize offset = (alignment > 1 ? (descriptor_buffer->used + alignment - 1) / alignment * alignment : descriptor_buffer->used);
+	KVF_ASSERT(offset + info->descriptor_buffer_size <= descriptor_buffer->size && "descriptor buffer is full");
+	descriptor_buffer->used = offset + info->descriptor_buffer_size;
+	return offset;
+}
+
+size_t __kvfDescriptorBufferDescriptorSize(const VkPhysicalDeviceDescriptorBufferPropertiesEXT* properties, VkDescriptorType type)
+{
+	switch(type)
+	{
+		case VK_DESCRIPTOR_TYPE_SAMPLER: return properties->samplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return properties->combinedImageSamplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return properties->sampledImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return properties->storageImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: return properties->uniformTexelBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: return properties->storageTexelBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return properties->uniformBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return properties->storageBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: return properties->inputAttachmentDescriptorSize;
+
+		default: return 0;
+	}
+}
+
+void __kvfDescriptorBufferWrite(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout, VkDeviceSize set_offset, uint32_t binding, uint32_t array_element, const VkDescriptorGetInfoEXT* get_info)
+{
+	__KvfDevice* kvf_device;
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorBufferLayoutInfo(descriptor_buffer, layout, &kvf_device);
+	KVF_ASSERT(binding < info->binding_offsets_count && info->binding_offsets[binding] != __KVF_NO_BINDING_OFFSET && "invalid binding");
+	size_t size = __kvfDescriptorBufferDescriptorSize(&descriptor_buffer->properties, get_info->type);
+	KVF_ASSERT(size != 0 && "unsupported descriptor type");
+	VkDeviceSize offset = set_offset + info->binding_offsets[binding] + (VkDeviceSize)array_element * size;
+	KVF_ASSERT(offset + size <= descriptor_buffer->size && "descriptor is out of the buffer");
+	__kvfGetDescriptorBufferFunctions(kvf_device)->vkGetDescriptorEXT(descriptor_buffer->device, get_info, size, descriptor_buffer->mapped + offset);
+}
+
+void kvfDescriptorBufferWriteBuffer(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout, VkDeviceSize set_offset, uint32_t binding, uint32_t array_element, VkDescriptorType type, VkDeviceAddress address, VkDeviceSize range)
+{
+	KVF_ASSERT(descriptor_buffer != NULL);
+	KVF_ASSERT((type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) && "not a buffer descriptor type");
+	KVF_ASSERT(range != VK_WHOLE_SIZE && "descriptor buffers need an explicit range");
+	VkDescriptorAddressInfoEXT address_info = {};
+	address_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+	address_info.address = address;
+	address_info.range = range;
+	address_info.format = VK_FORMAT_UNDEFINED;
+	VkDescriptorGetInfoEXT get_info = {};
+	get_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+	get_info.type = type;
+	if(type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+		get_info.data.pUniformBuffer = &address_info;
+	else
+		get_info.data.pStorageBuffer = &address_info;
+	__kvfDescriptorBufferWrite(descriptor_buffer, layout, set_offset, binding, array_element, &get_info);
+}
+
+void kvfDescriptorBufferWriteImage(KvfDescriptorBuffer* descriptor_buffer, VkDescriptorSetLayout layout, VkDeviceSize set_offset, uint32_t binding, uint32_t array_element, VkDescriptorType type, const VkDescriptorImageInfo* info)
+{
+	KVF_ASSERT(descriptor_buffer != NULL);
+	KVF_ASSERT(info != NULL);
+	VkDescriptorGetInfoEXT get_info = {};
+	get_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+	get_info.type = type;
+	switch(type)
+	{
+		case VK_DESCRIPTOR_TYPE_SAMPLER: get_info.data.pSampler = &info->sampler; break;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: get_info.data.pCombinedImageSampler = info; break;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: get_info.data.pSampledImage = info; break;
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: get_info.data.pStorageImage = info; break;
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: get_info.data.pInputAttachmentImage = info; break;
+
+		default: KVF_ASSERT(false && "not an image descriptor type"); return;
+	}
+	__kvfDescriptorBufferWrite(descriptor_buffer, layout, set_offset, binding, array_element, &get_info);
+}
+
+void kvfDescriptorBufferReset(KvfDescriptorBuffer* descriptor_buffer)
+{
+	KVF_ASSERT(descriptor_buffer != NULL);
+	descriptor_buffer->used = 0;
+}
+
+VkDeviceSize kvfDescriptorBufferGetUsedSize(KvfDescriptorBuffer* descriptor_buffer)
+{
+	KVF_ASSERT(descriptor_buffer != NULL);
+	return descriptor_buffer->used;
+}
+
+void kvfDescriptorBufferBind(VkCommandBuffer cmd, KvfDescriptorBuffer* descriptor_buffer)
+{
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(descriptor_buffer != NULL);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(descriptor_buffer->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	VkDescriptorBufferBindingInfoEXT binding_info = {};
+	binding_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+	binding_info.address = descriptor_buffer->address;
+	binding_info.usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	__kvfGetDescriptorBufferFunctions(kvf_device)->vkCmdBindDescriptorBuffersEXT(cmd, 1, &binding_info);
+}
+
+void kvfDescriptorBufferBindSet(VkCommandBuffer cmd, KvfDescriptorBuffer* descriptor_buffer, VkPipelineBindPoint bind_point, VkPipelineLayout layout, uint32_t set, VkDeviceSize set_offset)
+{
+	KVF_ASSERT(cmd != VK_NULL_HANDLE);
+	KVF_ASSERT(descriptor_buffer != NULL);
+	KVF_ASSERT(layout != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(descriptor_buffer->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	uint32_t buffer_index = 0;
+	__kvfGetDescriptorBufferFunctions(kvf_device)->vkCmdSetDescriptorBufferOffsetsEXT(cmd, bind_point, layout, set, 1, &buffer_index, &set_offset);
+}
+
+VkPipelineLayout kvfCreatePipelineLayout(VkDevice device, VkDescriptorSetLayout* set_layouts, size_t set_layouts_count, VkPushConstantRange* pc, size_t pc_count)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_info.setLayoutCount = set_layouts_count;
+	pipeline_layout_info.pSetLayouts = set_layouts;
+	pipeline_layout_info.pushConstantRangeCount = pc_count;
+	pipeline_layout_info.pPushConstantRanges = pc;
+
+	VkPipelineLayout layout;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreatePipelineLayout)(device, &pipeline_layout_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE_LAYOUT), &layout));
+	return layout;
 }
 
-void kvfDestroyRenderPass(VkDevice device, VkRenderPass renderPass)
+void kvfDestroyPipelineLayout(VkDevice device, VkPipelineLayout layout)
 {
-	if(renderPass == VK_NULL_HANDLE)
+	if(layout == VK_NULL_HANDLE)
 		return;
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyRenderPass)(device, renderPass, kvf_device->callbacks);
+	KVF_ASSERT(__kvfLayoutCacheIndexOf(&kvf_device->pipeline_layouts_cache, (uint64_t)layout) == SIZE_MAX && "cached pipeline layouts must be released, not destroyed");
+	KVF_GET_DEVICE_FUNCTION(vkDestroyPipelineLayout)(device, layout, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE_LAYOUT));
 }
 
-void kvfBeginRenderPass(VkRenderPass pass, VkCommandBuffer cmd, VkFramebuffer framebuffer, VkExtent2D framebuffer_extent, VkClearValue* clears, size_t clears_count)
+VkDescriptorSetLayout kvfAcquireDescriptorSetLayout(VkDevice device, const VkDescriptorSetLayoutBinding* bindings, size_t bindings_count, VkDescriptorSetLayoutCreateFlags flags)
 {
-	KVF_ASSERT(pass != VK_NULL_HANDLE);
-	KVF_ASSERT(framebuffer != VK_NULL_HANDLE);
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkCommandBuffer(cmd);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(bindings != NULL || bindings_count == 0);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 
-	VkOffset2D offset = { 0, 0 };
-	VkRenderPassBeginInfo renderpass_info = {};
-	renderpass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderpass_info.renderPass = pass;
-	renderpass_info.framebuffer = framebuffer;
-	renderpass_info.renderArea.offset = offset;
-	renderpass_info.renderArea.extent = framebuffer_extent;
-	renderpass_info.clearValueCount = clears_count;
-	renderpass_info.pClearValues = clears;
-	KVF_GET_DEVICE_FUNCTION(vkCmdBeginRenderPass)(cmd, &renderpass_info, VK_SUBPASS_CONTENTS_INLINE);
+	// Flags and bindings count, then per binding its fields, an immutable samplers flag and the samplers
+	size_t key_size = 2;
+	for(size_t i = 0; i < bindings_count; i++)
+		key_size += 5 + (bindings[i].pImmutableSamplers != NULL ? bindings[i].descriptorCount : 0);
+	__KvfScratchMarker marker = __kvfScratchMark();
+	uint64_t* key = (uint64_t*)__kvfScratchPush(key_size * sizeof(uint64_t));
+	size_t word = 0;
+	key[word++] = flags;
+	key[word++] = bindings_count;
+	for(size_t i = 0; i < bindings_count; i++)
+	{
+		key[word++] = bindings[i].binding;
+		key[word++] = bindings[i].descriptorType;
+		key[word++] = bindings[i].descriptorCount;
+		key[word++] = bindings[i].stageFlags;
+		key[word++] = (bindings[i].pImmutableSamplers != NULL);
+		if(bindings[i].pImmutableSamplers == NULL)
+			continue;
+		for(uint32_t j = 0; j < bindings[i].descriptorCount; j++)
+			key[word++] = (uint64_t)bindings[i].pImmutableSamplers[j];
+	}
+
+	__KvfLayoutCacheEntry* entry = __kvfLayoutCacheAcquire(&kvf_device->set_layouts_cache, key, key_size);
+	__kvfScratchRewind(marker);
+	if(entry->layout == 0)
+		__kvfLayoutCacheSetLayout(&kvf_device->set_layouts_cache, entry, (uint64_t)kvfCreateDescriptorSetLayoutWithFlags(device, (VkDescriptorSetLayoutBinding*)bindings, bindings_count, flags));
+	return (VkDescriptorSetLayout)entry->layout;
 }
 
-VkShaderModule kvfCreateShaderModule(VkDevice device, uint32_t* code, size_t size)
+// Returns false if the layout is not in the cache
+bool __kvfReleaseCachedDescriptorSetLayout(__KvfDevice* kvf_device, VkDescriptorSetLayout layout)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = size * sizeof(uint32_t);
-	createInfo.pCode = code;
-	VkShaderModule shader = VK_NULL_HANDLE;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateShaderModule)(device, &createInfo, kvf_device->callbacks, &shader));
-	return shader;
+	__KvfLayoutCache* cache = &kvf_device->set_layouts_cache;
+	size_t index = __kvfLayoutCacheIndexOf(cache, (uint64_t)layout);
+	if(index == SIZE_MAX)
+		return false;
+	if(--cache->entries[index].references > 0)
+		return true;
+	__kvfDestroyDescriptorSetLayout(kvf_device, layout);
+	__kvfLayoutCacheRemoveAt(cache, index);
+	return true;
 }
 
-void kvfDestroyShaderModule(VkDevice device, VkShaderModule shader)
+void kvfReleaseDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout layout)
 {
-	if(shader == VK_NULL_HANDLE)
+	if(layout == VK_NULL_HANDLE)
 		return;
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyShaderModule)(device, shader, kvf_device->callbacks);
+	bool released = __kvfReleaseCachedDescriptorSetLayout(kvf_device, layout);
+	KVF_ASSERT(released && "descriptor set layout was not acquired from the cache");
+	(void)released;
 }
 
-VkDescriptorSetLayout kvfCreateDescriptorSetLayout(VkDevice device, VkDescriptorSetLayoutBinding* bindings, size_t bindings_count)
+VkPipelineLayout kvfAcquirePipelineLayout(VkDevice device, const VkDescriptorSetLayout* set_layouts, size_t set_layouts_count, const VkPushConstantRange* pc, size_t pc_count)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(set_layouts != NULL || set_layouts_count == 0);
+	KVF_ASSERT(pc != NULL || pc_count == 0);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkDescriptorSetLayoutCreateInfo layout_info = {};
-	layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layout_info.bindingCount = bindings_count;
-	layout_info.pBindings = bindings;
+	__KvfLayoutCache* set_layouts_cache = &kvf_device->set_layouts_cache;
+	for(size_t i = 0; i < set_layouts_count; i++)
+		KVF_ASSERT(__kvfLayoutCacheIndexOf(set_layouts_cache, (uint64_t)set_layouts[i]) != SIZE_MAX && "descriptor set layout was not acquired from the cache");
+
+	// Set layouts count and handles, then push constant ranges count and ranges
+	size_t key_size = 2 + set_layouts_count + pc_count * 3;
+	__KvfScratchMarker marker = __kvfScratchMark();
+	uint64_t* key = (uint64_t*)__kvfScratchPush(key_size * sizeof(uint64_t));
+	size_t word = 0;
+	key[word++] = set_layouts_count;
+	for(size_t i = 0; i < set_layouts_count; i++)
+		key[word++] = (uint64_t)set_layouts[i];
+	key[word++] = pc_count;
+	for(size_t i = 0; i < pc_count; i++)
+	{
+		key[word++] = pc[i].stageFlags;
+		key[word++] = pc[i].offset;
+		key[word++] = pc[i].size;
+	}
 
-	VkDescriptorSetLayout layout;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateDescriptorSetLayout)(device, &layout_info, kvf_device->callbacks, &layout));
-	return layout;
+	__KvfLayoutCacheEntry* entry = __kvfLayoutCacheAcquire(&kvf_device->pipeline_layouts_cache, key, key_size);
+	__kvfScratchRewind(marker);
+	if(entry->layout != 0)
+		return (VkPipelineLayout)entry->layout;
+	__kvfLayoutCacheSetLayout(&kvf_device->pipeline_layouts_cache, entry, (uint64_t)kvfCreatePipelineLayout(device, (VkDescriptorSetLayout*)set_layouts, set_layouts_count, (VkPushConstantRange*)pc, pc_count));
+	// Set layouts must outlive the pipeline layout so that their handles in the key cannot be reused
+	for(size_t i = 0; i < set_layouts_count; i++)
+	{
+		size_t index = __kvfLayoutCacheIndexOf(set_layouts_cache, (uint64_t)set_layouts[i]);
+		if(index != SIZE_MAX)
+			set_layouts_cache->entries[index].references++;
+	}
+	return (VkPipelineLayout)entry->layout;
 }
 
-void kvfDestroyDescriptorSetLayout(VkDevice device, VkDescriptorSetLayout layout)
+void kvfReleasePipelineLayout(VkDevice device, VkPipelineLayout layout)
 {
 	if(layout == VK_NULL_HANDLE)
 		return;
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorSetLayout)(device, layout, kvf_device->callbacks);
+	__KvfLayoutCache* cache = &kvf_device->pipeline_layouts_cache;
+	size_t index = __kvfLayoutCacheIndexOf(cache, (uint64_t)layout);
+	KVF_ASSERT(index != SIZE_MAX && "pipeline layout was not acquired from the cache");
+	if(index == SIZE_MAX || --cache->entries[index].references > 0)
+		return;
+	KVF_GET_DEVICE_FUNCTION(vkDestroyPipelineLayout)(device, layout, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+
+	// The key is freed with the entry, the set layouts references are dropped before
+	const uint64_t* key = cache->entries[index].key;
+	for(uint64_t i = 0; i < key[0]; i++)
+		__kvfReleaseCachedDescriptorSetLayout(kvf_device, (VkDescriptorSetLayout)key[1 + i]);
+	__kvfLayoutCacheRemoveAt(cache, index);
 }
 
-VkDescriptorSet kvfAllocateDescriptorSet(VkDevice device, VkDescriptorSetLayout layout)
+size_t kvfGetCachedDescriptorSetLayoutsCount(VkDevice device)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkDescriptorPool pool = VK_NULL_HANDLE;
-	for(uint32_t i = 0; i < kvf_device->sets_pools_size; i++)
-	{
-		if(kvf_device->sets_pools[i].size < kvf_device->sets_pools[i].capacity)
-			pool = kvf_device->sets_pools[i].pool;
-	}
-	if(pool == VK_NULL_HANDLE)
-		pool = __kvfDeviceCreateDescriptorPool(device);
-	KVF_ASSERT(pool != VK_NULL_HANDLE);
-
-	VkDescriptorSet set = VK_NULL_HANDLE;
-	VkDescriptorSetAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	alloc_info.descriptorPool = pool;
-	alloc_info.descriptorSetCount = 1;
-	alloc_info.pSetLayouts = &layout;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkAllocateDescriptorSets)(device, &alloc_info, &set));
-	KVF_ASSERT(set != VK_NULL_HANDLE);
-	return set;
+	return kvf_device->set_layouts_cache.size;
 }
 
-void kvfUpdateStorageBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+size_t kvfGetCachedPipelineLayoutsCount(VkDevice device)
 {
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkWriteDescriptorSet write = kvfWriteStorageBufferToDescriptorSet(device, set, info, binding);
-	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, 1, &write, 0, NULL);
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	return kvf_device->pipeline_layouts_cache.size;
 }
 
-void kvfUpdateUniformBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+void kvfResetDeviceDescriptorPools(VkDevice device)
 {
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkWriteDescriptorSet write = kvfWriteUniformBufferToDescriptorSet(device, set, info, binding);
-	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, 1, &write, 0, NULL);
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	__kvfClearDescriptorSetCache(kvf_device);
+	for(uint32_t i = 0; i < kvf_device->sets_pools_size; i++)
+	{
+		KVF_GET_DEVICE_FUNCTION(vkResetDescriptorPool)(device, kvf_device->sets_pools[i].pool, 0);
+		kvf_device->sets_pools[i].size = 0;
+		kvf_device->sets_pools[i].full = false;
+		memset(kvf_device->sets_pools[i].descriptors_size, 0, sizeof(kvf_device->sets_pools[i].descriptors_size));
+	}
 }
 
-void kvfUpdateImageToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorImageInfo* info, uint32_t binding)
+void kvfSetDescriptorPoolRatios(VkDevice device, const KvfDescriptorPoolRatio* ratios, size_t ratios_count)
 {
-	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
-		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
-		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	#endif
-	VkWriteDescriptorSet write = kvfWriteImageToDescriptorSet(device, set, info, binding);
-	KVF_GET_DEVICE_FUNCTION(vkUpdateDescriptorSets)(device, 1, &write, 0, NULL);
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	if(ratios == NULL)
+	{
+		for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+			kvf_device->descriptor_ratios[i] = 1.0f;
+		return;
+	}
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+		kvf_device->descriptor_ratios[i] = 0.0f;
+	for(size_t i = 0; i < ratios_count; i++)
+	{
+		KVF_ASSERT((uint32_t)ratios[i].type < __KVF_DESCRIPTOR_TYPE_COUNT && "only core descriptor types are supported");
+		KVF_ASSERT(ratios[i].ratio >= 0.0f);
+		kvf_device->descriptor_ratios[ratios[i].type] = ratios[i].ratio;
+	}
 }
 
-VkWriteDescriptorSet kvfWriteStorageBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+void kvfSetDescriptorPoolRatiosFromLayouts(VkDevice device, const VkDescriptorSetLayout* layouts, size_t layouts_count)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(set != VK_NULL_HANDLE);
-	VkWriteDescriptorSet descriptor_write = {};
-	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptor_write.dstSet = set;
-	descriptor_write.dstBinding = binding;
-	descriptor_write.dstArrayElement = 0;
-	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptor_write.descriptorCount = 1;
-	descriptor_write.pBufferInfo = info;
-	descriptor_write.pNext = NULL;
-	return descriptor_write;
+	KVF_ASSERT(layouts != NULL && layouts_count != 0);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	uint32_t totals[__KVF_DESCRIPTOR_TYPE_COUNT] = { 0 };
+	size_t pooled_layouts_count = 0;
+	for(size_t i = 0; i < layouts_count; i++)
+	{
+		__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layouts[i]);
+		KVF_ASSERT(info != NULL && "layout was not created with kvfCreateDescriptorSetLayout");
+		// Push descriptor and descriptor buffer layouts never take anything from the pools
+		if(info->flags & __KVF_SETLESS_LAYOUT_FLAGS)
+			continue;
+		for(uint32_t j = 0; j < __KVF_DESCRIPTOR_TYPE_COUNT; j++)
+			totals[j] += info->counts[j];
+		pooled_layouts_count++;
+	}
+	if(pooled_layouts_count == 0)
+		return;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+		kvf_device->descriptor_ratios[i] = (float)totals[i] / (float)pooled_layouts_count;
 }
 
-VkWriteDescriptorSet kvfWriteUniformBufferToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorBufferInfo* info, uint32_t binding)
+void __kvfAccumulateDescriptorPoolStats(KvfDescriptorPoolStats* stats, const __KvfDescriptorPool* pool)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(set != VK_NULL_HANDLE);
-	VkWriteDescriptorSet descriptor_write = {};
-	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptor_write.dstSet = set;
-	descriptor_write.dstBinding = binding;
-	descriptor_write.dstArrayElement = 0;
-	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptor_write.descriptorCount = 1;
-	descriptor_write.pBufferInfo = info;
-	descriptor_write.pNext = NULL;
-	return descriptor_write;
+	stats->sets_allocated += pool->size;
+	stats->sets_capacity += pool->capacity;
+	for(uint32_t i = 0; i < __KVF_DESCRIPTOR_TYPE_COUNT; i++)
+	{
+		stats->descriptors_allocated += pool->descriptors_size[i];
+		stats->descriptors_capacity += pool->descriptors_capacity[i];
+	}
 }
 
-VkWriteDescriptorSet kvfWriteImageToDescriptorSet(VkDevice device, VkDescriptorSet set, const VkDescriptorImageInfo* info, uint32_t binding)
+KvfDescriptorPoolStats kvfGetDescriptorPoolStats(VkDevice device)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
-	KVF_ASSERT(set != VK_NULL_HANDLE);
-	VkWriteDescriptorSet descriptor_write = {};
-	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptor_write.dstSet = set;
-	descriptor_write.dstBinding = binding;
-	descriptor_write.dstArrayElement = 0;
-	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptor_write.descriptorCount = 1;
-	descriptor_write.pImageInfo = info;
-	descriptor_write.pNext = NULL;
-	return descriptor_write;
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KvfDescriptorPoolStats stats;
+	memset(&stats, 0, sizeof(KvfDescriptorPoolStats));
+	stats.pools_count = kvf_device->sets_pools_size;
+	stats.failed_allocations = kvf_device->sets_pools_failed_allocations;
+	for(size_t i = 0; i < kvf_device->sets_pools_size; i++)
+		__kvfAccumulateDescriptorPoolStats(&stats, &kvf_device->sets_pools[i]);
+	return stats;
 }
 
-VkPipelineLayout kvfCreatePipelineLayout(VkDevice device, VkDescriptorSetLayout* set_layouts, size_t set_layouts_count, VkPushConstantRange* pc, size_t pc_count)
+KvfDescriptorPoolStats kvfGetDescriptorPoolStatsByIndex(VkDevice device, size_t pool_index)
 {
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	VkPipelineLayoutCreateInfo pipeline_layout_info = {};
-	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipeline_layout_info.setLayoutCount = set_layouts_count;
-	pipeline_layout_info.pSetLayouts = set_layouts;
-	pipeline_layout_info.pushConstantRangeCount = pc_count;
-	pipeline_layout_info.pPushConstantRanges = pc;
+	KVF_ASSERT(pool_index < kvf_device->sets_pools_size && "invalid pool index");
+	KvfDescriptorPoolStats stats;
+	memset(&stats, 0, sizeof(KvfDescriptorPoolStats));
+	__kvfAccumulateDescriptorPoolStats(&stats, &kvf_device->sets_pools[pool_index]);
+	return stats;
+}
 
-	VkPipelineLayout layout;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreatePipelineLayout)(device, &pipeline_layout_info, kvf_device->callbacks, &layout));
-	return layout;
+KvfDescriptorFrameRing* kvfCreateDescriptorFrameRing(VkDevice device, uint32_t frames_count, uint32_t sets_per_pool)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(frames_count != 0);
+	KvfDescriptorFrameRing* ring = (KvfDescriptorFrameRing*)KVF_MALLOC(sizeof(KvfDescriptorFrameRing));
+	KVF_ASSERT(ring != NULL && "allocation failed :(");
+	ring->device = device;
+	ring->frames_count = frames_count;
+	ring->current_frame = 0;
+	ring->sets_per_pool = (sets_per_pool == 0 ? KVF_DESCRIPTOR_POOL_CAPACITY : sets_per_pool);
+	ring->frames = (__KvfDescriptorFrame*)KVF_MALLOC(sizeof(__KvfDescriptorFrame) * frames_count);
+	KVF_ASSERT(ring->frames != NULL && "allocation failed :(");
+	memset(ring->frames, 0, sizeof(__KvfDescriptorFrame) * frames_count);
+	return ring;
 }
 
-void kvfDestroyPipelineLayout(VkDevice device, VkPipelineLayout layout)
+void kvfDestroyDescriptorFrameRing(KvfDescriptorFrameRing* ring)
 {
-	if(layout == VK_NULL_HANDLE)
+	if(ring == NULL)
 		return;
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(ring->device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyPipelineLayout)(device, layout, kvf_device->callbacks);
+	for(uint32_t i = 0; i < ring->frames_count; i++)
+	{
+		for(size_t j = 0; j < ring->frames[i].pools_size; j++)
+			KVF_GET_DEVICE_FUNCTION(vkDestroyDescriptorPool)(ring->device, ring->frames[i].pools[j].pool, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+		KVF_FREE(ring->frames[i].pools);
+	}
+	KVF_FREE(ring->frames);
+	KVF_FREE(ring);
 }
 
-void kvfResetDeviceDescriptorPools(VkDevice device)
+void kvfDescriptorFrameRingBeginFrame(KvfDescriptorFrameRing* ring, uint32_t frame, VkFence fence)
 {
-	KVF_ASSERT(device != VK_NULL_HANDLE);
-	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(ring != NULL);
+	KVF_ASSERT(frame < ring->frames_count && "invalid frame index");
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(ring->device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	for(uint32_t i = 0; i < kvf_device->sets_pools_size; i++)
+	if(fence != VK_NULL_HANDLE)
 	{
-		KVF_GET_DEVICE_FUNCTION(vkResetDescriptorPool)(device, kvf_device->sets_pools[i].pool, 0);
-		kvf_device->sets_pools[i].size = 0;
+		VkResult result = KVF_GET_DEVICE_FUNCTION(vkWaitForFences)(ring->device, 1, &fence, VK_TRUE, UINT64_MAX);
+		__kvfCheckVk(result);
+		// The frame's sets may still be in use, its pools cannot be recycled
+		if(result != VK_SUCCESS)
+			return;
+	}
+
+	__KvfDescriptorFrame* kvf_frame = &ring->frames[frame];
+	// Only the pools that have been allocated from need a reset
+	for(size_t i = 0; i < kvf_frame->pools_size && i <= kvf_frame->current_pool; i++)
+	{
+		__KvfDescriptorPool* pool = &kvf_frame->pools[i];
+		if(pool->size == 0 && !pool->full)
+			continue;
+		KVF_GET_DEVICE_FUNCTION(vkResetDescriptorPool)(ring->device, pool->pool, 0);
+		pool->size = 0;
+		pool->full = false;
+		memset(pool->descriptors_size, 0, sizeof(pool->descriptors_size));
+	}
+	kvf_frame->current_pool = 0;
+	ring->current_frame = frame;
+}
+
+VkDescriptorSet kvfDescriptorFrameRingAllocate(KvfDescriptorFrameRing* ring, VkDescriptorSetLayout layout)
+{
+	KVF_ASSERT(ring != NULL);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(ring->device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	__KvfDescriptorSetLayoutInfo* info = __kvfGetDescriptorSetLayoutInfo(kvf_device, layout);
+	KVF_ASSERT((info == NULL || !(info->flags & __KVF_SETLESS_LAYOUT_FLAGS)) && "push descriptor and descriptor buffer layouts cannot allocate sets");
+	const uint32_t* counts = (info != NULL ? info->counts : NULL);
+
+	__KvfDescriptorFrame* frame = &ring->frames[ring->current_frame];
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	// Pools are filled linearly, a pool that cannot hold the set is left behind until the next reset
+	for(; frame->current_pool < frame->pools_size; frame->current_pool++)
+	{
+		__KvfDescriptorPool* pool = &frame->pools[frame->current_pool];
+		if(__kvfDescriptorPoolFits(pool, counts) && __kvfTryAllocateDescriptorSetFromPool(kvf_device, pool, layout, counts, &set, &frame->failed_allocations))
+			return set;
 	}
+
+	size_t capacity = ring->sets_per_pool;
+	if(frame->pools_size != 0)
+		capacity = frame->pools[frame->pools_size - 1].capacity * 2;
+	if(capacity > KVF_DESCRIPTOR_POOL_MAX_CAPACITY)
+		capacity = KVF_DESCRIPTOR_POOL_MAX_CAPACITY;
+	frame->pools_size++;
+	frame->pools = (__KvfDescriptorPool*)KVF_REALLOC(frame->pools, sizeof(__KvfDescriptorPool) * frame->pools_size);
+	KVF_ASSERT(frame->pools != NULL && "allocation failed :(");
+	__KvfDescriptorPool* pool = &frame->pools[frame->pools_size - 1];
+	__kvfCreateDescriptorPool(kvf_device, pool, capacity, counts, 0);
+	frame->current_pool = frame->pools_size - 1;
+
+	bool allocated = __kvfTryAllocateDescriptorSetFromPool(kvf_device, pool, layout, counts, &set, &frame->failed_allocations);
+	KVF_ASSERT(allocated && "could not allocate a descriptor set from a new pool");
+	(void)allocated;
+	return set;
+}
+
+KvfDescriptorPoolStats kvfDescriptorFrameRingGetStats(KvfDescriptorFrameRing* ring, uint32_t frame)
+{
+	KVF_ASSERT(ring != NULL);
+	KVF_ASSERT(frame < ring->frames_count && "invalid frame index");
+	KvfDescriptorPoolStats stats;
+	memset(&stats, 0, sizeof(KvfDescriptorPoolStats));
+	stats.pools_count = ring->frames[frame].pools_size;
+	stats.failed_allocations = ring->frames[frame].failed_allocations;
+	for(size_t i = 0; i < ring->frames[frame].pools_size; i++)
+		__kvfAccumulateDescriptorPoolStats(&stats, &ring->frames[frame].pools[i]);
+	return stats;
 }
 
 KvfGraphicsPipelineBuilder* kvfCreateGPipelineBuilder()
@@ -3311,7 +8373,7 @@ VkPipeline kvfCreateGraphicsPipeline(VkDevice device, VkPipelineCache cache, VkP
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
 	VkPipeline pipeline;
-	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateGraphicsPipelines)(device, cache, 1, &pipeline_info, kvf_device->callbacks, &pipeline));
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreateGraphicsPipelines)(device, cache, 1, &pipeline_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE), &pipeline));
 	return pipeline;
 }
 
@@ -3320,7 +8382,159 @@ void kvfDestroyPipeline(VkDevice device, VkPipeline pipeline)
 	KVF_ASSERT(device != VK_NULL_HANDLE);
 	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
 	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
-	KVF_GET_DEVICE_FUNCTION(vkDestroyPipeline)(device, pipeline, kvf_device->callbacks);
+	KVF_GET_DEVICE_FUNCTION(vkDestroyPipeline)(device, pipeline, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE));
+}
+
+// Returns the driver's data stored in the file if it is intact and was created by the same device and driver, NULL otherwise
+void* __kvfReadPipelineCacheFile(__KvfDevice* kvf_device, const char* path, size_t* data_size)
+{
+	FILE* file = fopen(path, "rb");
+	if(file == NULL)
+		return NULL;
+	// The stored size is only trusted if it accounts for the whole file, a missing or trailing byte means the file was not written by kvfSavePipelineCache
+	long file_size = -1;
+	if(fseek(file, 0, SEEK_END) == 0)
+		file_size = ftell(file);
+	__KvfPipelineCacheFileHeader header;
+	void* data = NULL;
+	if(file_size >= (long)sizeof(__KvfPipelineCacheFileHeader) && fseek(file, 0, SEEK_SET) == 0 &&
+		fread(&header, sizeof(__KvfPipelineCacheFileHeader), 1, file) == 1 && header.magic == __KVF_PIPELINE_CACHE_FILE_MAGIC && header.version == __KVF_PIPELINE_CACHE_FILE_VERSION &&
+		header.data_size == (uint64_t)file_size - sizeof(__KvfPipelineCacheFileHeader) && header.data_size >= sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		data = KVF_MALLOC((size_t)header.data_size);
+		KVF_ASSERT(data != NULL && "allocation failed :(");
+		if(fread(data, 1, (size_t)header.data_size, file) != header.data_size || __kvfHashBytes(data, (size_t)header.data_size, __KVF_FNV_OFFSET_BASIS) != header.checksum)
+		{
+			KVF_FREE(data);
+			data = NULL;
+		}
+	}
+	fclose(file);
+	if(data == NULL)
+		return NULL;
+
+	VkPipelineCacheHeaderVersionOne driver_header;
+	memcpy(&driver_header, data, sizeof(VkPipelineCacheHeaderVersionOne));
+	VkPhysicalDeviceProperties properties;
+	KVF_GET_INSTANCE_FUNCTION(vkGetPhysicalDeviceProperties)(kvf_device->physical, &properties);
+	if(driver_header.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) || driver_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		driver_header.vendorID != properties.vendorID || driver_header.deviceID != properties.deviceID ||
+		memcmp(driver_header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		KVF_FREE(data);
+		return NULL;
+	}
+	*data_size = (size_t)header.data_size;
+	return data;
+}
+
+VkPipelineCache kvfCreatePipelineCache(VkDevice device, const char* path, bool* loaded)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+
+	size_t data_size = 0;
+	void* data = (path != NULL ? __kvfReadPipelineCacheFile(kvf_device, path, &data_size) : NULL);
+
+	VkPipelineCacheCreateInfo cache_info = {};
+	cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cache_info.initialDataSize = data_size;
+	cache_info.pInitialData = data;
+	VkPipelineCache cache;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkCreatePipelineCache)(device, &cache_info, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE_CACHE), &cache));
+	if(loaded != NULL)
+		*loaded = (data != NULL);
+	KVF_FREE(data);
+	return cache;
+}
+
+void kvfDestroyPipelineCache(VkDevice device, VkPipelineCache cache)
+{
+	if(cache == VK_NULL_HANDLE)
+		return;
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+	KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	KVF_GET_DEVICE_FUNCTION(vkDestroyPipelineCache)(device, cache, __kvfGetAllocationCallbacks(kvf_device, VK_OBJECT_TYPE_PIPELINE_CACHE));
+}
+
+void kvfMergePipelineCaches(VkDevice device, VkPipelineCache dst, const VkPipelineCache* srcs, uint32_t srcs_count)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(dst != VK_NULL_HANDLE);
+	KVF_ASSERT(srcs_count == 0 || srcs != NULL);
+	if(srcs_count == 0)
+		return;
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkMergePipelineCaches)(device, dst, srcs_count, srcs));
+}
+
+bool __kvfSyncFile(FILE* file)
+{
+	#ifdef _WIN32
+		return _commit(_fileno(file)) == 0;
+	#elif defined(__unix__) || defined(__APPLE__)
+		return fsync(fileno(file)) == 0;
+	#else
+		(void)file;
+		return true;
+	#endif
+}
+
+bool kvfSavePipelineCache(VkDevice device, VkPipelineCache cache, const char* path)
+{
+	KVF_ASSERT(device != VK_NULL_HANDLE);
+	KVF_ASSERT(cache != VK_NULL_HANDLE);
+	KVF_ASSERT(path != NULL);
+	#ifdef KVF_IMPL_VK_NO_PROTOTYPES
+		__KvfDevice* kvf_device = __kvfGetKvfDeviceFromVkDevice(device);
+		KVF_ASSERT(kvf_device != NULL && "could not find VkDevice in registered devices");
+	#endif
+
+	size_t data_size = 0;
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkGetPipelineCacheData)(device, cache, &data_size, NULL));
+	void* data = KVF_MALLOC(data_size == 0 ? 1 : data_size);
+	KVF_ASSERT(data != NULL && "allocation failed :(");
+	__kvfCheckVk(KVF_GET_DEVICE_FUNCTION(vkGetPipelineCacheData)(device, cache, &data_size, data));
+
+	__KvfPipelineCacheFileHeader header;
+	memset(&header, 0, sizeof(__KvfPipelineCacheFileHeader));
+	header.magic = __KVF_PIPELINE_CACHE_FILE_MAGIC;
+	header.version = __KVF_PIPELINE_CACHE_FILE_VERSION;
+	header.data_size = data_size;
+	header.checksum = __kvfHashBytes(data, data_size, __KVF_FNV_OFFSET_BASIS);
+
+	size_t path_length = strlen(path);
+	char* tmp_path = (char*)KVF_MALLOC(path_length + 5);
+	KVF_ASSERT(tmp_path != NULL && "allocation failed :(");
+	memcpy(tmp_path, path, path_length);
+	memcpy(tmp_path + path_length, ".tmp", 5);
+
+	bool written = false;
+	FILE* file = fopen(tmp_path, "wb");
+	if(file != NULL)
+	{
+		written = (fwrite(&header, sizeof(__KvfPipelineCacheFileHeader), 1, file) == 1 && fwrite(data, 1, data_size, file) == data_size);
+		written = (fflush(file) == 0 && written);
+		// Without it a power loss after the rename could leave an empty or partial file in place
+		written = (written && __kvfSyncFile(file));
+		written = (fclose(file) == 0 && written);
+		#ifdef _WIN32
+			// rename does not replace existing files on Windows, removing path first would not be atomic
+			written = (written && MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0);
+		#else
+			written = (written && rename(tmp_path, path) == 0);
+		#endif
+		if(!written)
+			remove(tmp_path);
+	}
+	KVF_FREE(tmp_path);
+	KVF_FREE(data);
+	return written;
 }
 
 #endif // KVF_IMPLEMENTATION
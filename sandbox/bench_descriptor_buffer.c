@@ -0,0 +1,172 @@
+// Compares descriptor sets allocated from pools and written with vkUpdateDescriptorSets against VK_EXT_descriptor_buffer,
+// on a layout of two uniform buffers and two combined image samplers.
+// Runs on software drivers, e.g. VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./bench_descriptor_buffer
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#define KVF_IMPLEMENTATION
+#include "../kvf.h"
+
+#define SETS_COUNT 1024
+#define ITERATIONS 100
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// kvfCreateBuffer and kvfCreateImage do not bind memory, which descriptors must not reference
+static VkDeviceMemory allocateMemory(VkDevice device, VkPhysicalDevice physical, VkMemoryRequirements requirements, VkMemoryPropertyFlags properties, const void* p_next)
+{
+	int32_t memory_type = kvfFindMemoryType(physical, requirements.memoryTypeBits, properties);
+	if(memory_type == -1)
+		return VK_NULL_HANDLE;
+	VkMemoryAllocateInfo alloc_info = { 0 };
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.pNext = p_next;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+	VkDeviceMemory memory;
+	if(vkAllocateMemory(device, &alloc_info, NULL, &memory) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	return memory;
+}
+
+static void report(const char* name, double start, double end)
+{
+	printf("%-24s %8.1f ns per set\n", name, (end - start) / ((double)SETS_COUNT * ITERATIONS));
+}
+
+static bool hasDeviceExtension(VkPhysicalDevice physical, const char* name)
+{
+	uint32_t count = 0;
+	vkEnumerateDeviceExtensionProperties(physical, NULL, &count, NULL);
+	VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(sizeof(VkExtensionProperties) * count);
+	vkEnumerateDeviceExtensionProperties(physical, NULL, &count, extensions);
+	bool found = false;
+	for(uint32_t i = 0; i < count && !found; i++)
+		found = (strcmp(extensions[i].extensionName, name) == 0);
+	free(extensions);
+	return found;
+}
+
+int main(void)
+{
+	// Buffer device addresses are core in Vulkan 1.2
+	kvfSetInstanceAPIVersion(VK_API_VERSION_1_2);
+	VkInstance instance = kvfCreateInstance(NULL, 0);
+	VkPhysicalDevice ph_device = kvfPickGoodHeadlessPhysicalDevice(instance);
+	if(ph_device == VK_NULL_HANDLE)
+	{
+		fprintf(stderr, "no suitable physical device found\n");
+		return 1;
+	}
+	if(!hasDeviceExtension(ph_device, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME))
+	{
+		fprintf(stderr, "VK_EXT_descriptor_buffer is not supported\n");
+		return 1;
+	}
+
+	VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptor_buffer_features;
+	VkPhysicalDeviceBufferDeviceAddressFeatures device_address_features;
+	kvfFillDescriptorBufferFeatures(&descriptor_buffer_features, &device_address_features);
+	const char* extensions[] = { VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME };
+	VkDevice device = kvfCreateDeviceNext(ph_device, extensions, 1, NULL, &descriptor_buffer_features);
+
+	// Descriptor buffers reference buffers by address, so the uniform buffer needs a device address
+	VkBuffer buffer = kvfCreateBuffer(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 512);
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+	VkMemoryAllocateFlagsInfo flags_info = { 0 };
+	flags_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	flags_info.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+	VkDeviceMemory buffer_memory = allocateMemory(device, ph_device, requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &flags_info);
+	VkImage image = kvfCreateImage(device, 16, 16, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, KVF_IMAGE_COLOR);
+	vkGetImageMemoryRequirements(device, image, &requirements);
+	VkDeviceMemory image_memory = allocateMemory(device, ph_device, requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, NULL);
+	if(buffer_memory == VK_NULL_HANDLE || image_memory == VK_NULL_HANDLE ||
+		vkBindBufferMemory(device, buffer, buffer_memory, 0) != VK_SUCCESS || vkBindImageMemory(device, image, image_memory, 0) != VK_SUCCESS)
+	{
+		fprintf(stderr, "could not allocate the resources memory\n");
+		return 1;
+	}
+	VkBufferDeviceAddressInfo address_info = { 0 };
+	address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	address_info.buffer = buffer;
+	VkDeviceAddress address = vkGetBufferDeviceAddress(device, &address_info);
+
+	VkImageView view = kvfCreateImageView(device, image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	VkSampler sampler = kvfCreateSampler(device, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_MIPMAP_MODE_LINEAR);
+
+	VkDescriptorSetLayoutBinding bindings[4] = { 0 };
+	for(uint32_t i = 0; i < 4; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = (i < 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	}
+	VkDescriptorSetLayout layout = kvfCreateDescriptorSetLayout(device, bindings, 4);
+	VkDescriptorSetLayout buffer_layout = kvfCreateDescriptorSetLayoutWithFlags(device, bindings, 4, VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT);
+
+	VkDescriptorBufferInfo camera = { buffer, 0, 256 };
+	VkDescriptorBufferInfo model = { buffer, 256, 256 };
+	VkDescriptorImageInfo albedo = { sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+	// Sets allocated from the pools every iteration, then written with one vkUpdateDescriptorSets
+	KvfDescriptorWriteBatch* batch = kvfCreateDescriptorWriteBatch(device);
+	double start = now();
+	for(uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		kvfResetDeviceDescriptorPools(device);
+		for(uint32_t j = 0; j < SETS_COUNT; j++)
+		{
+			VkDescriptorSet set = kvfAllocateDescriptorSet(device, layout);
+			kvfDescriptorWriteBatchAddBuffers(batch, set, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &camera, 1);
+			kvfDescriptorWriteBatchAddBuffers(batch, set, 1, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &model, 1);
+			kvfDescriptorWriteBatchAddImages(batch, set, 2, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedo, 1);
+			kvfDescriptorWriteBatchAddImages(batch, set, 3, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedo, 1);
+		}
+		kvfDescriptorWriteBatchFlush(batch);
+	}
+	report("pools + update sets", start, now());
+	kvfDestroyDescriptorWriteBatch(batch);
+
+	// Sets sub-allocated from a mapped buffer, descriptors written in place with vkGetDescriptorEXT
+	KvfDescriptorBuffer* descriptor_buffer = kvfCreateDescriptorBuffer(device, (VkDeviceSize)SETS_COUNT * 1024);
+	start = now();
+	for(uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		kvfDescriptorBufferReset(descriptor_buffer);
+		for(uint32_t j = 0; j < SETS_COUNT; j++)
+		{
+			VkDeviceSize offset = kvfDescriptorBufferAllocate(descriptor_buffer, buffer_layout);
+			kvfDescriptorBufferWriteBuffer(descriptor_buffer, buffer_layout, offset, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, address, 256);
+			kvfDescriptorBufferWriteBuffer(descriptor_buffer, buffer_layout, offset, 1, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, address + 256, 256);
+			kvfDescriptorBufferWriteImage(descriptor_buffer, buffer_layout, offset, 2, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedo);
+			kvfDescriptorBufferWriteImage(descriptor_buffer, buffer_layout, offset, 3, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedo);
+		}
+	}
+	report("descriptor buffer", start, now());
+	printf("%-24s %8llu bytes per set\n", "descriptor buffer size", (unsigned long long)(kvfDescriptorBufferGetUsedSize(descriptor_buffer) / SETS_COUNT));
+	kvfDestroyDescriptorBuffer(descriptor_buffer);
+
+	// Cleanup
+	kvfDestroyDescriptorSetLayout(device, buffer_layout);
+	kvfDestroyDescriptorSetLayout(device, layout);
+	kvfDestroySampler(device, sampler);
+	kvfDestroyImageView(device, view);
+	kvfDestroyImage(device, image);
+	kvfDestroyBuffer(device, buffer);
+	vkFreeMemory(device, image_memory, NULL);
+	vkFreeMemory(device, buffer_memory, NULL);
+	kvfDestroyDevice(device);
+	kvfDestroyInstance(instance);
+	return 0;
+}
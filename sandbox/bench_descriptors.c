@@ -0,0 +1,163 @@
+// Compares the ways kvf can update descriptor sets, on a layout of two uniform buffers and two combined image samplers.
+// Runs on software drivers, e.g. VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./bench_descriptors
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#define KVF_IMPLEMENTATION
+#include "../kvf.h"
+
+#define SETS_COUNT 1024
+#define ITERATIONS 100
+
+// Matches the layout's bindings, as expected by kvfUpdateDescriptorSetWithTemplate
+typedef struct
+{
+	VkDescriptorBufferInfo camera;
+	VkDescriptorBufferInfo model;
+	VkDescriptorImageInfo albedo;
+	VkDescriptorImageInfo normal;
+} MaterialDescriptors;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// kvfCreateBuffer and kvfCreateImage do not bind memory, which descriptors must not reference
+static VkDeviceMemory allocateMemory(VkDevice device, VkPhysicalDevice physical, VkMemoryRequirements requirements)
+{
+	int32_t memory_type = kvfFindMemoryType(physical, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if(memory_type == -1)
+		return VK_NULL_HANDLE;
+	VkMemoryAllocateInfo alloc_info = { 0 };
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = (uint32_t)memory_type;
+	VkDeviceMemory memory;
+	if(vkAllocateMemory(device, &alloc_info, NULL, &memory) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	return memory;
+}
+
+static void report(const char* name, double start, double end)
+{
+	printf("%-24s %8.1f ns per set\n", name, (end - start) / ((double)SETS_COUNT * ITERATIONS));
+}
+
+int main(void)
+{
+	// Templates are core in Vulkan 1.1
+	kvfSetInstanceAPIVersion(VK_API_VERSION_1_1);
+	VkInstance instance = kvfCreateInstance(NULL, 0);
+	VkPhysicalDevice ph_device = kvfPickGoodHeadlessPhysicalDevice(instance);
+	if(ph_device == VK_NULL_HANDLE)
+	{
+		fprintf(stderr, "no suitable physical device found\n");
+		return 1;
+	}
+	VkDevice device = kvfCreateHeadlessDevice(ph_device);
+
+	VkBuffer buffer = kvfCreateBuffer(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 512);
+	VkImage image = kvfCreateImage(device, 16, 16, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, KVF_IMAGE_COLOR);
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, buffer, &requirements);
+	VkDeviceMemory buffer_memory = allocateMemory(device, ph_device, requirements);
+	vkGetImageMemoryRequirements(device, image, &requirements);
+	VkDeviceMemory image_memory = allocateMemory(device, ph_device, requirements);
+	if(buffer_memory == VK_NULL_HANDLE || image_memory == VK_NULL_HANDLE ||
+		vkBindBufferMemory(device, buffer, buffer_memory, 0) != VK_SUCCESS || vkBindImageMemory(device, image, image_memory, 0) != VK_SUCCESS)
+	{
+		fprintf(stderr, "could not allocate the resources memory\n");
+		return 1;
+	}
+	VkImageView view = kvfCreateImageView(device, image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	VkSampler sampler = kvfCreateSampler(device, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_MIPMAP_MODE_LINEAR);
+
+	VkDescriptorSetLayoutBinding bindings[4] = { 0 };
+	for(uint32_t i = 0; i < 4; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = (i < 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	}
+	VkDescriptorSetLayout layout = kvfCreateDescriptorSetLayout(device, bindings, 4);
+	if(kvfGetDescriptorSetLayoutUpdateDataSize(device, layout) != sizeof(MaterialDescriptors))
+	{
+		fprintf(stderr, "template data does not match MaterialDescriptors\n");
+		return 1;
+	}
+
+	static VkDescriptorSet sets[SETS_COUNT];
+	for(uint32_t i = 0; i < SETS_COUNT; i++)
+		sets[i] = kvfAllocateDescriptorSet(device, layout);
+
+	MaterialDescriptors descriptors;
+	descriptors.camera.buffer = buffer;
+	descriptors.camera.offset = 0;
+	descriptors.camera.range = 256;
+	descriptors.model.buffer = buffer;
+	descriptors.model.offset = 256;
+	descriptors.model.range = 256;
+	descriptors.albedo.sampler = sampler;
+	descriptors.albedo.imageView = view;
+	descriptors.albedo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	descriptors.normal = descriptors.albedo;
+
+	// One vkUpdateDescriptorSets per binding
+	double start = now();
+	for(uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		for(uint32_t j = 0; j < SETS_COUNT; j++)
+		{
+			kvfUpdateUniformBufferToDescriptorSet(device, sets[j], &descriptors.camera, 0);
+			kvfUpdateUniformBufferToDescriptorSet(device, sets[j], &descriptors.model, 1);
+			kvfUpdateImageToDescriptorSet(device, sets[j], &descriptors.albedo, 2);
+			kvfUpdateImageToDescriptorSet(device, sets[j], &descriptors.normal, 3);
+		}
+	}
+	report("per binding helpers", start, now());
+
+	// One vkUpdateDescriptorSets for all the sets
+	KvfDescriptorWriteBatch* batch = kvfCreateDescriptorWriteBatch(device);
+	start = now();
+	for(uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		for(uint32_t j = 0; j < SETS_COUNT; j++)
+		{
+			kvfDescriptorWriteBatchAddBuffers(batch, sets[j], 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &descriptors.camera, 1);
+			kvfDescriptorWriteBatchAddBuffers(batch, sets[j], 1, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &descriptors.model, 1);
+			kvfDescriptorWriteBatchAddImages(batch, sets[j], 2, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &descriptors.albedo, 1);
+			kvfDescriptorWriteBatchAddImages(batch, sets[j], 3, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &descriptors.normal, 1);
+		}
+		kvfDescriptorWriteBatchFlush(batch);
+	}
+	report("write batch", start, now());
+	kvfDestroyDescriptorWriteBatch(batch);
+
+	// One vkUpdateDescriptorSetWithTemplate per set
+	start = now();
+	for(uint32_t i = 0; i < ITERATIONS; i++)
+	{
+		for(uint32_t j = 0; j < SETS_COUNT; j++)
+			kvfUpdateDescriptorSetWithTemplate(device, sets[j], layout, &descriptors);
+	}
+	report("update template", start, now());
+
+	// Cleanup
+	kvfDestroyDescriptorSetLayout(device, layout);
+	kvfDestroySampler(device, sampler);
+	kvfDestroyImageView(device, view);
+	kvfDestroyImage(device, image);
+	kvfDestroyBuffer(device, buffer);
+	vkFreeMemory(device, image_memory, NULL);
+	vkFreeMemory(device, buffer_memory, NULL);
+	kvfDestroyDevice(device);
+	kvfDestroyInstance(instance);
+	return 0;
+}
@@ -0,0 +1,168 @@
+// Compares the startup cost of building the sandbox pipelines with a cold and a warm on-disk pipeline cache.
+// Runs on software drivers, e.g. VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./bench_pipeline_cache
+// Mesa also keeps its own shader cache, MESA_SHADER_CACHE_DISABLE=true isolates the effect of the pipeline cache
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#define KVF_IMPLEMENTATION
+#include "../kvf.h"
+
+#define CACHE_PATH "pipeline_cache.bin"
+#define PIPELINES_COUNT 48
+
+static const uint32_t vertex_shader[] = {
+	0x07230203,0x00010000,0x000d000b,0x00000036,0x00000000,0x00020011,0x00000001,0x0006000b,0x00000001,0x4c534c47,0x6474732e,0x3035342e,
+	0x00000000,0x0003000e,0x00000000,0x00000001,0x0008000f,0x00000000,0x00000004,0x6e69616d,0x00000000,0x00000022,0x00000026,0x00000031,
+	0x00030003,0x00000002,0x000001c2,0x000a0004,0x475f4c47,0x4c474f4f,0x70635f45,0x74735f70,0x5f656c79,0x656e696c,0x7269645f,0x69746365,
+	0x00006576,0x00080004,0x475f4c47,0x4c474f4f,0x6e695f45,0x64756c63,0x69645f65,0x74636572,0x00657669,0x00040005,0x00000004,0x6e69616d,
+	0x00000000,0x00050005,0x0000000c,0x69736f70,0x6e6f6974,0x00000073,0x00040005,0x00000017,0x6f6c6f63,0x00007372,0x00060005,0x00000020,
+	0x505f6c67,0x65567265,0x78657472,0x00000000,0x00060006,0x00000020,0x00000000,0x505f6c67,0x7469736f,0x006e6f69,0x00070006,0x00000020,
+	0x00000001,0x505f6c67,0x746e696f,0x657a6953,0x00000000,0x00070006,0x00000020,0x00000002,0x435f6c67,0x4470696c,0x61747369,0x0065636e,
+	0x00070006,0x00000020,0x00000003,0x435f6c67,0x446c6c75,0x61747369,0x0065636e,0x00030005,0x00000022,0x00000000,0x00060005,0x00000026,
+	0x565f6c67,0x65747265,0x646e4978,0x00007865,0x00050005,0x00000031,0x67617266,0x6f6c6f43,0x00000072,0x00050048,0x00000020,0x00000000,
+	0x0000000b,0x00000000,0x00050048,0x00000020,0x00000001,0x0000000b,0x00000001,0x00050048,0x00000020,0x00000002,0x0000000b,0x00000003,
+	0x00050048,0x00000020,0x00000003,0x0000000b,0x00000004,0x00030047,0x00000020,0x00000002,0x00040047,0x00000026,0x0000000b,0x0000002a,
+	0x00040047,0x00000031,0x0000001e,0x00000000,0x00020013,0x00000002,0x00030021,0x00000003,0x00000002,0x00030016,0x00000006,0x00000020,
+	0x00040017,0x00000007,0x00000006,0x00000002,0x00040015,0x00000008,0x00000020,0x00000000,0x0004002b,0x00000008,0x00000009,0x00000003,
+	0x0004001c,0x0000000a,0x00000007,0x00000009,0x00040020,0x0000000b,0x00000006,0x0000000a,0x0004003b,0x0000000b,0x0000000c,0x00000006,
+	0x0004002b,0x00000006,0x0000000d,0x00000000,0x0004002b,0x00000006,0x0000000e,0xbf000000,0x0005002c,0x00000007,0x0000000f,0x0000000d,
+	0x0000000e,0x0004002b,0x00000006,0x00000010,0x3f000000,0x0005002c,0x00000007,0x00000011,0x00000010,0x00000010,0x0005002c,0x00000007,
+	0x00000012,0x0000000e,0x00000010,0x0006002c,0x0000000a,0x00000013,0x0000000f,0x00000011,0x00000012,0x00040017,0x00000014,0x00000006,
+	0x00000003,0x0004001c,0x00000015,0x00000014,0x00000009,0x00040020,0x00000016,0x00000006,0x00000015,0x0004003b,0x00000016,0x00000017,
+	0x00000006,0x0004002b,0x00000006,0x00000018,0x3f800000,0x0006002c,0x00000014,0x00000019,0x00000018,0x0000000d,0x0000000d,0x0006002c,
+	0x00000014,0x0000001a,0x0000000d,0x00000018,0x0000000d,0x0006002c,0x00000014,0x0000001b,0x0000000d,0x0000000d,0x00000018,0x0006002c,
+	0x00000015,0x0000001c,0x00000019,0x0000001a,0x0000001b,0x00040017,0x0000001d,0x00000006,0x00000004,0x0004002b,0x00000008,0x0000001e,
+	0x00000001,0x0004001c,0x0000001f,0x00000006,0x0000001e,0x0006001e,0x00000020,0x0000001d,0x00000006,0x0000001f,0x0000001f,0x00040020,
+	0x00000021,0x00000003,0x00000020,0x0004003b,0x00000021,0x00000022,0x00000003,0x00040015,0x00000023,0x00000020,0x00000001,0x0004002b,
+	0x00000023,0x00000024,0x00000000,0x00040020,0x00000025,0x00000001,0x00000023,0x0004003b,0x00000025,0x00000026,0x00000001,0x00040020,
+	0x00000028,0x00000006,0x00000007,0x00040020,0x0000002e,0x00000003,0x0000001d,0x00040020,0x00000030,0x00000003,0x00000014,0x0004003b,
+	0x00000030,0x00000031,0x00000003,0x00040020,0x00000033,0x00000006,0x00000014,0x00050036,0x00000002,0x00000004,0x00000000,0x00000003,
+	0x000200f8,0x00000005,0x0003003e,0x0000000c,0x00000013,0x0003003e,0x00000017,0x0000001c,0x0004003d,0x00000023,0x00000027,0x00000026,
+	0x00050041,0x00000028,0x00000029,0x0000000c,0x00000027,0x0004003d,0x00000007,0x0000002a,0x00000029,0x00050051,0x00000006,0x0000002b,
+	0x0000002a,0x00000000,0x00050051,0x00000006,0x0000002c,0x0000002a,0x00000001,0x00070050,0x0000001d,0x0000002d,0x0000002b,0x0000002c,
+	0x0000000d,0x00000018,0x00050041,0x0000002e,0x0000002f,0x00000022,0x00000024,0x0003003e,0x0000002f,0x0000002d,0x0004003d,0x00000023,
+	0x00000032,0x00000026,0x00050041,0x00000033,0x00000034,0x00000017,0x00000032,0x0004003d,0x00000014,0x00000035,0x00000034,0x0003003e,
+	0x00000031,0x00000035,0x000100fd,0x00010038
+};
+
+static const uint32_t fragment_shader[] = {
+	0x07230203,0x00010000,0x000d000b,0x00000013,0x00000000,0x00020011,0x00000001,0x0006000b,0x00000001,0x4c534c47,0x6474732e,0x3035342e,
+	0x00000000,0x0003000e,0x00000000,0x00000001,0x0007000f,0x00000004,0x00000004,0x6e69616d,0x00000000,0x00000009,0x0000000c,0x00030010,
+	0x00000004,0x00000007,0x00030003,0x00000002,0x000001c2,0x000a0004,0x475f4c47,0x4c474f4f,0x70635f45,0x74735f70,0x5f656c79,0x656e696c,
+	0x7269645f,0x69746365,0x00006576,0x00080004,0x475f4c47,0x4c474f4f,0x6e695f45,0x64756c63,0x69645f65,0x74636572,0x00657669,0x00040005,
+	0x00000004,0x6e69616d,0x00000000,0x00050005,0x00000009,0x4374756f,0x726f6c6f,0x00000000,0x00050005,0x0000000c,0x67617266,0x6f6c6f43,
+	0x00000072,0x00040047,0x00000009,0x0000001e,0x00000000,0x00040047,0x0000000c,0x0000001e,0x00000000,0x00020013,0x00000002,0x00030021,
+	0x00000003,0x00000002,0x00030016,0x00000006,0x00000020,0x00040017,0x00000007,0x00000006,0x00000004,0x00040020,0x00000008,0x00000003,
+	0x00000007,0x0004003b,0x00000008,0x00000009,0x00000003,0x00040017,0x0000000a,0x00000006,0x00000003,0x00040020,0x0000000b,0x00000001,
+	0x0000000a,0x0004003b,0x0000000b,0x0000000c,0x00000001,0x0004002b,0x00000006,0x0000000e,0x3f800000,0x00050036,0x00000002,0x00000004,
+	0x00000000,0x00000003,0x000200f8,0x00000005,0x0004003d,0x0000000a,0x0000000d,0x0000000c,0x00050051,0x00000006,0x0000000f,0x0000000d,
+	0x00000000,0x00050051,0x00000006,0x00000010,0x0000000d,0x00000001,0x00050051,0x00000006,0x00000011,0x0000000d,0x00000002,0x00070050,
+	0x00000007,0x00000012,0x0000000f,0x00000010,0x00000011,0x0000000e,0x0003003e,0x00000009,0x00000012,0x000100fd,0x00010038
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Every pipeline differs by its fixed function states so that none of them can be shared
+static void buildPipelines(VkDevice device, VkPipelineCache* caches, uint32_t caches_count, VkPipelineLayout layout, VkRenderPass pass, VkShaderModule vertex, VkShaderModule fragment, VkPipeline* pipelines)
+{
+	const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_PRIMITIVE_TOPOLOGY_POINT_LIST };
+	const VkCullModeFlags cull_modes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_AND_BACK };
+
+	KvfGraphicsPipelineBuilder* builder = kvfCreateGPipelineBuilder();
+	kvfGPipelineBuilderSetPolygonMode(builder, VK_POLYGON_MODE_FILL, 1.0f);
+	kvfGPipelineBuilderSetMultisampling(builder, VK_SAMPLE_COUNT_1_BIT);
+	kvfGPipelineBuilderAddShaderStage(builder, VK_SHADER_STAGE_VERTEX_BIT, vertex, "main");
+	kvfGPipelineBuilderAddShaderStage(builder, VK_SHADER_STAGE_FRAGMENT_BIT, fragment, "main");
+	kvfGPipelineBuilderDisableDepthTest(builder);
+	for(uint32_t i = 0; i < PIPELINES_COUNT; i++)
+	{
+		kvfGPipelineBuilderSetInputTopology(builder, topologies[i % 4]);
+		kvfGPipelineBuilderSetCullMode(builder, cull_modes[(i / 4) % 4], VK_FRONT_FACE_CLOCKWISE);
+		switch(i / 16)
+		{
+			case 0: kvfGPipelineBuilderDisableBlending(builder); break;
+			case 1: kvfGPipelineBuilderEnableAlphaBlending(builder); break;
+			default: kvfGPipelineBuilderEnableAdditiveBlending(builder); break;
+		}
+		// Spreads the pipelines over the caches as worker threads would
+		pipelines[i] = kvfCreateGraphicsPipeline(device, caches[i % caches_count], layout, builder, pass);
+	}
+	kvfDestroyGPipelineBuilder(builder);
+}
+
+static void destroyPipelines(VkDevice device, VkPipeline* pipelines)
+{
+	for(uint32_t i = 0; i < PIPELINES_COUNT; i++)
+		kvfDestroyPipeline(device, pipelines[i]);
+}
+
+int main(void)
+{
+	VkInstance instance = kvfCreateInstance(NULL, 0);
+	VkPhysicalDevice ph_device = kvfPickGoodHeadlessPhysicalDevice(instance);
+	if(ph_device == VK_NULL_HANDLE)
+	{
+		fprintf(stderr, "no suitable physical device found\n");
+		return 1;
+	}
+	VkDevice device = kvfCreateHeadlessDevice(ph_device);
+
+	VkAttachmentDescription attachment = kvfBuildAttachmentDescription(KVF_IMAGE_COLOR, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, VK_SAMPLE_COUNT_1_BIT);
+	VkRenderPass pass = kvfCreateRenderPass(device, &attachment, 1, VK_PIPELINE_BIND_POINT_GRAPHICS);
+	VkShaderModule vertex_shader_module = kvfCreateShaderModule(device, (uint32_t*)vertex_shader, sizeof(vertex_shader) / sizeof(uint32_t));
+	VkShaderModule fragment_shader_module = kvfCreateShaderModule(device, (uint32_t*)fragment_shader, sizeof(fragment_shader) / sizeof(uint32_t));
+	VkPipelineLayout layout = kvfCreatePipelineLayout(device, NULL, 0, NULL, 0);
+	static VkPipeline pipelines[PIPELINES_COUNT];
+
+	// Cold start, two per-thread caches merged and saved on shutdown
+	remove(CACHE_PATH);
+	bool loaded;
+	VkPipelineCache caches[2];
+	caches[0] = kvfCreatePipelineCache(device, CACHE_PATH, &loaded);
+	caches[1] = kvfCreatePipelineCache(device, NULL, NULL);
+	double start = now();
+	buildPipelines(device, caches, 2, layout, pass, vertex_shader_module, fragment_shader_module, pipelines);
+	double cold = now() - start;
+	kvfMergePipelineCaches(device, caches[0], &caches[1], 1);
+	if(!kvfSavePipelineCache(device, caches[0], CACHE_PATH))
+	{
+		fprintf(stderr, "could not save the pipeline cache\n");
+		return 1;
+	}
+	destroyPipelines(device, pipelines);
+	kvfDestroyPipelineCache(device, caches[1]);
+	kvfDestroyPipelineCache(device, caches[0]);
+
+	// Warm start from the saved file
+	VkPipelineCache cache = kvfCreatePipelineCache(device, CACHE_PATH, &loaded);
+	if(!loaded)
+	{
+		fprintf(stderr, "the saved pipeline cache was rejected\n");
+		return 1;
+	}
+	start = now();
+	buildPipelines(device, &cache, 1, layout, pass, vertex_shader_module, fragment_shader_module, pipelines);
+	double warm = now() - start;
+	destroyPipelines(device, pipelines);
+	kvfDestroyPipelineCache(device, cache);
+
+	printf("%-12s %10.1f us per pipeline\n", "cold cache", cold / (1e3 * PIPELINES_COUNT));
+	printf("%-12s %10.1f us per pipeline\n", "warm cache", warm / (1e3 * PIPELINES_COUNT));
+
+	// Cleanup
+	kvfDestroyPipelineLayout(device, layout);
+	kvfDestroyShaderModule(device, vertex_shader_module);
+	kvfDestroyShaderModule(device, fragment_shader_module);
+	kvfDestroyRenderPass(device, pass);
+	kvfDestroyDevice(device);
+	kvfDestroyInstance(instance);
+	return 0;
+}
@@ -0,0 +1,188 @@
+// Renders the sandbox triangle without any window nor swapchain and reads the frames back.
+// Runs on software drivers, e.g. VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./headless
+// The last frame is written to headless.ppm
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#define KVF_IMPLEMENTATION
+#define KVF_ENABLE_VALIDATION_LAYERS
+#include "../kvf.h"
+
+#define FRAMES_IN_FLIGHT 2
+#define FRAMES_COUNT 60
+
+static const uint32_t vertex_shader[] = {
+	0x07230203,0x00010000,0x000d000b,0x00000036,0x00000000,0x00020011,0x00000001,0x0006000b,0x00000001,0x4c534c47,0x6474732e,0x3035342e,
+	0x00000000,0x0003000e,0x00000000,0x00000001,0x0008000f,0x00000000,0x00000004,0x6e69616d,0x00000000,0x00000022,0x00000026,0x00000031,
+	0x00030003,0x00000002,0x000001c2,0x000a0004,0x475f4c47,0x4c474f4f,0x70635f45,0x74735f70,0x5f656c79,0x656e696c,0x7269645f,0x69746365,
+	0x00006576,0x00080004,0x475f4c47,0x4c474f4f,0x6e695f45,0x64756c63,0x69645f65,0x74636572,0x00657669,0x00040005,0x00000004,0x6e69616d,
+	0x00000000,0x00050005,0x0000000c,0x69736f70,0x6e6f6974,0x00000073,0x00040005,0x00000017,0x6f6c6f63,0x00007372,0x00060005,0x00000020,
+	0x505f6c67,0x65567265,0x78657472,0x00000000,0x00060006,0x00000020,0x00000000,0x505f6c67,0x7469736f,0x006e6f69,0x00070006,0x00000020,
+	0x00000001,0x505f6c67,0x746e696f,0x657a6953,0x00000000,0x00070006,0x00000020,0x00000002,0x435f6c67,0x4470696c,0x61747369,0x0065636e,
+	0x00070006,0x00000020,0x00000003,0x435f6c67,0x446c6c75,0x61747369,0x0065636e,0x00030005,0x00000022,0x00000000,0x00060005,0x00000026,
+	0x565f6c67,0x65747265,0x646e4978,0x00007865,0x00050005,0x00000031,0x67617266,0x6f6c6f43,0x00000072,0x00050048,0x00000020,0x00000000,
+	0x0000000b,0x00000000,0x00050048,0x00000020,0x00000001,0x0000000b,0x00000001,0x00050048,0x00000020,0x00000002,0x0000000b,0x00000003,
+	0x00050048,0x00000020,0x00000003,0x0000000b,0x00000004,0x00030047,0x00000020,0x00000002,0x00040047,0x00000026,0x0000000b,0x0000002a,
+	0x00040047,0x00000031,0x0000001e,0x00000000,0x00020013,0x00000002,0x00030021,0x00000003,0x00000002,0x00030016,0x00000006,0x00000020,
+	0x00040017,0x00000007,0x00000006,0x00000002,0x00040015,0x00000008,0x00000020,0x00000000,0x0004002b,0x00000008,0x00000009,0x00000003,
+	0x0004001c,0x0000000a,0x00000007,0x00000009,0x00040020,0x0000000b,0x00000006,0x0000000a,0x0004003b,0x0000000b,0x0000000c,0x00000006,
+	0x0004002b,0x00000006,0x0000000d,0x00000000,0x0004002b,0x00000006,0x0000000e,0xbf000000,0x0005002c,0x00000007,0x0000000f,0x0000000d,
+	0x0000000e,0x0004002b,0x00000006,0x00000010,0x3f000000,0x0005002c,0x00000007,0x00000011,0x00000010,0x00000010,0x0005002c,0x00000007,
+	0x00000012,0x0000000e,0x00000010,0x0006002c,0x0000000a,0x00000013,0x0000000f,0x00000011,0x00000012,0x00040017,0x00000014,0x00000006,
+	0x00000003,0x0004001c,0x00000015,0x00000014,0x00000009,0x00040020,0x00000016,0x00000006,0x00000015,0x0004003b,0x00000016,0x00000017,
+	0x00000006,0x0004002b,0x00000006,0x00000018,0x3f800000,0x0006002c,0x00000014,0x00000019,0x00000018,0x0000000d,0x0000000d,0x0006002c,
+	0x00000014,0x0000001a,0x0000000d,0x00000018,0x0000000d,0x0006002c,0x00000014,0x0000001b,0x0000000d,0x0000000d,0x00000018,0x0006002c,
+	0x00000015,0x0000001c,0x00000019,0x0000001a,0x0000001b,0x00040017,0x0000001d,0x00000006,0x00000004,0x0004002b,0x00000008,0x0000001e,
+	0x00000001,0x0004001c,0x0000001f,0x00000006,0x0000001e,0x0006001e,0x00000020,0x0000001d,0x00000006,0x0000001f,0x0000001f,0x00040020,
+	0x00000021,0x00000003,0x00000020,0x0004003b,0x00000021,0x00000022,0x00000003,0x00040015,0x00000023,0x00000020,0x00000001,0x0004002b,
+	0x00000023,0x00000024,0x00000000,0x00040020,0x00000025,0x00000001,0x00000023,0x0004003b,0x00000025,0x00000026,0x00000001,0x00040020,
+	0x00000028,0x00000006,0x00000007,0x00040020,0x0000002e,0x00000003,0x0000001d,0x00040020,0x00000030,0x00000003,0x00000014,0x0004003b,
+	0x00000030,0x00000031,0x00000003,0x00040020,0x00000033,0x00000006,0x00000014,0x00050036,0x00000002,0x00000004,0x00000000,0x00000003,
+	0x000200f8,0x00000005,0x0003003e,0x0000000c,0x00000013,0x0003003e,0x00000017,0x0000001c,0x0004003d,0x00000023,0x00000027,0x00000026,
+	0x00050041,0x00000028,0x00000029,0x0000000c,0x00000027,0x0004003d,0x00000007,0x0000002a,0x00000029,0x00050051,0x00000006,0x0000002b,
+	0x0000002a,0x00000000,0x00050051,0x00000006,0x0000002c,0x0000002a,0x00000001,0x00070050,0x0000001d,0x0000002d,0x0000002b,0x0000002c,
+	0x0000000d,0x00000018,0x00050041,0x0000002e,0x0000002f,0x00000022,0x00000024,0x0003003e,0x0000002f,0x0000002d,0x0004003d,0x00000023,
+	0x00000032,0x00000026,0x00050041,0x00000033,0x00000034,0x00000017,0x00000032,0x0004003d,0x00000014,0x00000035,0x00000034,0x0003003e,
+	0x00000031,0x00000035,0x000100fd,0x00010038
+};
+
+static const uint32_t fragment_shader[] = {
+	0x07230203,0x00010000,0x000d000b,0x00000013,0x00000000,0x00020011,0x00000001,0x0006000b,0x00000001,0x4c534c47,0x6474732e,0x3035342e,
+	0x00000000,0x0003000e,0x00000000,0x00000001,0x0007000f,0x00000004,0x00000004,0x6e69616d,0x00000000,0x00000009,0x0000000c,0x00030010,
+	0x00000004,0x00000007,0x00030003,0x00000002,0x000001c2,0x000a0004,0x475f4c47,0x4c474f4f,0x70635f45,0x74735f70,0x5f656c79,0x656e696c,
+	0x7269645f,0x69746365,0x00006576,0x00080004,0x475f4c47,0x4c474f4f,0x6e695f45,0x64756c63,0x69645f65,0x74636572,0x00657669,0x00040005,
+	0x00000004,0x6e69616d,0x00000000,0x00050005,0x00000009,0x4374756f,0x726f6c6f,0x00000000,0x00050005,0x0000000c,0x67617266,0x6f6c6f43,
+	0x00000072,0x00040047,0x00000009,0x0000001e,0x00000000,0x00040047,0x0000000c,0x0000001e,0x00000000,0x00020013,0x00000002,0x00030021,
+	0x00000003,0x00000002,0x00030016,0x00000006,0x00000020,0x00040017,0x00000007,0x00000006,0x00000004,0x00040020,0x00000008,0x00000003,
+	0x00000007,0x0004003b,0x00000008,0x00000009,0x00000003,0x00040017,0x0000000a,0x00000006,0x00000003,0x00040020,0x0000000b,0x00000001,
+	0x0000000a,0x0004003b,0x0000000b,0x0000000c,0x00000001,0x0004002b,0x00000006,0x0000000e,0x3f800000,0x00050036,0x00000002,0x00000004,
+	0x00000000,0x00000003,0x000200f8,0x00000005,0x0004003d,0x0000000a,0x0000000d,0x0000000c,0x00050051,0x00000006,0x0000000f,0x0000000d,
+	0x00000000,0x00050051,0x00000006,0x00000010,0x0000000d,0x00000001,0x00050051,0x00000006,0x00000011,0x0000000d,0x00000002,0x00070050,
+	0x00000007,0x00000012,0x0000000f,0x00000010,0x00000011,0x0000000e,0x0003003e,0x00000009,0x00000012,0x000100fd,0x00010038
+};
+
+static void writePPM(const char* path, const uint8_t* pixels, VkExtent2D extent)
+{
+	FILE* file = fopen(path, "wb");
+	if(file == NULL)
+		return;
+	fprintf(file, "P6\n%u %u\n255\n", extent.width, extent.height);
+	for(uint32_t i = 0; i < extent.width * extent.height; i++)
+		fwrite(&pixels[i * 4], 1, 3, file);
+	fclose(file);
+}
+
+int main(void)
+{
+	// Instance creation, no surface extensions needed
+	VkInstance instance = kvfCreateInstance(NULL, 0);
+
+	// Logical device creation
+	VkPhysicalDevice ph_device = kvfPickGoodHeadlessPhysicalDevice(instance);
+	if(ph_device == VK_NULL_HANDLE)
+	{
+		fprintf(stderr, "no suitable physical device found\n");
+		return 1;
+	}
+	VkDevice device = kvfCreateHeadlessDevice(ph_device);
+
+	// Offscreen targets creation
+	VkExtent2D extent = { 600, 400 };
+	KvfOffscreenTarget* target = kvfCreateOffscreenTarget(device, extent, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_D32_SFLOAT, FRAMES_IN_FLIGHT);
+	KvfReadbackQueue* readbacks = kvfOffscreenTargetGetReadbackQueue(target);
+
+	// Pipeline creation
+	VkShaderModule vertex_shader_module = kvfCreateShaderModule(device, (uint32_t*)vertex_shader, sizeof(vertex_shader) / sizeof(uint32_t));
+	VkShaderModule fragment_shader_module = kvfCreateShaderModule(device, (uint32_t*)fragment_shader, sizeof(fragment_shader) / sizeof(uint32_t));
+
+	VkPipelineLayout pipeline_layout = kvfCreatePipelineLayout(device, NULL, 0, NULL, 0);
+
+	KvfGraphicsPipelineBuilder* builder = kvfCreateGPipelineBuilder();
+	kvfGPipelineBuilderSetInputTopology(builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+	kvfGPipelineBuilderSetPolygonMode(builder, VK_POLYGON_MODE_FILL, 1.0f);
+	kvfGPipelineBuilderSetCullMode(builder, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+	kvfGPipelineBuilderSetMultisampling(builder, VK_SAMPLE_COUNT_1_BIT);
+	kvfGPipelineBuilderAddShaderStage(builder, VK_SHADER_STAGE_VERTEX_BIT, vertex_shader_module, "main");
+	kvfGPipelineBuilderAddShaderStage(builder, VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader_module, "main");
+	kvfGPipelineBuilderDisableDepthTest(builder);
+	kvfGPipelineBuilderDisableBlending(builder);
+
+	VkPipeline pipeline = kvfCreateGraphicsPipeline(device, VK_NULL_HANDLE, pipeline_layout, builder, kvfOffscreenTargetGetRenderPass(target));
+
+	kvfDestroyGPipelineBuilder(builder);
+	kvfDestroyShaderModule(device, vertex_shader_module);
+	kvfDestroyShaderModule(device, fragment_shader_module);
+
+	// One command buffer per frame in flight, the fences come from the readback queue
+	VkCommandBuffer cmds[FRAMES_IN_FLIGHT];
+	VkFence fences[FRAMES_IN_FLIGHT] = { VK_NULL_HANDLE };
+	KvfReadback frames_readbacks[FRAMES_IN_FLIGHT] = { 0 };
+	for(uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+		cmds[i] = kvfCreateCommandBuffer(device);
+
+	uint32_t frames_read = 0;
+	uint64_t checksum = 0;
+	uint8_t* last_frame = (uint8_t*)malloc(extent.width * extent.height * 4);
+
+	// Rendering loop
+	for(uint32_t i = 0; i < FRAMES_COUNT + FRAMES_IN_FLIGHT; i++)
+	{
+		uint32_t frame = i % FRAMES_IN_FLIGHT;
+
+		// Collect the frame previously rendered in this slot
+		if(frames_readbacks[frame] != 0)
+		{
+			kvfWaitForFence(device, fences[frame]);
+			kvfReadbackQueuePoll(readbacks, frames_readbacks[frame]);
+			VkDeviceSize size;
+			const uint8_t* pixels = (const uint8_t*)kvfReadbackQueueGetData(readbacks, frames_readbacks[frame], &size);
+			for(VkDeviceSize j = 0; j < size; j++)
+				checksum += pixels[j];
+			memcpy(last_frame, pixels, size);
+			kvfReadbackQueueRelease(readbacks, frames_readbacks[frame]);
+			frames_readbacks[frame] = 0;
+			frames_read++;
+		}
+		if(i >= FRAMES_COUNT)
+			continue;
+
+		VkCommandBuffer cmd = cmds[frame];
+		vkResetCommandBuffer(cmd, 0);
+		kvfBeginCommandBuffer(cmd, 0);
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			VkClearValue clear_values[2];
+			memset(clear_values, 0, sizeof(clear_values));
+			clear_values[0].color.float32[3] = 1.0f;
+			clear_values[1].depthStencil.depth = 1.0f;
+			kvfBeginRenderPass(kvfOffscreenTargetGetRenderPass(target), cmd, kvfOffscreenTargetGetFramebuffer(target, frame), extent, clear_values, 2);
+			VkViewport viewport = { 0 };
+			viewport.width = extent.width;
+			viewport.height = extent.height;
+			viewport.maxDepth = 1.0f;
+			vkCmdSetViewport(cmd, 0, 1, &viewport);
+			VkRect2D scissor = { 0 };
+			scissor.extent = extent;
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+			vkCmdDraw(cmd, 3, 1, 0, 0);
+			vkCmdEndRenderPass(cmd);
+			frames_readbacks[frame] = kvfOffscreenTargetReadback(target, cmd, frame);
+		kvfEndCommandBuffer(cmd);
+
+		fences[frame] = kvfReadbackQueueGetFence(readbacks);
+		kvfSubmitCommandBuffer(device, cmd, KVF_GRAPHICS_QUEUE, VK_NULL_HANDLE, VK_NULL_HANDLE, fences[frame], NULL);
+	}
+
+	printf("%u frames read back, checksum %llu\n", frames_read, (unsigned long long)checksum);
+	writePPM("headless.ppm", last_frame, extent);
+	free(last_frame);
+
+	// Cleanup
+	vkDeviceWaitIdle(device);
+	kvfDestroyPipelineLayout(device, pipeline_layout);
+	kvfDestroyPipeline(device, pipeline);
+	kvfDestroyOffscreenTarget(target);
+	kvfDestroyDevice(device);
+	kvfDestroyInstance(instance);
+	return 0;
+}